@@ -16,6 +16,7 @@
 //-------------------------------------------------------------------
 // buffer bindings
 constexpr unsigned int RENDERER_POSITION_BUFFER_BINDING = 0;
+constexpr unsigned int RENDERER_SMLENGTH_BUFFER_BINDING = 1;
 
 constexpr unsigned int PARTICLE_BUFFER_BINDING = 2;
 constexpr unsigned int PARTICLE_POSITION_BUFFER_BINDING = 2;
@@ -28,8 +29,33 @@ constexpr unsigned int PARTICLE_BALSARA_BUFFER_BINDING = 8;
 
 constexpr unsigned int MM_BUFFER_BINDING = 9;
 
+constexpr unsigned int PARTICLE_CONTROL_BUFFER_BINDING = 10;
+constexpr unsigned int SINK_BUFFER_BINDING = 11;
+constexpr unsigned int SINK_ACCRETION_BUFFER_BINDING = 12;
+constexpr unsigned int MERGE_PARTNER_BUFFER_BINDING = 13;
+constexpr unsigned int PSEUDO_PARTICLE_BUFFER_BINDING = 14;
+constexpr unsigned int GLASS_POSITION_BUFFER_BINDING = 15;
+constexpr unsigned int GLASS_VELOCITY_BUFFER_BINDING = 16;
+constexpr unsigned int GLASS_DENSITY_BUFFER_BINDING = 17;
+constexpr unsigned int IC_STAGING_BUFFER_BINDING = 18;
+constexpr unsigned int TURBULENCE_GRID_BUFFER_BINDING = 19;
+constexpr unsigned int SPAWN_TABLE_BUFFER_BINDING = 20;
+constexpr unsigned int CULL_INDEX_BUFFER_BINDING = 21;
+constexpr unsigned int CULL_COMMAND_BUFFER_BINDING = 22;
+constexpr unsigned int LOD_CELL_BUFFER_BINDING = 23;
+constexpr unsigned int LOD_BOUNDS_BUFFER_BINDING = 24;
+constexpr unsigned int LOD_NODE_BUFFER_BINDING = 25;
+constexpr unsigned int LOD_NODE_RADIUS_BUFFER_BINDING = 26;
+constexpr unsigned int LOD_COMMAND_BUFFER_BINDING = 27;
+constexpr unsigned int LOD_INDEX_BUFFER_BINDING = 28;
+constexpr unsigned int SINK_CANDIDATE_BUFFER_BINDING = 29;
+constexpr unsigned int CENTER_OF_MASS_BUFFER_BINDING = 30;
+constexpr unsigned int PARTICLE_RECORD_BUFFER_BINDING = 31;
+constexpr unsigned int PARTICLE_INDEX_BUFFER_BINDING = 32;
+
 constexpr unsigned int RENDERER_POSITION_ARRAY = 0;
 constexpr unsigned int RENDERER_MASS_ARRAY = 1;
+constexpr unsigned int RENDERER_SMLENGTH_ARRAY = 2;
 
 // work group size
 constexpr unsigned int GENERAL_WGSIZE = 128;
@@ -0,0 +1,234 @@
+/*
+ * GraSPH
+ * DistributedParticles.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the DistributedParticles class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "DistributedParticles.h"
+//--------------------
+
+// some helper functions
+//-------------------------------------------------------------------
+namespace {
+
+    /**
+     * @brief writes data to target starting at element offset, works on buffers without GL_DYNAMIC_STORAGE_BIT
+     */
+    template <typename T>
+    void uploadTo(const mpu::gph::Buffer& target, const std::vector<T>& data, uint32_t offset)
+    {
+        if(data.empty())
+            return;
+        mpu::gph::Buffer staging(data);
+        staging.copyTo<T>(target, data.size(), 0, offset);
+    }
+}
+
+// function definitions of the DistributedParticles class
+//-------------------------------------------------------------------
+DistributedParticles::DistributedParticles(ParticleBuffer buffer, DomainDecomposition& decomposition,
+                                           unsigned int pseudoCellsPerDim, float epsFactor)
+    : m_remoteGravityShader({{PROJECT_SHADER_PATH"Distributed/remoteGravity.comp"}}),
+      m_packShader({{PROJECT_SHADER_PATH"Distributed/packParticles.comp"}}),
+      m_unpackShader({{PROJECT_SHADER_PATH"Distributed/unpackParticles.comp"}}),
+      m_particleBuffer(buffer),
+      m_decomposition(decomposition),
+      m_pseudoCellsPerDim(pseudoCellsPerDim),
+      m_maxPseudoParticles(std::max(decomposition.numRanks()-1,1) * pseudoCellsPerDim*pseudoCellsPerDim*pseudoCellsPerDim),
+      m_numLocal(buffer.activeSize())
+{
+    m_pseudoParticleBuffer.recreate();
+    m_pseudoParticleBuffer.allocate<glm::vec4>(m_maxPseudoParticles, GL_DYNAMIC_STORAGE_BIT);
+    m_recordBuffer.recreate();
+    m_recordBuffer.allocate<ParticleRecord>(buffer.size(), GL_DYNAMIC_STORAGE_BIT);
+    m_indexBuffer.recreate();
+    m_indexBuffer.allocate<uint32_t>(buffer.size(), GL_DYNAMIC_STORAGE_BIT);
+    m_remoteGravityShader.uniform1f("eps_factor2", epsFactor*epsFactor);
+    m_remoteGravityShader.uniform1ui("num_of_pseudo_particles", 0);
+    bind();
+}
+
+void DistributedParticles::bind()
+{
+    m_pseudoParticleBuffer.bindBase(PSEUDO_PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_recordBuffer.bindBase(PARTICLE_RECORD_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_indexBuffer.bindBase(PARTICLE_INDEX_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+}
+
+void DistributedParticles::balance()
+{
+    assert_true(m_numGhosts == 0, "DistributedParticles", "Remove ghosts before load balancing.");
+
+    // without any measurement all particles are considered equally expensive
+    m_numLocal = m_particleBuffer.activeSize();
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    const std::vector<glm::vec4> positions = m_particleBuffer.positionBuffer.read<glm::vec4>(m_numLocal);
+    const float cost = (m_numLocal == 0 || m_computeTime <= 0) ? 1.0f : static_cast<float>(m_computeTime / m_numLocal);
+    m_computeTime = 0;
+
+    const std::vector<uint32_t>& emigrantIndices = m_decomposition.balance(positions, cost);
+    const std::vector<ParticleRecord> immigrants = m_decomposition.migrate(download(emigrantIndices));
+
+    // close the gaps left by the emigrants, the particles that stay are moved on the gpu
+    uint32_t numStaying = m_numLocal;
+    if(!emigrantIndices.empty())
+    {
+        std::vector<bool> leaves(m_numLocal, false);
+        for(uint32_t i : emigrantIndices)
+            leaves[i] = true;
+        std::vector<uint32_t> staying;
+        staying.reserve(m_numLocal - emigrantIndices.size());
+        for(uint32_t i = 0; i < m_numLocal; i++)
+            if(!leaves[i])
+                staying.push_back(i);
+
+        pack(staying);
+        numStaying = static_cast<uint32_t>(staying.size());
+        unpack(numStaying, 0);
+    }
+
+    assert_critical(numStaying + immigrants.size() <= m_particleBuffer.size(), "DistributedParticles",
+                    "Particle buffer too small to store the particles of this domain.");
+    upload(immigrants, numStaying);
+    m_numLocal = numStaying + static_cast<uint32_t>(immigrants.size());
+    m_particleBuffer.setActiveSize(m_numLocal);
+}
+
+void DistributedParticles::exchangeGhosts()
+{
+    m_numLocal = m_particleBuffer.activeSize();
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    const std::vector<glm::vec4> positions = m_particleBuffer.positionBuffer.read<glm::vec4>(m_numLocal);
+    const std::vector<float> smlength = m_particleBuffer.smlengthBuffer.read<float>(m_numLocal);
+
+    // only the particles at the domain border are read back and send, their indices stay in the index buffer
+    const std::vector<uint32_t>& boundaryIndices = m_decomposition.selectHalo(positions, smlength);
+    m_numBoundary = static_cast<uint32_t>(boundaryIndices.size());
+    std::vector<ParticleRecord> ghosts = m_decomposition.exchangeHalo(download(boundaryIndices));
+
+    // ghosts that do not fit are ignored, the density near the domain border will be wrong in that case
+    const uint32_t freeSpace = m_particleBuffer.size() - m_numLocal;
+    if(ghosts.size() > freeSpace)
+    {
+        logWARNING("DistributedParticles") << "Particle buffer is full, " << ghosts.size() - freeSpace << " ghosts are ignored.";
+        ghosts.resize(freeSpace);
+    }
+
+    m_numGhosts = static_cast<uint32_t>(ghosts.size());
+    m_ghostVelocities.resize(m_numGhosts);
+    for(uint32_t i = 0; i < m_numGhosts; i++)
+        m_ghostVelocities[i] = ghosts[i].velocity;
+    upload(ghosts, m_numLocal);
+    m_particleBuffer.setActiveSize(m_numLocal + m_numGhosts);
+
+    // approximate the other domains by pseudo particles, without the ghosts we just send them
+    std::vector<glm::vec4> pseudoParticles = m_decomposition.exchangePseudoParticles(positions, m_pseudoCellsPerDim);
+    if(pseudoParticles.size() > m_maxPseudoParticles)
+        pseudoParticles.resize(m_maxPseudoParticles);
+
+    m_numPseudoParticles = static_cast<uint32_t>(pseudoParticles.size());
+    if(m_numPseudoParticles > 0)
+        m_pseudoParticleBuffer.write(pseudoParticles);
+    m_remoteGravityShader.uniform1ui("num_of_pseudo_particles", m_numPseudoParticles);
+
+    // measure until the density of the local particles is read back in updateGhostHydro()
+    m_computeTimer.reset();
+}
+
+void DistributedParticles::updateGhostHydro()
+{
+    // the index buffer still contains the boundary particles of exchangeGhosts()
+    m_packShader.uniform1ui("num_of_records", m_numBoundary);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    if(m_numBoundary > 0)
+        m_packShader.dispatch(m_numBoundary, GENERAL_WGSIZE);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    const std::vector<ParticleRecord> boundary = m_recordBuffer.read<ParticleRecord>(m_numBoundary);
+    m_computeTime += m_computeTimer.getSeconds();
+
+    std::vector<glm::vec4> hydro(m_numBoundary);
+    std::vector<float> soundSpeed(m_numBoundary);
+    for(uint32_t i = 0; i < m_numBoundary; i++)
+    {
+        hydro[i] = boundary[i].hydro;
+        soundSpeed[i] = boundary[i].velocity.w;
+    }
+
+    std::vector<glm::vec4> ghostHydro;
+    std::vector<float> ghostSoundSpeed;
+    m_decomposition.updateHalo(hydro, soundSpeed, ghostHydro, ghostSoundSpeed);
+
+    ghostHydro.resize(m_numGhosts);
+    for(uint32_t i = 0; i < m_numGhosts; i++)
+        m_ghostVelocities[i].w = ghostSoundSpeed[i];
+
+    uploadTo(m_particleBuffer.hydrodynamicsBuffer, ghostHydro, m_numLocal);
+    uploadTo(m_particleBuffer.velocityBuffer, m_ghostVelocities, m_numLocal);
+}
+
+void DistributedParticles::addRemoteGravity()
+{
+    if(m_numPseudoParticles == 0 || m_numLocal == 0)
+        return;
+
+    m_remoteGravityShader.uniform1ui("num_of_particles", m_numLocal);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_remoteGravityShader.dispatch(m_numLocal, GENERAL_WGSIZE);
+}
+
+void DistributedParticles::removeGhosts()
+{
+    m_particleBuffer.setActiveSize(m_numLocal);
+    m_numGhosts = 0;
+}
+
+void DistributedParticles::pack(const std::vector<uint32_t>& indices)
+{
+    if(indices.empty())
+        return;
+
+    m_indexBuffer.write(indices);
+    m_packShader.uniform1ui("num_of_records", static_cast<uint32_t>(indices.size()));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_packShader.dispatch(static_cast<uint32_t>(indices.size()), GENERAL_WGSIZE);
+}
+
+void DistributedParticles::unpack(uint32_t count, uint32_t offset)
+{
+    if(count == 0)
+        return;
+
+    m_unpackShader.uniform1ui("num_of_records", count);
+    m_unpackShader.uniform1ui("offset", offset);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_unpackShader.dispatch(count, GENERAL_WGSIZE);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+std::vector<ParticleRecord> DistributedParticles::download(const std::vector<uint32_t>& indices)
+{
+    if(indices.empty())
+        return {};
+
+    pack(indices);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    return m_recordBuffer.read<ParticleRecord>(static_cast<GLsizei>(indices.size()));
+}
+
+void DistributedParticles::upload(const std::vector<ParticleRecord>& particles, uint32_t offset)
+{
+    if(particles.empty())
+        return;
+
+    m_recordBuffer.write(particles);
+    unpack(static_cast<uint32_t>(particles.size()), offset);
+}
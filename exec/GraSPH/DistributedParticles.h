@@ -0,0 +1,95 @@
+/*
+ * GraSPH
+ * DistributedParticles.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the DistributedParticles class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_DISTRIBUTEDPARTICLES_H
+#define GRASPH_DISTRIBUTEDPARTICLES_H
+
+// includes
+//--------------------
+#include <Graphics/Graphics.h>
+#include <Log/Log.h>
+#include <Timer/Stopwatch.h>
+#include "Common.h"
+#include "ParticleBuffer.h"
+#include "DomainDecomposition.h"
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class DistributedParticles
+ *
+ * usage:
+ * Connects the ParticleBuffer of a rank to the DomainDecomposition. The particle buffer stores the local particles of the
+ * rank, ghost particles of neighbouring domains are stored behind them while a step is calculated.
+ *
+ * Each simulation step call exchangeGhosts() first, then calculate the density of all particles (local and ghosts).
+ * Afterwards call updateGhostHydro(), which overwrites the incomplete density of the ghosts with the one calculated
+ * by their owner. Calculate the acceleration of all particles, ghosts contribute their gravity directly.
+ * Then call removeGhosts() and addRemoteGravity() to add the gravity of the rest of the other domains.
+ * Integrate only the local particles.
+ *
+ * From time to time call balance() to redistribute the particles. The cost of each rank is measured as the time
+ * the gpu needs to calculate the density between exchangeGhosts() and updateGhostHydro(), so waiting for other ranks
+ * is not counted. Balance must not be called while ghosts are stored in the buffer.
+ *
+ * Only positions and smoothing lengths of the local particles are read back every step, they are needed to find the
+ * ghosts and the pseudo particles. All other attributes are only transferred for the boundary particles that are send
+ * as ghosts, the ghosts themselves and the particles that change their owner during load balancing. Those particles
+ * are packed into (and unpacked from) a buffer of records on the gpu.
+ *
+ */
+class DistributedParticles
+{
+public:
+    DistributedParticles(ParticleBuffer buffer, DomainDecomposition& decomposition, unsigned int pseudoCellsPerDim, float epsFactor);
+
+    void bind(); //!< binds the pseudo particle buffer
+    void balance(); //!< redistribute particles between ranks based on the compute time measured since the last call
+    void exchangeGhosts(); //!< store ghosts behind the local particles and update the pseudo particles of other domains
+    void updateGhostHydro(); //!< overwrite hydro values and speed of sound of the ghosts with the ones of their owners
+    void addRemoteGravity(); //!< add the gravity of the other domains to the local particles
+    void removeGhosts(); //!< remove the ghosts from the particle buffer
+
+    uint32_t numLocal() const {return m_numLocal;} //!< number of particles owned by this rank
+    uint32_t numGhosts() const {return m_numGhosts;} //!< number of ghosts stored in the buffer
+    uint32_t numPseudoParticles() const {return m_numPseudoParticles;} //!< number of pseudo particles used for remote gravity
+
+private:
+    void pack(const std::vector<uint32_t>& indices); //!< copy the particles at indices into the record buffer
+    void unpack(uint32_t count, uint32_t offset); //!< copy count records into the particle buffer starting at offset
+    std::vector<ParticleRecord> download(const std::vector<uint32_t>& indices); //!< read the particles at indices from the particle buffer
+    void upload(const std::vector<ParticleRecord>& particles, uint32_t offset); //!< write particles to the particle buffer starting at offset
+
+    mpu::gph::ShaderProgram m_remoteGravityShader; //!< adds gravity of pseudo particles
+    mpu::gph::ShaderProgram m_packShader; //!< copies particles into the record buffer
+    mpu::gph::ShaderProgram m_unpackShader; //!< copies records into the particle buffer
+    mpu::gph::Buffer m_pseudoParticleBuffer{nullptr}; //!< pseudo particles of other domains
+    mpu::gph::Buffer m_recordBuffer{nullptr}; //!< particles packed for transfer
+    mpu::gph::Buffer m_indexBuffer{nullptr}; //!< indices of the particles to pack
+    ParticleBuffer m_particleBuffer; //!< the particles of this rank
+    DomainDecomposition& m_decomposition; //!< communication with the other ranks
+
+    unsigned int m_pseudoCellsPerDim; //!< resolution of the grid used to create pseudo particles
+    uint32_t m_maxPseudoParticles; //!< capacity of the pseudo particle buffer
+    uint32_t m_numPseudoParticles{0}; //!< number of pseudo particles in the buffer
+    uint32_t m_numLocal{0}; //!< number of particles owned by this rank
+    uint32_t m_numGhosts{0}; //!< number of ghosts stored behind the local particles
+    uint32_t m_numBoundary{0}; //!< number of local particles send as ghosts, their indices are in the index buffer
+    std::vector<glm::vec4> m_ghostVelocities; //!< velocity of the ghosts, needed to update their speed of sound
+
+    mpu::HRStopwatch m_computeTimer; //!< measures the time needed to calculate the density
+    double m_computeTime{0}; //!< compute time accumulated since the last load balancing
+};
+
+
+#endif //GRASPH_DISTRIBUTEDPARTICLES_H
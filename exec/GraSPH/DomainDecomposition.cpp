@@ -0,0 +1,338 @@
+/*
+ * GraSPH
+ * DomainDecomposition.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the DomainDecomposition class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "DomainDecomposition.h"
+#include <Log/Log.h>
+#include <algorithm>
+#include <numeric>
+#include <cfloat>
+//--------------------
+
+// some helper functions
+//-------------------------------------------------------------------
+namespace {
+
+    /**
+     * @brief spreads the lower 21 bits of v, so there are two zero bits between each of them
+     */
+    uint64_t spreadBits(uint64_t v)
+    {
+        v &= 0x1fffff;
+        v = (v | v << 32) & 0x1f00000000ffff;
+        v = (v | v << 16) & 0x1f0000ff0000ff;
+        v = (v | v << 8) & 0x100f00f00f00f00f;
+        v = (v | v << 4) & 0x10c30c30c30c30c3;
+        v = (v | v << 2) & 0x1249249249249249;
+        return v;
+    }
+
+    /**
+     * @brief sends sendCounts[r] elements of send to rank r, elements for each rank need to be stored consecutive
+     * @param recvCounts is set to the number of elements received from each rank
+     * @return all received elements, ordered by rank
+     */
+    template <typename T>
+    std::vector<T> exchange(MPI_Comm comm, const std::vector<T>& send, const std::vector<int>& sendCounts, std::vector<int>& recvCounts)
+    {
+        const int numRanks = static_cast<int>(sendCounts.size());
+        recvCounts.resize(numRanks);
+        MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, comm);
+
+        // data is send as bytes
+        std::vector<int> sendBytes(numRanks), sendOffsets(numRanks), recvBytes(numRanks), recvOffsets(numRanks);
+        int sendTotal = 0;
+        int recvTotal = 0;
+        for(int r = 0; r < numRanks; r++)
+        {
+            sendBytes[r] = sendCounts[r] * sizeof(T);
+            sendOffsets[r] = sendTotal;
+            sendTotal += sendBytes[r];
+            recvBytes[r] = recvCounts[r] * sizeof(T);
+            recvOffsets[r] = recvTotal;
+            recvTotal += recvBytes[r];
+        }
+
+        std::vector<T> recv(recvTotal / sizeof(T));
+        MPI_Alltoallv(send.data(), sendBytes.data(), sendOffsets.data(), MPI_BYTE,
+                      recv.data(), recvBytes.data(), recvOffsets.data(), MPI_BYTE, comm);
+        return recv;
+    }
+}
+
+// function definitions of the DomainDecomposition class
+//-------------------------------------------------------------------
+DomainDecomposition::DomainDecomposition(MPI_Comm comm)
+    : m_comm(comm), m_globalLower{0,0,0}, m_globalExtend(1)
+{
+    MPI_Comm_rank(m_comm, &m_rank);
+    MPI_Comm_size(m_comm, &m_numRanks);
+    m_migrateSendCounts.resize(m_numRanks, 0);
+    m_haloSendCounts.resize(m_numRanks, 0);
+    m_haloRecvCounts.resize(m_numRanks, 0);
+    logDEBUG("DomainDecomposition") << "Rank " << m_rank << " of " << m_numRanks << " started.";
+}
+
+const std::vector<uint32_t>& DomainDecomposition::balance(const std::vector<glm::vec4>& positions, float particleCost)
+{
+    computeGlobalBounds(positions);
+
+    // build a histogram of the cost along the space filling curve
+    const uint32_t numBins = 1u << histogramBits;
+    const double cost = (particleCost > 0) ? particleCost : 1.0;
+    std::vector<double> histogram(numBins, 0.0);
+    std::vector<uint32_t> bins(positions.size());
+    for(size_t i = 0; i < positions.size(); i++)
+    {
+        bins[i] = static_cast<uint32_t>(mortonKey(positions[i]) >> (63 - histogramBits));
+        histogram[bins[i]] += cost;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, histogram.data(), numBins, MPI_DOUBLE, MPI_SUM, m_comm);
+
+    // cut the curve into pieces of equal cost, rank r owns the bins [splitter[r], splitter[r+1])
+    const double totalCost = std::accumulate(histogram.begin(), histogram.end(), 0.0);
+    std::vector<uint32_t> splitter(m_numRanks + 1, numBins);
+    splitter[0] = 0;
+    double cumulativeCost = 0;
+    int nextRank = 1;
+    for(uint32_t b = 0; b < numBins && nextRank < m_numRanks; b++)
+    {
+        while(nextRank < m_numRanks && cumulativeCost >= totalCost * nextRank / m_numRanks)
+            splitter[nextRank++] = b;
+        cumulativeCost += histogram[b];
+    }
+
+    // particles that stay on this rank are not send, the others are grouped by their new owner
+    std::fill(m_migrateSendCounts.begin(), m_migrateSendCounts.end(), 0);
+    std::vector<int> owner(positions.size());
+    for(size_t i = 0; i < positions.size(); i++)
+    {
+        owner[i] = static_cast<int>(std::upper_bound(splitter.begin(), splitter.end(), bins[i]) - splitter.begin()) - 1;
+        if(owner[i] != m_rank)
+            m_migrateSendCounts[owner[i]]++;
+    }
+
+    std::vector<int> offset(m_numRanks, 0);
+    std::partial_sum(m_migrateSendCounts.begin(), m_migrateSendCounts.end()-1, offset.begin()+1);
+    m_migrateSendIndices.resize(offset.back() + m_migrateSendCounts.back());
+    for(uint32_t i = 0; i < positions.size(); i++)
+        if(owner[i] != m_rank)
+            m_migrateSendIndices[offset[owner[i]]++] = i;
+
+    return m_migrateSendIndices;
+}
+
+std::vector<ParticleRecord> DomainDecomposition::migrate(const std::vector<ParticleRecord>& emigrants)
+{
+    assert_true(emigrants.size() == m_migrateSendIndices.size(), "DomainDecomposition",
+                "Number of emigrants does not match the last load balancing.");
+
+    std::vector<int> recvCounts;
+    std::vector<ParticleRecord> immigrants = exchange(m_comm, emigrants, m_migrateSendCounts, recvCounts);
+
+    logDEBUG("DomainDecomposition") << "Rank " << m_rank << " send " << emigrants.size() << " and received "
+                                    << immigrants.size() << " particles during load balancing.";
+    return immigrants;
+}
+
+const std::vector<uint32_t>& DomainDecomposition::selectHalo(const std::vector<glm::vec4>& positions, const std::vector<float>& smlength)
+{
+    DomainInfo local = localDomain(positions, smlength);
+    std::vector<DomainInfo> domains(m_numRanks);
+    MPI_Allgather(&local, sizeof(DomainInfo), MPI_BYTE, domains.data(), sizeof(DomainInfo), MPI_BYTE, m_comm);
+
+    // a particle is a ghost on another rank if it could interact with any particle inside the other domain
+    m_haloSendIndices.clear();
+    for(int r = 0; r < m_numRanks; r++)
+    {
+        m_haloSendCounts[r] = 0;
+        if(r == m_rank)
+            continue;
+
+        const DomainInfo& d = domains[r];
+        for(uint32_t i = 0; i < positions.size(); i++)
+        {
+            const glm::vec4& p = positions[i];
+            const float dx = std::max(std::max(d.lower[0] - p.x, p.x - d.upper[0]), 0.0f);
+            const float dy = std::max(std::max(d.lower[1] - p.y, p.y - d.upper[1]), 0.0f);
+            const float dz = std::max(std::max(d.lower[2] - p.z, p.z - d.upper[2]), 0.0f);
+            const float radius = std::max(smlength[i], d.maxSmlength);
+            if(dx*dx + dy*dy + dz*dz < radius*radius)
+            {
+                m_haloSendIndices.push_back(i);
+                m_haloSendCounts[r]++;
+            }
+        }
+    }
+
+    return m_haloSendIndices;
+}
+
+std::vector<ParticleRecord> DomainDecomposition::exchangeHalo(const std::vector<ParticleRecord>& boundary)
+{
+    assert_true(boundary.size() == m_haloSendIndices.size(), "DomainDecomposition",
+                "Number of boundary particles does not match the last halo selection.");
+    return exchange(m_comm, boundary, m_haloSendCounts, m_haloRecvCounts);
+}
+
+void DomainDecomposition::updateHalo(const std::vector<glm::vec4>& boundaryHydro, const std::vector<float>& boundarySoundSpeed,
+                                     std::vector<glm::vec4>& ghostHydro, std::vector<float>& ghostSoundSpeed)
+{
+    assert_true(boundaryHydro.size() == m_haloSendIndices.size() && boundarySoundSpeed.size() == m_haloSendIndices.size(),
+                "DomainDecomposition", "Boundary particles changed since the last halo exchange.");
+
+    std::vector<int> recvCounts;
+    ghostHydro = exchange(m_comm, boundaryHydro, m_haloSendCounts, recvCounts);
+    ghostSoundSpeed = exchange(m_comm, boundarySoundSpeed, m_haloSendCounts, recvCounts);
+    assert_true(recvCounts == m_haloRecvCounts, "DomainDecomposition", "Number of ghosts changed since the last halo exchange.");
+}
+
+std::vector<glm::vec4> DomainDecomposition::exchangePseudoParticles(const std::vector<glm::vec4>& positions, unsigned int cellsPerDim)
+{
+    // bounding box of the local particles
+    float lower[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float upper[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for(const auto& p : positions)
+    {
+        lower[0] = std::min(lower[0], p.x); upper[0] = std::max(upper[0], p.x);
+        lower[1] = std::min(lower[1], p.y); upper[1] = std::max(upper[1], p.y);
+        lower[2] = std::min(lower[2], p.z); upper[2] = std::max(upper[2], p.z);
+    }
+
+    // sum up mass and center of mass in each grid cell, in double precision so the ghosts can be subtracted again
+    const unsigned int numCells = cellsPerDim*cellsPerDim*cellsPerDim;
+    std::vector<glm::dvec4> cells(numCells, glm::dvec4(0,0,0,0));
+    std::vector<uint32_t> cellCount(numCells, 0);
+    std::vector<unsigned int> cellOf(positions.size());
+    auto cellIndex = [&](float x, int axis)
+    {
+        const float extend = upper[axis] - lower[axis];
+        const int c = (extend > 0) ? static_cast<int>((x - lower[axis]) / extend * cellsPerDim) : 0;
+        return static_cast<unsigned int>(std::min(std::max(c, 0), static_cast<int>(cellsPerDim) - 1));
+    };
+    for(size_t i = 0; i < positions.size(); i++)
+    {
+        const glm::vec4& p = positions[i];
+        cellOf[i] = (cellIndex(p.z,2) * cellsPerDim + cellIndex(p.y,1)) * cellsPerDim + cellIndex(p.x,0);
+        cells[cellOf[i]] += glm::dvec4(p.x * p.w, p.y * p.w, p.z * p.w, p.w);
+        cellCount[cellOf[i]]++;
+    }
+
+    // the ghosts a rank received interact with its particles directly, so their mass is removed from the cells send there
+    std::vector<glm::vec4> send;
+    std::vector<int> sendCounts(m_numRanks, 0);
+    size_t haloOffset = 0;
+    for(int r = 0; r < m_numRanks; r++)
+    {
+        const size_t haloEnd = haloOffset + m_haloSendCounts[r];
+        if(r == m_rank)
+        {
+            haloOffset = haloEnd;
+            continue;
+        }
+
+        std::vector<glm::dvec4> remaining(cells);
+        std::vector<uint32_t> remainingCount(cellCount);
+        for(size_t k = haloOffset; k < haloEnd; k++)
+        {
+            const uint32_t i = m_haloSendIndices[k];
+            assert_true(i < positions.size(), "DomainDecomposition", "Local particles changed since the last halo exchange.");
+            const glm::vec4& p = positions[i];
+            remaining[cellOf[i]] -= glm::dvec4(p.x * p.w, p.y * p.w, p.z * p.w, p.w);
+            remainingCount[cellOf[i]]--;
+        }
+        haloOffset = haloEnd;
+
+        for(unsigned int c = 0; c < numCells; c++)
+            if(remainingCount[c] > 0 && remaining[c].w > 0)
+            {
+                send.push_back(glm::vec4(remaining[c].x / remaining[c].w, remaining[c].y / remaining[c].w,
+                                         remaining[c].z / remaining[c].w, remaining[c].w));
+                sendCounts[r]++;
+            }
+    }
+
+    std::vector<int> recvCounts;
+    return exchange(m_comm, send, sendCounts, recvCounts);
+}
+
+double DomainDecomposition::globalMin(double value) const
+{
+    double result;
+    MPI_Allreduce(&value, &result, 1, MPI_DOUBLE, MPI_MIN, m_comm);
+    return result;
+}
+
+double DomainDecomposition::globalSum(double value) const
+{
+    double result;
+    MPI_Allreduce(&value, &result, 1, MPI_DOUBLE, MPI_SUM, m_comm);
+    return result;
+}
+
+void DomainDecomposition::computeGlobalBounds(const std::vector<glm::vec4>& positions)
+{
+    // store lower corner and negative upper corner, so a single min reduction finds both
+    float bounds[6] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+    for(const auto& p : positions)
+    {
+        bounds[0] = std::min(bounds[0], p.x);
+        bounds[1] = std::min(bounds[1], p.y);
+        bounds[2] = std::min(bounds[2], p.z);
+        bounds[3] = std::min(bounds[3], -p.x);
+        bounds[4] = std::min(bounds[4], -p.y);
+        bounds[5] = std::min(bounds[5], -p.z);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, bounds, 6, MPI_FLOAT, MPI_MIN, m_comm);
+
+    float extend = 0;
+    for(int i = 0; i < 3; i++)
+        extend = std::max(extend, -bounds[i+3] - bounds[i]);
+
+    if(extend > 0)
+    {
+        m_globalLower[0] = bounds[0];
+        m_globalLower[1] = bounds[1];
+        m_globalLower[2] = bounds[2];
+        m_globalExtend = extend;
+    }
+}
+
+uint64_t DomainDecomposition::mortonKey(const glm::vec4& position) const
+{
+    constexpr float maxCell = (1u << 21) - 1;
+    const float p[3] = {position.x, position.y, position.z};
+    uint64_t cell[3];
+    for(int i = 0; i < 3; i++)
+    {
+        const float normalized = std::min(std::max((p[i] - m_globalLower[i]) / m_globalExtend, 0.0f), 1.0f);
+        cell[i] = static_cast<uint64_t>(normalized * maxCell);
+    }
+    return (spreadBits(cell[0]) << 2) | (spreadBits(cell[1]) << 1) | spreadBits(cell[2]);
+}
+
+DomainDecomposition::DomainInfo DomainDecomposition::localDomain(const std::vector<glm::vec4>& positions, const std::vector<float>& smlength) const
+{
+    // an empty domain has an inverted bounding box, so nothing is ever inside it
+    DomainInfo d{{FLT_MAX, FLT_MAX, FLT_MAX}, 0, {-FLT_MAX, -FLT_MAX, -FLT_MAX}, 0};
+    for(size_t i = 0; i < positions.size(); i++)
+    {
+        const glm::vec4& p = positions[i];
+        d.lower[0] = std::min(d.lower[0], p.x); d.upper[0] = std::max(d.upper[0], p.x);
+        d.lower[1] = std::min(d.lower[1], p.y); d.upper[1] = std::max(d.upper[1], p.y);
+        d.lower[2] = std::min(d.lower[2], p.z); d.upper[2] = std::max(d.upper[2], p.z);
+        d.maxSmlength = std::max(d.maxSmlength, smlength[i]);
+    }
+    return d;
+}
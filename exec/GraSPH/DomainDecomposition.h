@@ -0,0 +1,117 @@
+/*
+ * GraSPH
+ * DomainDecomposition.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the DomainDecomposition class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_DOMAINDECOMPOSITION_H
+#define GRASPH_DOMAINDECOMPOSITION_H
+
+// includes
+//--------------------
+#include <mpi.h>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * struct ParticleRecord
+ *
+ * All attributes of a particle that need to be send to other ranks. Accelerations and the per thread hydro values are
+ * recalculated every step and are not part of the record. The layout matches the struct in Distributed/particleRecord.glsl.
+ */
+struct ParticleRecord
+{
+    glm::vec4 position; // w is the mass
+    glm::vec4 velocity; // w is the speed of sound
+    glm::vec4 hydro; // accumulated hydro values
+    float smlength;
+    float timestep;
+    float padding[2];
+};
+
+//-------------------------------------------------------------------
+/**
+ * class DomainDecomposition
+ *
+ * usage:
+ * Distributes particles between MPI ranks. MPI needs to be initialized before constructing an object.
+ * This class does not use openGL, use DistributedParticles to transfer the data to a ParticleBuffer.
+ *
+ * balance() sorts the particles along a morton space filling curve and cuts the curve into pieces of equal cost,
+ * one for each rank. It returns the indices of the particles that belong to another rank now, migrate() then sends
+ * the records of those particles to their new owner. All other particles stay where they are, so only the particles that
+ * change their owner need to be transferred. Set the cost of a particle to the time it took to simulate it,
+ * so ranks on faster devices get more particles.
+ *
+ * selectHalo() returns the indices of the local particles that are ghosts on other ranks. A particle is send as a ghost
+ * when it is closer to the other domains bounding box than its own kernel radius or the largest kernel radius inside
+ * the other domain. Pass the records of those particles to exchangeHalo() to receive the ghosts of other ranks.
+ * After the density of the local particles was calculated updateHalo() sends the new hydro values of the same particles
+ * to the ghosts. The order of ghosts is the same in all three functions.
+ *
+ * exchangePseudoParticles() approximates the mass distribution of each domain with the monopoles of a coarse grid
+ * and returns those of all other ranks. They can be used to calculate the gravity of remote domains. The mass of the
+ * ghosts selected in the last call to selectHalo() is not part of the cells send to the rank that received them,
+ * so the gravity of ghosts can be calculated directly without counting their mass twice.
+ *
+ */
+class DomainDecomposition
+{
+public:
+    explicit DomainDecomposition(MPI_Comm comm = MPI_COMM_WORLD);
+
+    int rank() const {return m_rank;} //!< returns the rank of this process
+    int numRanks() const {return m_numRanks;} //!< returns the total number of ranks
+
+    const std::vector<uint32_t>& balance(const std::vector<glm::vec4>& positions, float particleCost); //!< returns the indices of particles that now belong to another rank, grouped by rank
+    std::vector<ParticleRecord> migrate(const std::vector<ParticleRecord>& emigrants); //!< send the particles selected in the last call to balance() to their new owner, returns the particles received
+    const std::vector<uint32_t>& selectHalo(const std::vector<glm::vec4>& positions, const std::vector<float>& smlength); //!< returns the indices of particles that are ghosts on other ranks, grouped by rank
+    std::vector<ParticleRecord> exchangeHalo(const std::vector<ParticleRecord>& boundary); //!< send the particles selected in the last call to selectHalo(), returns the ghost particles from other ranks
+    void updateHalo(const std::vector<glm::vec4>& boundaryHydro, const std::vector<float>& boundarySoundSpeed,
+                    std::vector<glm::vec4>& ghostHydro, std::vector<float>& ghostSoundSpeed); //!< send new hydro values of the particles selected in the last call to selectHalo() to the ghosts
+    std::vector<glm::vec4> exchangePseudoParticles(const std::vector<glm::vec4>& positions, unsigned int cellsPerDim); //!< returns the pseudo particles of all other ranks (w is mass)
+
+    double globalMin(double value) const; //!< minimum of value over all ranks
+    double globalSum(double value) const; //!< sum of value over all ranks
+
+private:
+    static constexpr int histogramBits = 16; //!< the space filling curve is divided in 2^histogramBits parts for load balancing
+
+    struct DomainInfo
+    {
+        float lower[3]; // lower corner of the bounding box
+        float maxSmlength; // biggest smoothing length inside the domain
+        float upper[3]; // upper corner of the bounding box
+        float padding;
+    };
+
+    void computeGlobalBounds(const std::vector<glm::vec4>& positions); //!< bounding box of all particles on all ranks
+    uint64_t mortonKey(const glm::vec4& position) const; //!< position on the space filling curve
+    DomainInfo localDomain(const std::vector<glm::vec4>& positions, const std::vector<float>& smlength) const; //!< bounding box of the local particles
+
+    MPI_Comm m_comm; //!< the communicator used
+    int m_rank; //!< rank of this process
+    int m_numRanks; //!< total number of ranks
+
+    float m_globalLower[3]; //!< lower corner of all particles
+    float m_globalExtend; //!< size of the cube that contains all particles
+
+    std::vector<int> m_migrateSendCounts; //!< number of particles send to each rank during load balancing
+    std::vector<uint32_t> m_migrateSendIndices; //!< indices of the local particles that change their owner, grouped by rank
+    std::vector<int> m_haloSendCounts; //!< number of ghosts send to each rank
+    std::vector<int> m_haloRecvCounts; //!< number of ghosts received from each rank
+    std::vector<uint32_t> m_haloSendIndices; //!< indices of the local particles send as ghosts, grouped by rank
+};
+
+
+#endif //GRASPH_DOMAINDECOMPOSITION_H
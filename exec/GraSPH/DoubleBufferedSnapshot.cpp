@@ -0,0 +1,98 @@
+/*
+ * GraSPH
+ * DoubleBufferedSnapshot.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the DoubleBufferedSnapshot class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "DoubleBufferedSnapshot.h"
+//--------------------
+
+// function definitions of the DoubleBufferedSnapshot class
+//-------------------------------------------------------------------
+DoubleBufferedSnapshot::DoubleBufferedSnapshot(uint32_t particleCapacity, uint32_t sinkBufferSize)
+{
+    for(auto& slot : m_slots)
+    {
+        slot.positions.recreate();
+        slot.positions.allocate<ParticleBuffer::posType>(particleCapacity);
+        slot.smlength.recreate();
+        slot.smlength.allocate<ParticleBuffer::smlengthType>(particleCapacity);
+        slot.sinks.recreate();
+        slot.sinks.allocate<uint8_t>(std::max(sinkBufferSize,1u));
+    }
+}
+
+DoubleBufferedSnapshot::~DoubleBufferedSnapshot()
+{
+    for(auto& slot : m_slots)
+    {
+        glDeleteSync(slot.copyFence);
+        glDeleteSync(slot.drawFence);
+    }
+}
+
+void DoubleBufferedSnapshot::publish(ParticleBuffer buffer, const mpu::gph::Buffer& sinkBuffer, const Info& info)
+{
+    // while nothing is pending the renderer will not switch slots, so the back slot is ours
+    int back;
+    {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        back = 1 - m_front;
+        m_pending = false;
+    }
+    Slot& slot = m_slots[back];
+
+    // wait until the renderer is done drawing the last time this slot was in front
+    if(slot.drawFence)
+    {
+        while(glClientWaitSync(slot.drawFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(slot.drawFence);
+        slot.drawFence = nullptr;
+    }
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    buffer.positionBuffer.copyTo<ParticleBuffer::posType>(slot.positions, info.numParticles);
+    buffer.smlengthBuffer.copyTo<ParticleBuffer::smlengthType>(slot.smlength, info.numParticles);
+    if(info.numSinks > 0)
+        sinkBuffer.copyTo(slot.sinks, std::min(sinkBuffer.size(), slot.sinks.size()));
+
+    glDeleteSync(slot.copyFence);
+    slot.copyFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush(); // the fence needs to reach the gpu before the other context can wait on it
+    slot.info = info;
+
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_pending = true;
+}
+
+bool DoubleBufferedSnapshot::acquire()
+{
+    {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        if(!m_pending)
+            return false;
+        m_front = 1 - m_front;
+        m_pending = false;
+    }
+
+    Slot& slot = m_slots[m_front];
+    glWaitSync(slot.copyFence, 0, GL_TIMEOUT_IGNORED);
+    return true;
+}
+
+void DoubleBufferedSnapshot::release()
+{
+    Slot& slot = m_slots[m_front];
+    glDeleteSync(slot.drawFence);
+    slot.drawFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+}
@@ -0,0 +1,89 @@
+/*
+ * GraSPH
+ * DoubleBufferedSnapshot.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the DoubleBufferedSnapshot class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_DOUBLEBUFFEREDSNAPSHOT_H
+#define GRASPH_DOUBLEBUFFEREDSNAPSHOT_H
+
+// includes
+//--------------------
+#include <mutex>
+#include <Graphics/Graphics.h>
+#include <Log/Log.h>
+#include "ParticleBuffer.h"
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class DoubleBufferedSnapshot
+ *
+ * usage:
+ * Passes particle positions, smoothing lengths and sinks from the simulation thread to the render thread. Both threads need their own
+ * openGL context, and the contexts need to share objects.
+ *
+ * The simulation thread calls publish() after a step. The positions and sinks are copied into the slot the renderer
+ * is not using. If the renderer still uses that slot from an earlier frame, publish waits for the fence set in release().
+ *
+ * The render thread calls acquire() before drawing. If there is a new snapshot it becomes the front slot and true
+ * is returned, so the renderer can be pointed to the new buffers. The render context then waits on the gpu for the copy
+ * to finish. Call release() after all draw calls that use the front slot were issued.
+ *
+ */
+class DoubleBufferedSnapshot
+{
+public:
+    struct Info
+    {
+        uint32_t numParticles{0}; //!< number of particles in the snapshot
+        uint32_t numSinks{0}; //!< number of sinks in the snapshot
+        double simulationTime{0}; //!< simulation time when the snapshot was taken
+        uint64_t step{0}; //!< number of simulation steps when the snapshot was taken
+    };
+
+    DoubleBufferedSnapshot(uint32_t particleCapacity, uint32_t sinkBufferSize); //!< sinkBufferSize is the size of the sink buffer in byte, can be 0
+    ~DoubleBufferedSnapshot();
+
+    // simulation thread
+    void publish(ParticleBuffer buffer, const mpu::gph::Buffer& sinkBuffer, const Info& info); //!< copy positions and sinks into the back slot
+
+    // render thread
+    bool acquire(); //!< use the newest snapshot if one was published, returns true if the front slot changed
+    void release(); //!< call after drawing, the front slot will not be overwritten until the gpu is done drawing
+
+    mpu::gph::Buffer positions() const {return m_slots[m_front].positions;} //!< positions of the front slot (w is mass)
+    mpu::gph::Buffer smlength() const {return m_slots[m_front].smlength;} //!< smoothing lengths of the front slot
+    mpu::gph::Buffer sinks() const {return m_slots[m_front].sinks;} //!< sink buffer of the front slot
+    const Info& info() const {return m_slots[m_front].info;} //!< information about the front slot
+
+    // make noncopyable
+    DoubleBufferedSnapshot(const DoubleBufferedSnapshot& that) = delete;
+    DoubleBufferedSnapshot& operator=(const DoubleBufferedSnapshot& that) = delete;
+
+private:
+    struct Slot
+    {
+        mpu::gph::Buffer positions{nullptr};
+        mpu::gph::Buffer smlength{nullptr};
+        mpu::gph::Buffer sinks{nullptr};
+        Info info;
+        GLsync copyFence{nullptr}; //!< signaled when the copy into this slot is complete
+        GLsync drawFence{nullptr}; //!< signaled when the renderer is done using this slot
+    };
+
+    std::mutex m_mutex; //!< protects m_front and m_pending
+    Slot m_slots[2]; //!< the two snapshots
+    int m_front{0}; //!< the slot used by the renderer
+    bool m_pending{false}; //!< true if the back slot contains a snapshot the renderer did not use yet
+};
+
+
+#endif //GRASPH_DOUBLEBUFFEREDSNAPSHOT_H
@@ -0,0 +1,223 @@
+/*
+ * GraSPH
+ * GlassGenerator.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the GlassGenerator class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "GlassGenerator.h"
+#include "PortableRandom.h"
+#include <cmath>
+#include <random>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <experimental/filesystem>
+//--------------------
+
+namespace {
+    constexpr uint32_t GLASS_FILE_MAGIC = 0x32534c47; // "GLS2", the header is magic, number of particles and density noise
+    constexpr int NOISE_CHECK_INTERVAL = 20; // relaxation steps between checking the density noise
+}
+
+// function definitions of the GlassGenerator class
+//-------------------------------------------------------------------
+GlassGenerator::GlassGenerator(std::string cacheDirectory, float tolerance, int maxIterations, float numNeighbours)
+    : m_cacheDirectory(std::move(cacheDirectory)),
+      m_tolerance(tolerance),
+      m_maxIterations(maxIterations),
+      m_numNeighbours(numNeighbours)
+{
+}
+
+std::vector<glm::vec4> GlassGenerator::unitCube(uint32_t numParticles, uint32_t seed)
+{
+    std::vector<glm::vec4> positions;
+    const std::string file = cacheFile(numParticles, seed);
+    if(!file.empty() && load(file, numParticles, positions))
+    {
+        logDEBUG("Glass") << "Loaded glass with " << numParticles << " particles from " << file;
+        return positions;
+    }
+
+    float noise;
+    positions = relax(numParticles, seed, noise);
+
+    // an unconverged glass is still used, but it is not cached so a later run with more iterations can improve it
+    if(!file.empty() && noise < m_tolerance)
+        store(file, positions, noise);
+    return positions;
+}
+
+std::vector<glm::vec4> GlassGenerator::unitSphere(uint32_t numParticles, uint32_t seed)
+{
+    // the sphere inscribed in the unit cube contains pi/6 of the particles, use a bit more so the sphere never touches the border
+    const uint32_t cubeParticles = static_cast<uint32_t>(std::ceil(numParticles * 6.0 / M_PI * 1.1));
+    std::vector<glm::vec4> positions = unitCube(cubeParticles, seed);
+
+    // use the particles closest to the center, so the sphere is filled without holes
+    for(auto &&p : positions)
+        p = glm::vec4(glm::vec3(p) - glm::vec3(0.5f), 0);
+    std::nth_element(positions.begin(), positions.begin() + (numParticles-1), positions.end(),
+                     [](const glm::vec4 &a, const glm::vec4 &b){ return glm::dot(a,a) < glm::dot(b,b);});
+    const float radius = glm::length(positions[numParticles-1]);
+    positions.resize(numParticles);
+
+    for(auto &&p : positions)
+        p /= radius;
+    return positions;
+}
+
+std::vector<glm::vec4> GlassGenerator::relax(uint32_t numParticles, uint32_t seed, float& noise)
+{
+    logDEBUG("Glass") << "Relaxing a glass with " << numParticles << " particles, this may take a while.";
+
+    // the buffers are padded to full work groups
+    const uint32_t paddedSize = (numParticles + GENERAL_WGSIZE - 1) / GENERAL_WGSIZE * GENERAL_WGSIZE;
+
+    std::mt19937 rng(seed);
+    std::vector<glm::vec4> initial(paddedSize, glm::vec4(0));
+    for(uint32_t i = 0; i < numParticles; i++)
+    {
+        // the order of evaluation of function arguments is unspecified, so draw the coordinates one after the other
+        const float x = uniformFloat(rng);
+        const float y = uniformFloat(rng);
+        const float z = uniformFloat(rng);
+        initial[i] = glm::vec4(x, y, z, 0);
+    }
+
+    mpu::gph::Buffer positionBuffer;
+    positionBuffer.allocate(initial);
+    mpu::gph::Buffer velocityBuffer;
+    velocityBuffer.allocate(std::vector<glm::vec4>(paddedSize, glm::vec4(0)));
+    mpu::gph::Buffer densityBuffer;
+    densityBuffer.allocate<float>(paddedSize);
+    positionBuffer.bindBase(GLASS_POSITION_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    velocityBuffer.bindBase(GLASS_VELOCITY_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    densityBuffer.bindBase(GLASS_DENSITY_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+
+    // the mean density is one, choose h so that a sphere of radius h contains the desired number of neighbours
+    const float h = std::cbrt(3.0f * m_numNeighbours / (4.0f * float(M_PI) * numParticles));
+    const float dt = 0.2f * h; // courant criterion with a sound speed of one
+
+    mpu::gph::ShaderProgram densityShader({{PROJECT_SHADER_PATH"Glass/glassDensity.comp"}},{{"WGSIZE",{mpu::toString(GENERAL_WGSIZE)}}});
+    mpu::gph::ShaderProgram forceShader({{PROJECT_SHADER_PATH"Glass/glassForce.comp"}},{{"WGSIZE",{mpu::toString(GENERAL_WGSIZE)}}});
+    mpu::gph::ShaderProgram moveShader({{PROJECT_SHADER_PATH"Glass/glassMove.comp"}});
+    densityShader.uniform1ui("num_of_particles", numParticles);
+    densityShader.uniform1f("smlength", h);
+    forceShader.uniform1ui("num_of_particles", numParticles);
+    forceShader.uniform1f("smlength", h);
+    forceShader.uniform1f("dt", dt);
+    forceShader.uniform1f("damping", 0.1f);
+    moveShader.uniform1ui("num_of_particles", numParticles);
+    moveShader.uniform1f("dt", dt);
+
+    noise = std::numeric_limits<float>::infinity(); // stays infinite if the noise was never measured
+    int iteration = 0;
+    for(; iteration < m_maxIterations; iteration++)
+    {
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        densityShader.dispatch(paddedSize / GENERAL_WGSIZE);
+
+        if(iteration % NOISE_CHECK_INTERVAL == 0)
+        {
+            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+            const std::vector<float> density = densityBuffer.read<float>(numParticles, 0);
+            double sum = 0;
+            double sum2 = 0;
+            for(float rho : density)
+            {
+                sum += rho;
+                sum2 += rho*rho;
+            }
+            const double mean = sum / numParticles;
+            noise = static_cast<float>(std::sqrt(std::max(0.0, sum2 / numParticles - mean*mean)) / mean);
+            logDEBUG("Glass") << "Step " << iteration << ", density noise: " << noise;
+            if(noise < m_tolerance)
+                break;
+        }
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        forceShader.dispatch(paddedSize / GENERAL_WGSIZE);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        moveShader.dispatch(numParticles, GENERAL_WGSIZE);
+    }
+
+    if(noise >= m_tolerance)
+        logWARNING("Glass") << "Glass did not reach the density noise tolerance of " << m_tolerance << " after "
+                            << m_maxIterations << " steps, remaining noise: " << noise;
+    else
+        logDEBUG("Glass") << "Glass relaxed after " << iteration << " steps.";
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    return positionBuffer.read<glm::vec4>(numParticles, 0);
+}
+
+std::string GlassGenerator::cacheFile(uint32_t numParticles, uint32_t seed) const
+{
+    if(m_cacheDirectory.empty())
+        return "";
+    return m_cacheDirectory + "/glass_" + mpu::toString(numParticles) + "_" + mpu::toString(seed) + "_"
+           + mpu::toString(m_numNeighbours) + ".bin";
+}
+
+bool GlassGenerator::load(const std::string& file, uint32_t numParticles, std::vector<glm::vec4>& positions) const
+{
+    std::ifstream in(file, std::ios::binary);
+    if(!in.is_open())
+        return false;
+
+    uint32_t header[2];
+    float noise;
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    in.read(reinterpret_cast<char*>(&noise), sizeof(noise));
+    if(!in || header[0] != GLASS_FILE_MAGIC || header[1] != numParticles)
+    {
+        logWARNING("Glass") << "Cached glass " << file << " is invalid, relaxing again.";
+        return false;
+    }
+
+    if(!(noise < m_tolerance))
+    {
+        logDEBUG("Glass") << "Cached glass " << file << " has a density noise of " << noise << ", which is above the tolerance of "
+                          << m_tolerance << ", relaxing again.";
+        return false;
+    }
+
+    positions.resize(numParticles);
+    in.read(reinterpret_cast<char*>(positions.data()), numParticles * sizeof(glm::vec4));
+    if(!in)
+    {
+        logWARNING("Glass") << "Cached glass " << file << " is truncated, relaxing again.";
+        return false;
+    }
+    return true;
+}
+
+void GlassGenerator::store(const std::string& file, const std::vector<glm::vec4>& positions, float noise) const
+{
+    namespace fs = std::experimental::filesystem;
+    std::error_code ec;
+    fs::create_directories(m_cacheDirectory, ec);
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if(!out.is_open())
+    {
+        logWARNING("Glass") << "Could not write glass to " << file;
+        return;
+    }
+
+    const uint32_t header[2] = {GLASS_FILE_MAGIC, static_cast<uint32_t>(positions.size())};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&noise), sizeof(noise));
+    out.write(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(glm::vec4));
+    logDEBUG("Glass") << "Stored glass in " << file;
+}
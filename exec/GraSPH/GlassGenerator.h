@@ -0,0 +1,62 @@
+/*
+ * GraSPH
+ * GlassGenerator.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the GlassGenerator class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_GLASSGENERATOR_H
+#define GRASPH_GLASSGENERATOR_H
+
+// includes
+//--------------------
+#include <string>
+#include <vector>
+#include <Graphics/Graphics.h>
+#include <Log/Log.h>
+#include "Common.h"
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class GlassGenerator
+ *
+ * usage:
+ * Creates glass like particle distributions in the periodic unit cube [0,1)^3. Random positions are relaxed using damped
+ * SPH with an isothermal equation of state until the rms of the relative density fluctuations drops below "tolerance"
+ * or "maxIterations" steps where performed. Call unitCube() to get a glass with a given number of particles.
+ * Relaxed glasses are stored in "cacheDirectory" in a file whose name contains the number of particles, the seed
+ * and the number of neighbours. The density noise the glass reached is stored in the file and a cached glass is only
+ * used if it is below the tolerance. Glasses that did not reach the tolerance within maxIterations are not cached.
+ * Pass an empty directory to disable the cache.
+ * The relaxation binds its own buffers at the GLASS_*_BUFFER_BINDING points.
+ *
+ */
+class GlassGenerator
+{
+public:
+    GlassGenerator(std::string cacheDirectory, float tolerance, int maxIterations, float numNeighbours = 50); //!< set the parameters, no shader is compiled yet
+
+    std::vector<glm::vec4> unitCube(uint32_t numParticles, uint32_t seed); //!< returns a relaxed glass with numParticles particles in the unit cube, w is zero
+    std::vector<glm::vec4> unitSphere(uint32_t numParticles, uint32_t seed); //!< carves numParticles particles out of a bigger glass and scales them into a sphere with radius 1
+
+private:
+    std::vector<glm::vec4> relax(uint32_t numParticles, uint32_t seed, float& noise); //!< runs the relaxation on the gpu, noise is set to the density noise reached
+    std::string cacheFile(uint32_t numParticles, uint32_t seed) const; //!< file name used to store a glass
+    bool load(const std::string& file, uint32_t numParticles, std::vector<glm::vec4>& positions) const; //!< load from cache, returns false if it does not exist or does not match
+    void store(const std::string& file, const std::vector<glm::vec4>& positions, float noise) const; //!< store in cache
+
+    std::string m_cacheDirectory; //!< where glasses are cached, cache is disabled if empty
+    float m_tolerance; //!< rms of the relative density fluctuations at which the relaxation stops
+    int m_maxIterations; //!< maximum number of relaxation steps
+    float m_numNeighbours; //!< the number of neighbours used to choose the smoothing length
+};
+
+
+#endif //GRASPH_GLASSGENERATOR_H
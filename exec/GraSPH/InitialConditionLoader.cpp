@@ -0,0 +1,117 @@
+/*
+ * GraSPH
+ * InitialConditionLoader.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the InitialConditionLoader class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "InitialConditionLoader.h"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+//--------------------
+
+namespace {
+    constexpr uint32_t MAX_RECORD_FLOATS = 8; // the staging slots are big enough for records that contain h
+    constexpr GLbitfield STAGING_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+// function definitions of the InitialConditionLoader class
+//-------------------------------------------------------------------
+InitialConditionLoader::InitialConditionLoader(uint32_t chunkSize, uint32_t numSlots)
+    : m_unpackShader({{PROJECT_SHADER_PATH"ParticleSpawner/unpackInitialConditions.comp"}}),
+      m_stagingBuffer(intptr_t(chunkSize) * MAX_RECORD_FLOATS * numSlots * sizeof(float), STAGING_FLAGS),
+      m_stagingMap(m_stagingBuffer.map<float>(intptr_t(chunkSize) * MAX_RECORD_FLOATS * numSlots, 0, STAGING_FLAGS)),
+      m_slotFences(numSlots, nullptr),
+      m_chunkSize(chunkSize),
+      m_numSlots(numSlots)
+{
+    assert_critical(chunkSize > 0 && numSlots > 0, "InitialConditionLoader", "Chunk size and number of slots need to be bigger than zero.");
+}
+
+uint32_t InitialConditionLoader::load(ParticleBuffer buffer, const std::string& file, float defaultSmlength)
+{
+    std::ifstream in(file, std::ios::binary);
+    if(!in.is_open())
+    {
+        logERROR("InitialConditionLoader") << "Could not open initial condition file " << file;
+        throw std::runtime_error("Could not open initial condition file: " + file);
+    }
+
+    InitialConditionHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(!in || std::strncmp(header.magic, "GICF", 4) != 0 || header.version != 1)
+    {
+        logERROR("InitialConditionLoader") << "File " << file << " is not a valid initial condition file.";
+        throw std::runtime_error("Invalid initial condition file: " + file);
+    }
+
+    uint32_t numParticles = static_cast<uint32_t>(std::min<uint64_t>(header.numParticles, buffer.size()));
+    if(numParticles < header.numParticles)
+        logWARNING("InitialConditionLoader") << "File " << file << " contains " << header.numParticles
+                                             << " particles, but the buffer only has room for " << numParticles;
+
+    const uint32_t recordFloats = header.hasSmlength ? 8 : 7;
+    logDEBUG("InitialConditionLoader") << "Loading " << numParticles << " particles from " << file
+                                       << (header.hasSmlength ? " with" : " without") << " smoothing length.";
+
+    buffer.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_stagingBuffer.bindBase(IC_STAGING_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+
+    m_unpackShader.uniform1ui("record_stride", recordFloats);
+    m_unpackShader.uniform1ui("buffer_size", buffer.size());
+    m_unpackShader.uniform1f("default_smlength", defaultSmlength);
+    m_unpackShader.uniform1ui("accMulti", buffer.accPerParticle());
+    m_unpackShader.uniform1ui("hydMulti", buffer.hydPerParticle());
+
+    // read the next chunk into a free slot while the gpu unpacks the previous ones
+    uint32_t loaded = 0;
+    for(uint32_t slot = 0; loaded < numParticles; slot = (slot+1) % m_numSlots)
+    {
+        const uint32_t count = std::min(m_chunkSize, numParticles - loaded);
+        const uint32_t slotOffset = slot * m_chunkSize * MAX_RECORD_FLOATS;
+
+        waitForSlot(slot);
+        in.read(reinterpret_cast<char*>(&m_stagingMap[slotOffset]), std::streamsize(count) * recordFloats * sizeof(float));
+        if(!in)
+        {
+            logERROR("InitialConditionLoader") << "File " << file << " ended after " << loaded << " particles.";
+            numParticles = loaded;
+            break;
+        }
+
+        m_unpackShader.uniform1ui("num_of_particles", count);
+        m_unpackShader.uniform1ui("particle_offset", loaded);
+        m_unpackShader.uniform1ui("slot_offset", slotOffset);
+        m_unpackShader.dispatch(count, GENERAL_WGSIZE);
+        m_slotFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        loaded += count;
+    }
+
+    // the staging buffer might be reused, so all slots must be free when we return
+    for(uint32_t slot = 0; slot < m_numSlots; slot++)
+        waitForSlot(slot);
+
+    buffer.setActiveSize(numParticles);
+    logDEBUG("InitialConditionLoader") << "Loaded " << numParticles << " particles.";
+    return numParticles;
+}
+
+void InitialConditionLoader::waitForSlot(uint32_t slot)
+{
+    if(!m_slotFences[slot])
+        return;
+
+    while(glClientWaitSync(m_slotFences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(m_slotFences[slot]);
+    m_slotFences[slot] = nullptr;
+}
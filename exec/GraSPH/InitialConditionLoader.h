@@ -0,0 +1,78 @@
+/*
+ * GraSPH
+ * InitialConditionLoader.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the InitialConditionLoader class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_INITIALCONDITIONLOADER_H
+#define GRASPH_INITIALCONDITIONLOADER_H
+
+// includes
+//--------------------
+#include <string>
+#include <vector>
+#include <Graphics/Graphics.h>
+#include <Log/Log.h>
+#include "Common.h"
+#include "ParticleBuffer.h"
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * struct InitialConditionHeader
+ *
+ * Header of a binary initial condition file. It is followed by numParticles records of 7 floats
+ * (x, y, z, mass, vx, vy, vz) or 8 floats if hasSmlength is not zero (x, y, z, mass, vx, vy, vz, h).
+ * All values are stored in native byte order.
+ */
+struct InitialConditionHeader
+{
+    char magic[4]; // "GICF"
+    uint32_t version; // currently 1
+    uint64_t numParticles; // number of particle records in the file
+    uint32_t hasSmlength; // non zero if every record contains a smoothing length
+    uint32_t padding;
+};
+
+//-------------------------------------------------------------------
+/**
+ * class InitialConditionLoader
+ *
+ * usage:
+ * Loads particles from a binary initial condition file (see InitialConditionHeader) into a ParticleBuffer.
+ * The file is read in chunks of "chunkSize" particles directly into a persistently mapped staging buffer with "numSlots" slots.
+ * A shader then unpacks each chunk into the particle buffer while the next chunk is read into the next slot, so
+ * the file never needs to fit into host memory. Accelerations, hydro values and timesteps are set to zero, if the file contains
+ * no smoothing length the default one is used.
+ * Call load() to fill the buffer, it will set the active size to the number of particles in the file.
+ * Remember to sync memory after loading (glMemoryBarrier(...))!
+ *
+ */
+class InitialConditionLoader
+{
+public:
+    explicit InitialConditionLoader(uint32_t chunkSize = 65536, uint32_t numSlots = 3); //!< compiles the shader and allocates and maps the staging buffer
+
+    uint32_t load(ParticleBuffer buffer, const std::string& file, float defaultSmlength); //!< load particles from file into buffer, returns the number of particles loaded
+
+private:
+    void waitForSlot(uint32_t slot); //!< waits until the gpu is done reading from slot
+
+    mpu::gph::ShaderProgram m_unpackShader; //!< writes particles from the staging buffer into the particle buffer
+    mpu::gph::Buffer m_stagingBuffer; //!< persistently mapped buffer the file is read into
+    mpu::gph::BufferMap<float> m_stagingMap; //!< persistent mapping of the staging buffer
+    std::vector<GLsync> m_slotFences; //!< signaled when the gpu finished reading from a slot
+
+    uint32_t m_chunkSize; //!< number of particles per slot
+    uint32_t m_numSlots; //!< number of slots in the staging buffer
+};
+
+
+#endif //GRASPH_INITIALCONDITIONLOADER_H
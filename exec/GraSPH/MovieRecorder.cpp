@@ -0,0 +1,301 @@
+/*
+ * GraSPH
+ * MovieRecorder.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the MovieRecorder class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "MovieRecorder.h"
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <array>
+#include <experimental/filesystem>
+//--------------------
+
+// png encoding
+//-------------------------------------------------------------------
+namespace {
+
+    uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0)
+    {
+        static const std::array<uint32_t,256> table = []()
+        {
+            std::array<uint32_t,256> t{};
+            for(uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for(int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[n] = c;
+            }
+            return t;
+        }();
+
+        crc = ~crc;
+        for(size_t i = 0; i < length; i++)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void appendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(uint8_t(value >> 24));
+        out.push_back(uint8_t(value >> 16));
+        out.push_back(uint8_t(value >> 8));
+        out.push_back(uint8_t(value));
+    }
+
+    void appendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+    {
+        appendBigEndian(out, static_cast<uint32_t>(data.size()));
+        const size_t typeStart = out.size();
+        out.insert(out.end(), type, type+4);
+        out.insert(out.end(), data.begin(), data.end());
+        appendBigEndian(out, crc32(&out[typeStart], data.size() + 4));
+    }
+
+    // encodes rgba pixels (bottom row first, as openGL returns them) into a png using stored (uncompressed) deflate blocks
+    std::vector<uint8_t> encodePng(const std::vector<uint8_t>& pixels, glm::uvec2 size)
+    {
+        const size_t rowBytes = size_t(size.x) * 4;
+
+        // scanlines with filter type 0, top row first
+        std::vector<uint8_t> raw;
+        raw.reserve((rowBytes+1) * size.y);
+        for(uint32_t y = 0; y < size.y; y++)
+        {
+            raw.push_back(0);
+            const auto row = pixels.begin() + (size.y-1-y) * rowBytes;
+            raw.insert(raw.end(), row, row + rowBytes);
+        }
+
+        // zlib stream of stored blocks
+        std::vector<uint8_t> zlib{0x78, 0x01};
+        zlib.reserve(raw.size() + raw.size()/65535*5 + 16);
+        for(size_t pos = 0; pos < raw.size() || pos == 0; )
+        {
+            const size_t length = std::min(raw.size() - pos, size_t(65535));
+            const bool last = (pos + length == raw.size());
+            zlib.push_back(last ? 1 : 0);
+            zlib.push_back(uint8_t(length));
+            zlib.push_back(uint8_t(length >> 8));
+            zlib.push_back(uint8_t(~length));
+            zlib.push_back(uint8_t(~length >> 8));
+            zlib.insert(zlib.end(), raw.begin()+pos, raw.begin()+pos+length);
+            pos += length;
+            if(last)
+                break;
+        }
+
+        uint32_t a = 1, b = 0;
+        for(uint8_t byte : raw)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        appendBigEndian(zlib, (b << 16) | a);
+
+        std::vector<uint8_t> header;
+        appendBigEndian(header, size.x);
+        appendBigEndian(header, size.y);
+        header.insert(header.end(), {8, 6, 0, 0, 0}); // 8 bit rgba, deflate, no filter, no interlace
+
+        std::vector<uint8_t> png{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        appendChunk(png, "IHDR", header);
+        appendChunk(png, "IDAT", zlib);
+        appendChunk(png, "IEND", {});
+        return png;
+    }
+}
+
+// function definitions of the MovieRecorder class
+//-------------------------------------------------------------------
+MovieRecorder::MovieRecorder(std::string directory, glm::uvec2 resolution, FrameFormat format, int ringSize, int numThreads)
+    : m_directory(std::move(directory)),
+      m_resolution(resolution),
+      m_format(format),
+      m_frameBytes(size_t(resolution.x) * resolution.y * 4),
+      m_color(GL_TEXTURE_2D),
+      m_depth(GL_TEXTURE_2D),
+      m_ring(static_cast<size_t>(std::max(ringSize,1))),
+      m_maxQueued(static_cast<size_t>(4*std::max(numThreads,1)))
+{
+    namespace fs = std::experimental::filesystem;
+    std::error_code ec;
+    fs::create_directories(m_directory, ec);
+    if(ec)
+    {
+        logERROR("Movie") << "Could not create movie directory " << m_directory << ": " << ec.message();
+        throw std::runtime_error("Could not create movie directory.");
+    }
+
+    m_color.allocate2D(GL_RGBA8, m_resolution);
+    m_depth.allocate2D(GL_DEPTH_COMPONENT24, m_resolution);
+    m_framebuffer.attach(GL_COLOR_ATTACHMENT0, m_color);
+    m_framebuffer.attach(GL_DEPTH_ATTACHMENT, m_depth);
+    if(!m_framebuffer.isComplete())
+    {
+        logERROR("Movie") << "Could not create the offscreen framebuffer.";
+        throw std::runtime_error("Movie framebuffer incomplete.");
+    }
+
+    for(Slot& slot : m_ring)
+    {
+        slot.pbo.recreate();
+        slot.pbo.allocate<uint8_t>(m_frameBytes, GL_MAP_READ_BIT);
+    }
+
+    for(int i = 0; i < std::max(numThreads,1); i++)
+        m_workers.emplace_back(&MovieRecorder::worker, this);
+
+    logINFO("Movie") << "Recording " << m_resolution.x << "x" << m_resolution.y << " frames to " << m_directory
+                     << ((m_format == FrameFormat::PNG) ? " as png." : " as raw rgba.");
+}
+
+MovieRecorder::~MovieRecorder()
+{
+    finish();
+}
+
+void MovieRecorder::bind() const
+{
+    m_framebuffer.bind();
+    glViewport(0, 0, m_resolution.x, m_resolution.y);
+}
+
+void MovieRecorder::unbind(glm::uvec2 viewport) const
+{
+    mpu::gph::Framebuffer::unbind();
+    glViewport(0, 0, viewport.x, viewport.y);
+}
+
+void MovieRecorder::capture()
+{
+    // after finish() there are no workers left to write the frame, collecting it would block forever
+    if(m_workers.empty())
+    {
+        logWARNING("Movie") << "capture() called after finish(), the frame is ignored.";
+        return;
+    }
+
+    Slot& slot = m_ring[m_nextFrame % m_ring.size()];
+    if(slot.fence)
+        collect(slot);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTextureImage(m_color, 0, GL_RGBA, GL_UNSIGNED_BYTE, static_cast<GLsizei>(m_frameBytes), nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = m_nextFrame++;
+}
+
+void MovieRecorder::blitToScreen(glm::uvec2 windowSize) const
+{
+    // fit the frame into the window without distortion
+    const float scale = std::min(float(windowSize.x) / m_resolution.x, float(windowSize.y) / m_resolution.y);
+    const glm::ivec2 size = glm::ivec2(glm::vec2(m_resolution) * scale);
+    const glm::ivec2 offset = (glm::ivec2(windowSize) - size) / 2;
+    glBlitNamedFramebuffer(m_framebuffer, 0, 0, 0, m_resolution.x, m_resolution.y,
+                           offset.x, offset.y, offset.x + size.x, offset.y + size.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+}
+
+void MovieRecorder::finish()
+{
+    // collect outstanding frames in order
+    for(uint64_t i = 0; i < m_ring.size(); i++)
+    {
+        Slot& slot = m_ring[(m_nextFrame + i) % m_ring.size()];
+        if(slot.fence)
+            collect(slot);
+    }
+
+    {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        m_stop = true;
+    }
+    m_queueChanged.notify_all();
+    for(auto& worker : m_workers)
+        if(worker.joinable())
+            worker.join();
+    m_workers.clear();
+}
+
+void MovieRecorder::collect(Slot& slot)
+{
+    // this is ringSize frames old, so the copy is normally done already
+    if(glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+    {
+        logDEBUG("Movie") << "Waiting for readback of frame " << slot.frame;
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    Frame frame{slot.frame, std::vector<uint8_t>(m_frameBytes)};
+    {
+        auto map = slot.pbo.map<uint8_t>(m_frameBytes, 0, GL_MAP_READ_BIT);
+        std::copy(map.begin(), map.end(), frame.pixels.begin());
+    }
+
+    std::unique_lock<std::mutex> lck(m_mutex);
+    m_queueChanged.wait(lck, [this](){return m_queue.size() < m_maxQueued;});
+    m_queue.push_back(std::move(frame));
+    lck.unlock();
+    m_queueChanged.notify_all();
+}
+
+void MovieRecorder::worker()
+{
+    while(true)
+    {
+        std::unique_lock<std::mutex> lck(m_mutex);
+        m_queueChanged.wait(lck, [this](){return m_stop || !m_queue.empty();});
+        if(m_queue.empty())
+            return;
+
+        Frame frame = std::move(m_queue.front());
+        m_queue.pop_front();
+        lck.unlock();
+        m_queueChanged.notify_all();
+
+        writeFrame(frame);
+    }
+}
+
+void MovieRecorder::writeFrame(const Frame& frame) const
+{
+    std::ostringstream name;
+    name << m_directory << "/frame_" << std::setw(6) << std::setfill('0') << frame.number
+         << ((m_format == FrameFormat::PNG) ? ".png" : ".rgba");
+
+    std::ofstream out(name.str(), std::ios::binary | std::ios::trunc);
+    if(!out.is_open())
+    {
+        logWARNING("Movie") << "Could not write frame " << name.str();
+        return;
+    }
+
+    if(m_format == FrameFormat::PNG)
+    {
+        const std::vector<uint8_t> png = encodePng(frame.pixels, m_resolution);
+        out.write(reinterpret_cast<const char*>(png.data()), png.size());
+    }
+    else
+    {
+        // top row first, like the png
+        const size_t rowBytes = size_t(m_resolution.x) * 4;
+        for(uint32_t y = 0; y < m_resolution.y; y++)
+            out.write(reinterpret_cast<const char*>(&frame.pixels[(m_resolution.y-1-y) * rowBytes]), rowBytes);
+    }
+}
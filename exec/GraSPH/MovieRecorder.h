@@ -0,0 +1,108 @@
+/*
+ * GraSPH
+ * MovieRecorder.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the MovieRecorder class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_MOVIERECORDER_H
+#define GRASPH_MOVIERECORDER_H
+
+// includes
+//--------------------
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <Graphics/Graphics.h>
+#include <Log/Log.h>
+//--------------------
+
+enum class FrameFormat
+{
+    PNG, //!< uncompressed png, readable by every tool
+    RAW //!< raw rgba bytes, top row first. Use with eg. ffmpeg -f rawvideo -pix_fmt rgba -s WxH
+};
+
+//-------------------------------------------------------------------
+/**
+ * class MovieRecorder
+ *
+ * usage:
+ * Renders into an offscreen framebuffer of arbitrary resolution and writes frames to an image sequence in "directory".
+ * Call bind() before drawing a frame, then capture() to store it and unbind() to switch back to the default framebuffer.
+ * blitToScreen() can be used to show a preview in the window. The window may also be hidden, nothing is read from it.
+ *
+ * capture() starts an asynchronous copy into one pixel buffer object of a ring and places a fence. The buffer is only
+ * mapped when it comes up again "ringSize" frames later, so readback never waits for the gpu in the normal case.
+ * Encoding and writing the files happens on "numThreads" worker threads. If they fall behind by more than
+ * a few frames capture() waits for them, so memory use stays bounded.
+ * Call finish() (or destroy the recorder) to write all outstanding frames, the openGL context needs to be current.
+ * Frames captured after finish() are ignored.
+ *
+ */
+class MovieRecorder
+{
+public:
+    MovieRecorder(std::string directory, glm::uvec2 resolution, FrameFormat format, int ringSize=3, int numThreads=2);
+    ~MovieRecorder();
+
+    MovieRecorder(const MovieRecorder& other) = delete;
+    MovieRecorder& operator=(const MovieRecorder& other) = delete;
+
+    void bind() const; //!< render into the offscreen framebuffer, sets the viewport to the movie resolution
+    void unbind(glm::uvec2 viewport) const; //!< switch back to the default framebuffer and set "viewport"
+    void capture(); //!< store the current content of the framebuffer as the next frame
+    void blitToScreen(glm::uvec2 windowSize) const; //!< draw the last frame into the default framebuffer, keeps the aspect ratio
+    void finish(); //!< writes all outstanding frames, blocks until done
+
+    glm::uvec2 resolution() const {return m_resolution;} //!< resolution of the movie
+    uint64_t framesCaptured() const {return m_nextFrame;} //!< number of frames captured so far
+
+private:
+    struct Slot
+    {
+        mpu::gph::Buffer pbo{nullptr};
+        GLsync fence{nullptr};
+        uint64_t frame{0};
+    };
+
+    struct Frame
+    {
+        uint64_t number;
+        std::vector<uint8_t> pixels;
+    };
+
+    void collect(Slot& slot); //!< waits for the slot, copies the pixels and hands them to the workers
+    void worker(); //!< encodes and writes frames until the queue is empty and m_stop is set
+    void writeFrame(const Frame& frame) const; //!< writes a single frame to disk
+
+    std::string m_directory;
+    glm::uvec2 m_resolution;
+    FrameFormat m_format;
+    size_t m_frameBytes;
+
+    mpu::gph::Texture m_color;
+    mpu::gph::Texture m_depth;
+    mpu::gph::Framebuffer m_framebuffer;
+
+    std::vector<Slot> m_ring;
+    uint64_t m_nextFrame{0};
+
+    std::vector<std::thread> m_workers;
+    std::deque<Frame> m_queue;
+    size_t m_maxQueued;
+    std::mutex m_mutex;
+    std::condition_variable m_queueChanged;
+    bool m_stop{false};
+};
+
+#endif //GRASPH_MOVIERECORDER_H
@@ -47,11 +47,18 @@ void ParticleBuffer::reallocateAll(uint32_t numParticles, uint32_t accMulti, uin
     }
 
     m_numberOfParticles=numParticles;
+    *m_activeParticles = numParticles;
     m_accMulti = accMulti;
     m_hydMulti = hydroMulti;
     m_balsara = balsara;
 }
 
+void ParticleBuffer::setActiveSize(uint32_t numParticles)
+{
+    assert_true(numParticles <= m_numberOfParticles, "ParticleBuffer", "More active particles than the buffer can store.");
+    *m_activeParticles = numParticles;
+}
+
 void ParticleBuffer::bindAll(uint32_t binding, GLenum target)
 {
     positionBuffer.bindBase(binding,target);
@@ -61,4 +68,28 @@ void ParticleBuffer::bindAll(uint32_t binding, GLenum target)
     smlengthBuffer.bindBase(binding+4,target);
     timestepBuffer.bindBase(binding+5,target);
     balsaraBuffer.bindBase(binding+6,target);
-}
\ No newline at end of file
+}
+uint64_t ParticleBuffer::checksum()
+{
+    // 64 bit FNV-1a over the raw bytes
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const void* data, size_t bytes)
+    {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for(size_t i = 0; i < bytes; i++)
+        {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    const uint32_t n = activeSize();
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    const auto positions = positionBuffer.read<posType>(n,0);
+    const auto velocities = velocityBuffer.read<velType>(n,0);
+    const auto smlength = smlengthBuffer.read<smlengthType>(n,0);
+    add(positions.data(), positions.size() * sizeof(posType));
+    add(velocities.data(), velocities.size() * sizeof(velType));
+    add(smlength.data(), smlength.size() * sizeof(smlengthType));
+    return hash;
+}
@@ -16,6 +16,7 @@
 
 // includes
 //--------------------
+#include <memory>
 #include <Graphics/Graphics.h>
 //--------------------
 
@@ -25,6 +26,8 @@
  *
  * @brief ParticleBuffer contains a set of openGL buffers that contain all the particle attributes
  * size is only updated when reallocate all is used.
+ * Only the first activeSize() particles are alive and part of the simulation. The active size is shared between all copies
+ * of a ParticleBuffer, just like the openGL buffers themselves. Use setActiveSize() after particles were removed.
  */
 class ParticleBuffer
 {
@@ -45,9 +48,12 @@ public:
 
 
     uint32_t size(){ return m_numberOfParticles;} //!< returns the number of particles
+    uint32_t activeSize() const { return *m_activeParticles;} //!< returns the number of particles that are currently alive
+    void setActiveSize(uint32_t numParticles); //!< set the number of alive particles, those are expected to be stored at the beginning of the buffer
     uint32_t accPerParticle(){ return m_accMulti;} //!< returns the number of different accelerations that can be stored per particle (actually one more acceleration per particle can be stored to allow storing of the acceleration at t-1)
     uint32_t hydPerParticle(){ return m_hydMulti;} //!< returns the number of different hydro states that can be stored per particle
     bool hasBalsara(){ return m_balsara;} //!< returns true if this buffer contains a balsara buffer
+    uint64_t checksum(); //!< hash of the positions, velocities and smoothing lengths of all active particles, reads from the gpu
 
     mpu::gph::Buffer positionBuffer;
     mpu::gph::Buffer velocityBuffer;
@@ -58,6 +64,7 @@ public:
     mpu::gph::Buffer balsaraBuffer;
 private:
     uint32_t m_numberOfParticles;
+    std::shared_ptr<uint32_t> m_activeParticles{std::make_shared<uint32_t>(0)}; //!< number of alive particles, shared by all copies
     uint32_t m_accMulti;
     uint32_t m_hydMulti;
     bool m_balsara;
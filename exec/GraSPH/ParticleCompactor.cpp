@@ -0,0 +1,99 @@
+/*
+ * GraSPH
+ * ParticleCompactor.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the ParticleCompactor class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "ParticleCompactor.h"
+//--------------------
+
+// function definitions of the ParticleCompactor class
+//-------------------------------------------------------------------
+ParticleCompactor::ParticleCompactor(ParticleBuffer buffer)
+    : m_prepareShader({{PROJECT_SHADER_PATH"ParticleCompactor/prepareCompaction.comp"}},
+                      {
+                              {"NUM_PARTICLES",{mpu::toString(buffer.size())}},
+                              {"WGSIZE",{mpu::toString(GENERAL_WGSIZE)}}
+                      }),
+      m_findHolesShader({{PROJECT_SHADER_PATH"ParticleCompactor/findHoles.comp"}},
+                        {
+                                {"NUM_PARTICLES",{mpu::toString(buffer.size())}},
+                                {"WGSIZE",{mpu::toString(GENERAL_WGSIZE)}}
+                        }),
+      m_moveParticlesShader({{PROJECT_SHADER_PATH"ParticleCompactor/moveParticles.comp"}},
+                            {
+                                    {"NUM_PARTICLES",{mpu::toString(buffer.size())}},
+                                    {"WGSIZE",{mpu::toString(GENERAL_WGSIZE)}}
+                            }),
+      m_particleBuffer(buffer)
+{
+    // counters and dispatch arguments followed by a list of holes and a list of particles to be moved
+    m_controlBuffer.recreate();
+    m_controlBuffer.allocate(std::vector<uint32_t>(controlHeaderSize + 2*buffer.size(), 0), GL_DYNAMIC_STORAGE_BIT);
+    m_counterReadback.recreate();
+    m_counterReadback.allocate<uint32_t>(numCounters, GL_MAP_READ_BIT);
+    bind();
+}
+
+void ParticleCompactor::bind()
+{
+    m_controlBuffer.bindBase(PARTICLE_CONTROL_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+}
+
+void ParticleCompactor::compact()
+{
+    // the active size of the last compaction is needed here
+    synchronize();
+
+    m_prepareShader.uniform1ui("num_of_particles", m_particleBuffer.activeSize());
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_prepareShader.dispatch(1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_controlBuffer);
+    m_findHolesShader.dispatchIndirect(findHolesDispatchOffset);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_moveParticlesShader.dispatchIndirect(moveParticlesDispatchOffset);
+
+    // copy the counters for synchronize() and reset them for the next time
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_controlBuffer.copyTo<uint32_t>(m_counterReadback, numCounters);
+    m_controlBuffer.write(std::vector<uint32_t>({0,0}));
+    m_fence.reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), glDeleteSync);
+}
+
+uint32_t ParticleCompactor::synchronize()
+{
+    if(!m_fence)
+        return 0;
+
+    while(glClientWaitSync(m_fence.get(), GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+    m_fence.reset();
+
+    // removed, added, holes, movers, size before and after removing
+    const std::vector<uint32_t> counter = m_counterReadback.read<uint32_t>(numCounters,0);
+    const uint32_t removed = counter[0];
+    if(removed == 0 && counter[1] == 0)
+        return 0;
+
+    // the added counter might be bigger then the free space, those particles where not actually added
+    const uint32_t added = counter[4] - m_particleBuffer.activeSize();
+    if(added < counter[1])
+        logDEBUG("ParticleCompactor") << "Particle buffer is full, " << counter[1] - added << " particles could not be added.";
+
+    assert_true(removed <= counter[4], "ParticleCompactor", "More particles removed than there are particles alive.");
+    const uint32_t newSize = counter[5];
+
+    m_particleBuffer.setActiveSize(newSize);
+    logDEBUG("ParticleCompactor") << "Added " << added << " and removed " << removed << " particles, " << newSize << " particles alive.";
+    return removed;
+}
@@ -0,0 +1,68 @@
+/*
+ * GraSPH
+ * ParticleCompactor.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the ParticleCompactor class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_PARTICLECOMPACTOR_H
+#define GRASPH_PARTICLECOMPACTOR_H
+
+// includes
+//--------------------
+#include <Graphics/Graphics.h>
+#include <Log/Log.h>
+#include "Common.h"
+#include "ParticleBuffer.h"
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class ParticleCompactor
+ *
+ * usage:
+ * Removes particles from a ParticleBuffer. Shaders remove a particle by setting its mass to zero and increasing the
+ * removed_particles counter in the control buffer bound at PARTICLE_CONTROL_BUFFER_BINDING.
+ * Shaders can also append particles behind the active particles. They need to increase the added_particles counter
+ * (the second value in the control buffer) and only write to the slot they got, if it is inside of the buffer.
+ * Call compact() afterwards to move the remaining particles to the front of the buffer. The counters stay on the gpu,
+ * the compaction passes use indirect dispatch. The new number of particles is read back asynchronously, call synchronize()
+ * before the active size of the particle buffer is used again. It waits for the gpu, so call it where the cpu waits anyway,
+ * eg right before other results of the step are read, so the gpu is only drained once per step.
+ * The order of the particles is not preserved.
+ *
+ */
+class ParticleCompactor
+{
+public:
+    ParticleCompactor() = default;
+    explicit ParticleCompactor(ParticleBuffer buffer); //!< compile shader and create the control buffer to compact "buffer"
+
+    void bind(); //!< bind the control buffer to PARTICLE_CONTROL_BUFFER_BINDING
+    void compact(); //!< add appended particles and remove all flagged particles on the gpu
+    uint32_t synchronize(); //!< wait for the last compact(), update the active size of the buffer and return the number of removed particles
+
+private:
+    static constexpr uint32_t numCounters = 6; //!< number of counters in front of the dispatch arguments
+    static constexpr GLintptr findHolesDispatchOffset = numCounters * sizeof(uint32_t); //!< byte offset of the dispatch arguments in the control buffer
+    static constexpr GLintptr moveParticlesDispatchOffset = findHolesDispatchOffset + 3*sizeof(uint32_t);
+    static constexpr uint32_t controlHeaderSize = numCounters + 6; //!< number of uints in front of the index lists
+
+    mpu::gph::ShaderProgram m_prepareShader; //!< computes the new size and the dispatch arguments
+    mpu::gph::ShaderProgram m_findHolesShader; //!< finds removed particles and the particles that will be moved
+    mpu::gph::ShaderProgram m_moveParticlesShader; //!< moves particles into the holes
+
+    mpu::gph::Buffer m_controlBuffer{nullptr}; //!< counter, dispatch arguments and lists of indices used for compacting
+    mpu::gph::Buffer m_counterReadback{nullptr}; //!< the counters are copied here to be read by synchronize()
+    std::shared_ptr<std::remove_pointer_t<GLsync>> m_fence; //!< signaled when the last compaction is done
+    ParticleBuffer m_particleBuffer; //!< the buffer to be compacted
+};
+
+
+#endif //GRASPH_PARTICLECOMPACTOR_H
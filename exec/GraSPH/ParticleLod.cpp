@@ -0,0 +1,125 @@
+/*
+ * GraSPH
+ * ParticleLod.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the ParticleLod class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "ParticleLod.h"
+//--------------------
+
+// function definitions of the ParticleLod class
+//-------------------------------------------------------------------
+ParticleLod::ParticleLod(uint32_t levels)
+    : m_levels(levels),
+      m_numCells(((1u << (3*levels)) - 1) / 7),
+      m_boundsShader({{PROJECT_SHADER_PATH"ParticleLod/lodBounds.comp"}}),
+      m_accumulateShader({{PROJECT_SHADER_PATH"ParticleLod/lodAccumulate.comp"}}),
+      m_reduceShader({{PROJECT_SHADER_PATH"ParticleLod/lodReduce.comp"}}),
+      m_selectNodesShader({{PROJECT_SHADER_PATH"ParticleLod/lodSelectNodes.comp"}}),
+      m_selectParticlesShader({{PROJECT_SHADER_PATH"ParticleLod/lodSelectParticles.comp"}})
+{
+    assert_critical(levels > 0 && levels <= 9, "LOD", "Number of LOD levels needs to be between 1 and 9.");
+
+    m_cells.allocate<glm::vec4>(2*m_numCells);
+    m_bounds.allocate<glm::uvec4>(2, GL_DYNAMIC_STORAGE_BIT);
+    m_nodes.allocate<glm::vec4>(m_numCells);
+    m_nodeRadius.allocate<float>(m_numCells);
+    m_commands.allocate<uint32_t>(9, GL_DYNAMIC_STORAGE_BIT);
+
+    m_accumulateShader.uniform1ui("finest_level", m_levels-1);
+    m_selectNodesShader.uniform1ui("finest_level", m_levels-1);
+    m_selectParticlesShader.uniform1ui("finest_level", m_levels-1);
+
+    logDEBUG("LOD") << "Created LOD hierarchy with " << m_levels << " levels and " << m_numCells << " cells.";
+}
+
+void ParticleLod::bindBuffers()
+{
+    m_cells.bindBase(LOD_CELL_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_bounds.bindBase(LOD_BOUNDS_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_nodes.bindBase(LOD_NODE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_nodeRadius.bindBase(LOD_NODE_RADIUS_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_commands.bindBase(LOD_COMMAND_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    if(m_particleIndices)
+        m_particleIndices.bindBase(LOD_INDEX_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+}
+
+void ParticleLod::build(mpu::gph::Buffer positions, uint32_t numParticles)
+{
+    if(numParticles == 0)
+        return;
+
+    bindBuffers();
+    positions.bindBase(PARTICLE_POSITION_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+
+    // bounding box
+    m_bounds.write(std::vector<glm::uvec4>{glm::uvec4(0xFFFFFFFF), glm::uvec4(0)});
+    m_boundsShader.uniform1ui("num_of_particles", numParticles);
+    m_boundsShader.dispatch(numParticles, GENERAL_WGSIZE);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // finest level
+    glClearNamedBufferData(m_cells, GL_R32F, GL_RED, GL_FLOAT, nullptr);
+    m_accumulateShader.uniform1ui("num_of_particles", numParticles);
+    m_accumulateShader.dispatch(numParticles, GENERAL_WGSIZE);
+
+    // all other levels
+    for(int level = int(m_levels)-2; level >= 0; level--)
+    {
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        m_reduceShader.uniform1ui("level", uint32_t(level));
+        m_reduceShader.dispatch(1u << (3*level), GENERAL_WGSIZE);
+    }
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_built = true;
+}
+
+void ParticleLod::select(mpu::gph::Buffer positions, uint32_t numParticles, const glm::mat4& modelViewProjection,
+                         const glm::mat4& projection, glm::vec2 viewportSize, float maxPixelSize, float renderSize)
+{
+    if(numParticles > m_indexCapacity)
+    {
+        m_indexCapacity = numParticles;
+        m_particleIndices.recreate();
+        m_particleIndices.allocate<uint32_t>(m_indexCapacity);
+        logDEBUG("LOD") << "Resized LOD index buffer to " << m_indexCapacity << " particles.";
+    }
+
+    bindBuffers();
+    positions.bindBase(PARTICLE_POSITION_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_commands.write(std::vector<uint32_t>{0,1,0,0, 0,1,0,0,0});
+
+    // extract the frustum planes from the model view projection matrix, normals point inwards
+    const glm::vec4 row0 = glm::row(modelViewProjection,0);
+    const glm::vec4 row1 = glm::row(modelViewProjection,1);
+    const glm::vec4 row2 = glm::row(modelViewProjection,2);
+    const glm::vec4 row3 = glm::row(modelViewProjection,3);
+    glm::vec4 planes[6] = {row3+row0, row3-row0, row3+row1, row3-row1, row3+row2, row3-row2};
+    for(auto &plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+
+    const float pixelScale = 0.5f * viewportSize.y * projection[1][1];
+    for(const mpu::gph::ShaderProgram* shader : {&m_selectNodesShader, &m_selectParticlesShader})
+    {
+        glProgramUniform4fv(*shader, shader->uniformLocation("frustum_planes"), 6, glm::value_ptr(planes[0]));
+        shader->uniformMat4("model_view_projection", modelViewProjection);
+        shader->uniform1f("pixel_scale", pixelScale);
+        shader->uniform1f("max_pixel_size", maxPixelSize);
+    }
+    m_selectParticlesShader.uniform1ui("num_of_particles", numParticles);
+    m_selectParticlesShader.uniform1f("render_size", renderSize);
+
+    m_selectNodesShader.dispatch(m_numCells, GENERAL_WGSIZE);
+    m_selectParticlesShader.dispatch(numParticles, GENERAL_WGSIZE);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
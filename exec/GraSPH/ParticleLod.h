@@ -0,0 +1,81 @@
+/*
+ * GraSPH
+ * ParticleLod.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the ParticleLod class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_PARTICLELOD_H
+#define GRASPH_PARTICLELOD_H
+
+// includes
+//--------------------
+#include <Graphics/Graphics.h>
+#include <Log/Log.h>
+#include "Common.h"
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class ParticleLod
+ *
+ * usage:
+ * A level of detail hierarchy for drawing large numbers of particles. build() sorts the particles into a pyramid of
+ * regular grids (a complete octree with "levels" levels) spanning their bounding box, every cell stores the total mass,
+ * center of mass and number of particles. Building is expensive compared to drawing, so it only needs to happen every few simulation steps.
+ *
+ * select() is called every frame. It chooses the cut through the octree where cells appear smaller than
+ * "maxPixelSize" on screen. Those cells are written to nodes() (center of mass, number of particles) and nodeRadius()
+ * (half the cell size) and can be drawn using glDrawArraysIndirect with the command at offset 0 of commands().
+ * Particles in cells which are too big even on the finest level are written to particleIndices() and can be drawn
+ * using glDrawElementsIndirect at offset particleCommandOffset. Both lists are culled against the view frustum.
+ * The number of nodes is bounded by the number of cells, the number of particles by the ones close to the camera.
+ *
+ */
+class ParticleLod
+{
+public:
+    static constexpr intptr_t particleCommandOffset = 4*sizeof(uint32_t); //!< byte offset of the particle draw command
+
+    explicit ParticleLod(uint32_t levels = 7); //!< the finest level has 2^(levels-1) cells per dimension
+
+    void build(mpu::gph::Buffer positions, uint32_t numParticles); //!< rebuild the hierarchy from the particle positions
+    void select(mpu::gph::Buffer positions, uint32_t numParticles, const glm::mat4& modelViewProjection,
+                const glm::mat4& projection, glm::vec2 viewportSize, float maxPixelSize, float renderSize); //!< select the nodes and particles to draw
+
+    bool isBuilt() const {return m_built;} //!< true after the first build
+    mpu::gph::Buffer nodes() const {return m_nodes;} //!< vec4 center of mass and number of particles of the selected nodes
+    mpu::gph::Buffer nodeRadius() const {return m_nodeRadius;} //!< float radius of the selected nodes
+    mpu::gph::Buffer particleIndices() const {return m_particleIndices;} //!< indices of particles that need to be drawn individually
+    mpu::gph::Buffer commands() const {return m_commands;} //!< indirect draw commands for nodes and particles
+
+private:
+    void bindBuffers(); //!< binds the internal buffers
+
+    uint32_t m_levels;
+    uint32_t m_numCells;
+    uint32_t m_indexCapacity{0};
+    bool m_built{false};
+
+    mpu::gph::ShaderProgram m_boundsShader;
+    mpu::gph::ShaderProgram m_accumulateShader;
+    mpu::gph::ShaderProgram m_reduceShader;
+    mpu::gph::ShaderProgram m_selectNodesShader;
+    mpu::gph::ShaderProgram m_selectParticlesShader;
+
+    mpu::gph::Buffer m_cells;
+    mpu::gph::Buffer m_bounds;
+    mpu::gph::Buffer m_nodes;
+    mpu::gph::Buffer m_nodeRadius;
+    mpu::gph::Buffer m_commands;
+    mpu::gph::Buffer m_particleIndices{nullptr};
+};
+
+
+#endif //GRASPH_PARTICLELOD_H
@@ -16,6 +16,7 @@
 // includes
 //--------------------
 #include "ParticleRenderer.h"
+#include "SinkParticles.h"
 //--------------------
 
 // function definitions of the ParticleRenderer class
@@ -23,46 +24,184 @@
 ParticleRenderer::ParticleRenderer()
         : m_renderShader({{PROJECT_SHADER_PATH"ParticleRenderer/particleRenderer.vert"},
                           {PROJECT_SHADER_PATH"ParticleRenderer/particleRenderer.frag"}},
-                         {{"PARTICLES_ROUND"},{"PARTICLES_PERSPECTIVE"},{"PARTICLE_FALLOFF",{"falloffColor=color"}}})
+                         {{"PARTICLES_ROUND"},{"PARTICLES_PERSPECTIVE"},{"PARTICLE_FALLOFF",{"falloffColor=color"}}}),
+          m_splatShader({{PROJECT_SHADER_PATH"ParticleRenderer/splat.vert"},
+                         {PROJECT_SHADER_PATH"ParticleRenderer/splat.frag"}}),
+          m_resolvePass(PROJECT_SHADER_PATH"ParticleRenderer/splatResolve.frag"),
+          m_cullShader({{PROJECT_SHADER_PATH"ParticleRenderer/cullParticles.comp"}}),
+          m_pointShader({{PROJECT_SHADER_PATH"ParticleRenderer/particlePoint.vert"},
+                         {PROJECT_SHADER_PATH"ParticleRenderer/particlePoint.frag"}}),
+          m_lodShader({{PROJECT_SHADER_PATH"ParticleRenderer/particleRenderer.vert"},
+                       {PROJECT_SHADER_PATH"ParticleRenderer/particleRenderer.frag"}},
+                      {{"PARTICLES_ROUND"},{"PARTICLES_PERSPECTIVE"},{"PARTICLES_LOD"},{"PARTICLE_FALLOFF",{"falloffColor=color"}}})
 {
     glEnable(GL_PROGRAM_POINT_SIZE);
     m_vao.enableArray(RENDERER_POSITION_ARRAY);
     m_vao.enableArray(RENDERER_MASS_ARRAY);
+    m_sinkVao.enableArray(RENDERER_POSITION_ARRAY);
+    m_sinkVao.enableArray(RENDERER_MASS_ARRAY);
+    m_lodVao.enableArray(RENDERER_POSITION_ARRAY);
+    m_lodVao.enableArray(RENDERER_MASS_ARRAY);
+    m_lodVao.enableArray(RENDERER_SMLENGTH_ARRAY);
     m_renderShader.uniform4f("color", m_color);
     m_renderShader.uniform1f("brightness", m_brightness);
     m_renderShader.uniform1f("render_size", m_size);
+    m_renderShader.uniform4f("sink_color", m_sinkColor);
+    m_renderShader.uniform1f("sink_size", m_sinkSize);
+    m_renderShader.uniform1i("render_sinks", 0);
+    m_resolvePass.shader().uniform4f("color", m_color);
+    m_resolvePass.shader().uniform1f("brightness", m_brightness);
+    m_resolvePass.shader().uniform1i("column_density", 0);
+    m_pointShader.uniform4f("color", m_color);
+    m_pointShader.uniform1f("brightness", m_brightness);
+    m_pointShader.uniform1f("render_size", m_size);
+    m_lodShader.uniform4f("color", m_color);
+    m_lodShader.uniform1f("brightness", m_brightness);
+    m_lodShader.uniform1f("render_size", m_size);
+    m_lodShader.uniform1i("render_sinks", 0);
+    m_drawCommands.allocate<DrawElementsIndirectCommand>(2, GL_DYNAMIC_STORAGE_BIT);
 }
 
 void ParticleRenderer::draw()
 {
-    m_vao.bind();
-    m_renderShader.use();
-    m_renderShader.uniformMat4("model_view_projection", getModelViewProjection());
-    m_renderShader.uniformMat4("projection", getProj());
-    glDrawArrays(GL_POINTS, 0, m_numOfParticles);
+    if(m_splatting && m_hasSmlength)
+    {
+        // accumulate the column density in the low resolution target
+        // the caller might render to an offscreen framebuffer (eg the movie recorder), so restore it afterwards
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLint drawFramebuffer, readFramebuffer;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+        const GLboolean blendWasEnabled = glIsEnabled(GL_BLEND);
+
+        m_splatFramebuffer.bind();
+        glViewport(0, 0, m_splatTexture.size().x, m_splatTexture.size().y);
+        m_splatTexture.clear();
+        glBlendFunc(GL_ONE, GL_ONE);
+        glEnable(GL_BLEND);
+
+        if(m_culling)
+            cull(true, false);
+
+        m_vao.bind();
+        m_splatShader.use();
+        m_splatShader.uniformMat4("model_view_projection", getModelViewProjection());
+        m_splatShader.uniformMat4("projection", getProj());
+        if(m_culling)
+            glDrawElementsIndirect(GL_POINTS, GL_UNSIGNED_INT, nullptr);
+        else
+            glDrawArrays(GL_POINTS, 0, m_numParticles);
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(drawFramebuffer));
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFramebuffer));
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        if(!blendWasEnabled)
+            glDisable(GL_BLEND);
+
+        // upsample and tone map
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        m_splatTexture.bind(0);
+        m_resolvePass.draw();
+    }
+    else if(m_lod && m_lod->isBuilt() && m_perspective)
+    {
+        m_lod->select(m_positionBuffer, m_numParticles, getModelViewProjection(), getProj(), m_vpSize, m_lodMaxPixelSize, m_size);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_lod->commands());
+
+        m_lodVao.bind();
+        m_lodShader.use();
+        m_lodShader.uniformMat4("model_view_projection", getModelViewProjection());
+        m_lodShader.uniformMat4("projection", getProj());
+        glDrawArraysIndirect(GL_POINTS, nullptr);
+
+        m_vao.setIndexBuffer(m_lod->particleIndices());
+        m_vao.bind();
+        m_renderShader.use();
+        m_renderShader.uniformMat4("model_view_projection", getModelViewProjection());
+        m_renderShader.uniformMat4("projection", getProj());
+        glDrawElementsIndirect(GL_POINTS, GL_UNSIGNED_INT, reinterpret_cast<void*>(ParticleLod::particleCommandOffset));
+    }
+    else if(m_culling)
+    {
+        cull(false, m_perspective);
+
+        m_vao.bind();
+        m_renderShader.use();
+        m_renderShader.uniformMat4("model_view_projection", getModelViewProjection());
+        m_renderShader.uniformMat4("projection", getProj());
+        glDrawElementsIndirect(GL_POINTS, GL_UNSIGNED_INT, nullptr);
+
+        m_pointShader.use();
+        m_pointShader.uniformMat4("model_view_projection", getModelViewProjection());
+        m_pointShader.uniformMat4("projection", getProj());
+        glDrawElementsIndirect(GL_POINTS, GL_UNSIGNED_INT, reinterpret_cast<void*>(sizeof(DrawElementsIndirectCommand)));
+    }
+    else
+    {
+        m_vao.bind();
+        m_renderShader.use();
+        m_renderShader.uniformMat4("model_view_projection", getModelViewProjection());
+        m_renderShader.uniformMat4("projection", getProj());
+        glDrawArrays(GL_POINTS, 0, m_numParticles);
+    }
+
+    if(m_numSinks > 0)
+    {
+        m_sinkVao.bind();
+        m_renderShader.use();
+        m_renderShader.uniformMat4("model_view_projection", getModelViewProjection());
+        m_renderShader.uniformMat4("projection", getProj());
+        m_renderShader.uniform1i("render_sinks", 1);
+        glDrawArrays(GL_POINTS, 0, m_numSinks);
+        m_renderShader.uniform1i("render_sinks", 0);
+    }
 }
 
 void ParticleRenderer::setParticleBuffer(ParticleBuffer buffer)
 {
-    m_vao.setBuffer(RENDERER_POSITION_BUFFER_BINDING,buffer.positionBuffer,0,sizeof(ParticleBuffer::posType));
+    setPositionBuffer(buffer.positionBuffer);
+    setSmlengthBuffer(buffer.smlengthBuffer);
+    setNumberOfParticles(buffer.activeSize());
+
+    logDEBUG("Renderer") << "Set buffer for rendering and reconfigured vertex arrays. Buffer containing " << buffer.size() << " Particles.";
+}
+
+void ParticleRenderer::setPositionBuffer(mpu::gph::Buffer positions)
+{
+    m_positionBuffer = positions;
+    m_vao.setBuffer(RENDERER_POSITION_BUFFER_BINDING,positions,0,sizeof(ParticleBuffer::posType));
     m_vao.setAttribFormat(RENDERER_POSITION_ARRAY, 3, 0);
     m_vao.setAttribFormat(RENDERER_MASS_ARRAY, 1, mpu::gph::offset_of(&glm::vec4::w));
     m_vao.addBinding(RENDERER_POSITION_ARRAY, RENDERER_POSITION_BUFFER_BINDING);
     m_vao.addBinding(RENDERER_MASS_ARRAY, RENDERER_POSITION_BUFFER_BINDING);
-    m_numOfParticles = buffer.size();
+}
 
-    logDEBUG("Renderer") << "Set buffer for rendering and reconfigured vertex arrays. Buffer containing " << m_numOfParticles << " Particles.";
+void ParticleRenderer::setSinkBuffer(mpu::gph::Buffer sinkBuffer)
+{
+    m_sinkVao.setBuffer(RENDERER_POSITION_BUFFER_BINDING,sinkBuffer,SinkParticles::sinkBufferHeaderSize,sizeof(SinkParticles::Sink));
+    m_sinkVao.setAttribFormat(RENDERER_POSITION_ARRAY, 3, 0);
+    m_sinkVao.setAttribFormat(RENDERER_MASS_ARRAY, 1, mpu::gph::offset_of(&glm::vec4::w));
+    m_sinkVao.addBinding(RENDERER_POSITION_ARRAY, RENDERER_POSITION_BUFFER_BINDING);
+    m_sinkVao.addBinding(RENDERER_MASS_ARRAY, RENDERER_POSITION_BUFFER_BINDING);
+
+    logDEBUG("Renderer") << "Set sink buffer for rendering.";
 }
 
 void ParticleRenderer::setViewportSize(glm::uvec2 viewport)
 {
     m_vpSize = viewport;
     m_renderShader.uniform2f("viewport_size", m_vpSize);
+    m_pointShader.uniform2f("viewport_size", m_vpSize);
+    m_lodShader.uniform2f("viewport_size", m_vpSize);
+    if(m_splatting)
+        createSplatTarget();
 }
 
 void ParticleRenderer::setShaderSettings( Falloff style, bool perspectiveSize, bool roundParticles)
 {
     std::vector<mpu::gph::glsl::Definition> definitions;
+    m_perspective = perspectiveSize;
     if(perspectiveSize)
         definitions.push_back({"PARTICLES_PERSPECTIVE"});
     if(roundParticles)
@@ -91,12 +230,24 @@ void ParticleRenderer::setShaderSettings( Falloff style, bool perspectiveSize, b
     m_renderShader.rebuild({{PROJECT_SHADER_PATH"ParticleRenderer/particleRenderer.vert"},
                             {PROJECT_SHADER_PATH"ParticleRenderer/particleRenderer.frag"}},
                            definitions);
+    definitions.push_back({"PARTICLES_LOD"});
+    m_lodShader.rebuild({{PROJECT_SHADER_PATH"ParticleRenderer/particleRenderer.vert"},
+                         {PROJECT_SHADER_PATH"ParticleRenderer/particleRenderer.frag"}},
+                        definitions);
 
     m_renderShader.uniform2f("viewport_size", m_vpSize);
     m_renderShader.uniform4f("color", m_color);
     m_renderShader.uniform1f("brightness", m_brightness);
     m_renderShader.uniform1f("render_size", m_size);
-//    m_renderShader.uniform1f("mass_thres", TOTAL_MASS / NUM_PARTICLES);
+    m_renderShader.uniform4f("sink_color", m_sinkColor);
+    m_renderShader.uniform1f("sink_size", m_sinkSize);
+    m_renderShader.uniform1i("render_sinks", 0);
+
+    m_lodShader.uniform2f("viewport_size", m_vpSize);
+    m_lodShader.uniform4f("color", m_color);
+    m_lodShader.uniform1f("brightness", m_brightness);
+    m_lodShader.uniform1f("render_size", m_size);
+    m_lodShader.uniform1i("render_sinks", 0);
 }
 
 void ParticleRenderer::enableAdditiveBlending(bool enable)
@@ -113,12 +264,18 @@ void ParticleRenderer::setColor(glm::vec4 c)
 {
     m_color=c;
     m_renderShader.uniform4f("color", m_color);
+    m_resolvePass.shader().uniform4f("color", m_color);
+    m_pointShader.uniform4f("color", m_color);
+    m_lodShader.uniform4f("color", m_color);
 }
 
 void ParticleRenderer::setBrightness(float b)
 {
     m_brightness=b;
     m_renderShader.uniform1f("brightness", m_brightness);
+    m_resolvePass.shader().uniform1f("brightness", m_brightness);
+    m_pointShader.uniform1f("brightness", m_brightness);
+    m_lodShader.uniform1f("brightness", m_brightness);
 }
 
 void ParticleRenderer::enableDepthTest(bool enable)
@@ -133,4 +290,158 @@ void ParticleRenderer::setSize(float size)
 {
     m_size = size;
     m_renderShader.uniform1f("render_size", m_size);
+    m_pointShader.uniform1f("render_size", m_size);
+    m_lodShader.uniform1f("render_size", m_size);
+}
+
+void ParticleRenderer::setSinkColor(glm::vec4 c)
+{
+    m_sinkColor=c;
+    m_renderShader.uniform4f("sink_color", m_sinkColor);
+}
+
+void ParticleRenderer::setSinkSize(float size)
+{
+    m_sinkSize = size;
+    m_renderShader.uniform1f("sink_size", m_sinkSize);
+}
+
+void ParticleRenderer::setSmlengthBuffer(mpu::gph::Buffer smlength)
+{
+    m_vao.setBuffer(RENDERER_SMLENGTH_BUFFER_BINDING,smlength,0,sizeof(float));
+    m_vao.setAttribFormat(RENDERER_SMLENGTH_ARRAY, 1, 0);
+    m_vao.addBinding(RENDERER_SMLENGTH_ARRAY, RENDERER_SMLENGTH_BUFFER_BINDING);
+    m_vao.enableArray(RENDERER_SMLENGTH_ARRAY);
+    m_smlengthBuffer = smlength;
+    m_hasSmlength = true;
+}
+
+void ParticleRenderer::enableSplatting(bool enable, int downsample)
+{
+    assert_true(downsample > 0, "Renderer", "Splatting downsample factor needs to be positive.");
+    m_splatting = enable;
+    m_splatDownsample = downsample;
+
+    if(m_splatting)
+    {
+        if(!m_hasSmlength)
+            logWARNING("Renderer") << "Splatting enabled, but no smoothing length buffer is set. Falling back to sprites.";
+        createSplatTarget();
+    }
+    else
+    {
+        m_splatFramebuffer = mpu::gph::Framebuffer(nullptr);
+        m_splatTexture = mpu::gph::Texture(nullptr);
+    }
+}
+
+std::vector<float> ParticleRenderer::readColumnDensity() const
+{
+    assert_critical(m_splatting, "Renderer", "Column density can only be read while splatting is enabled.");
+    return m_splatTexture.read<float>(GL_RED, GL_FLOAT);
+}
+
+void ParticleRenderer::createSplatTarget()
+{
+    const glm::uvec2 size = glm::max(glm::uvec2(m_vpSize) / glm::uvec2(m_splatDownsample), glm::uvec2(1));
+
+    m_splatTexture = mpu::gph::Texture(GL_TEXTURE_2D);
+    m_splatTexture.allocate2D(GL_R32F, size);
+    m_splatTexture.setFilter(GL_LINEAR, GL_LINEAR);
+    m_splatTexture.setWrap(GL_CLAMP_TO_EDGE);
+
+    m_splatFramebuffer = mpu::gph::Framebuffer();
+    m_splatFramebuffer.attach(GL_COLOR_ATTACHMENT0, m_splatTexture);
+    if(!m_splatFramebuffer.isComplete())
+    {
+        logERROR("Renderer") << "Could not create the splatting target.";
+        throw std::runtime_error("Splatting target incomplete.");
+    }
+
+    m_splatShader.uniform2f("target_size", glm::vec2(size));
+    logDEBUG("Renderer") << "Created splatting target of size " << size.x << "x" << size.y;
+}
+
+void ParticleRenderer::enableCulling(bool enable, float minPixelRadius)
+{
+    m_culling = enable;
+    m_minPixelRadius = minPixelRadius;
+}
+
+void ParticleRenderer::cull(bool useSmlength, bool splitSmall)
+{
+    // grow the index buffer when needed, it holds sprites in the first half and points in the second
+    if(m_numParticles > m_indexCapacity)
+    {
+        m_indexCapacity = m_numParticles;
+        m_visibleIndices.recreate();
+        m_visibleIndices.allocate<uint32_t>(2*m_indexCapacity);
+        logDEBUG("Renderer") << "Resized culling index buffer to " << m_indexCapacity << " particles.";
+    }
+
+    m_vao.setIndexBuffer(m_visibleIndices);
+    m_drawCommands.write(std::vector<DrawElementsIndirectCommand>{{0,1,0,0,0},{0,1,m_indexCapacity,0,0}});
+
+    // extract the frustum planes from the model view projection matrix, normals point inwards
+    const glm::mat4 mvp = getModelViewProjection();
+    const glm::vec4 row0 = glm::row(mvp,0);
+    const glm::vec4 row1 = glm::row(mvp,1);
+    const glm::vec4 row2 = glm::row(mvp,2);
+    const glm::vec4 row3 = glm::row(mvp,3);
+    glm::vec4 planes[6] = {row3+row0, row3-row0, row3+row1, row3-row1, row3+row2, row3-row2};
+    for(auto &plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+
+    glProgramUniform4fv(m_cullShader, m_cullShader.uniformLocation("frustum_planes"), 6, glm::value_ptr(planes[0]));
+    m_cullShader.uniformMat4("model_view_projection", mvp);
+    m_cullShader.uniform1ui("num_of_particles", m_numParticles);
+    m_cullShader.uniform1ui("index_capacity", m_indexCapacity);
+    m_cullShader.uniform1f("pixel_scale", 0.5f * m_vpSize.y * getProj()[1][1]);
+    m_cullShader.uniform1f("render_size", m_size);
+    m_cullShader.uniform1i("use_smlength", useSmlength ? 1 : 0);
+    m_cullShader.uniform1i("split_small", splitSmall ? 1 : 0);
+    m_cullShader.uniform1f("min_pixel_radius", m_minPixelRadius);
+
+    m_positionBuffer.bindBase(PARTICLE_POSITION_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    if(useSmlength)
+        m_smlengthBuffer.bindBase(PARTICLE_SMLENGTH_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_visibleIndices.bindBase(CULL_INDEX_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_drawCommands.bindBase(CULL_COMMAND_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+
+    m_cullShader.dispatch(m_numParticles, GENERAL_WGSIZE);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCommands);
+}
+
+void ParticleRenderer::enableLod(bool enable, uint32_t rebuildInterval, float maxPixelSize, uint32_t levels)
+{
+    m_lodRebuildInterval = rebuildInterval;
+    m_lodMaxPixelSize = maxPixelSize;
+    if(!enable)
+    {
+        m_lod.reset();
+        return;
+    }
+
+    m_lod = std::make_unique<ParticleLod>(levels);
+    m_lodVao.setBuffer(RENDERER_POSITION_BUFFER_BINDING, m_lod->nodes(), 0, sizeof(glm::vec4));
+    m_lodVao.setAttribFormat(RENDERER_POSITION_ARRAY, 3, 0);
+    m_lodVao.setAttribFormat(RENDERER_MASS_ARRAY, 1, mpu::gph::offset_of(&glm::vec4::w));
+    m_lodVao.addBinding(RENDERER_POSITION_ARRAY, RENDERER_POSITION_BUFFER_BINDING);
+    m_lodVao.addBinding(RENDERER_MASS_ARRAY, RENDERER_POSITION_BUFFER_BINDING);
+    m_lodVao.setBuffer(RENDERER_SMLENGTH_BUFFER_BINDING, m_lod->nodeRadius(), 0, sizeof(float));
+    m_lodVao.setAttribFormat(RENDERER_SMLENGTH_ARRAY, 1, 0);
+    m_lodVao.addBinding(RENDERER_SMLENGTH_ARRAY, RENDERER_SMLENGTH_BUFFER_BINDING);
+}
+
+void ParticleRenderer::updateLod(uint64_t step)
+{
+    if(!m_lod || !m_positionBuffer)
+        return;
+
+    if(!m_lod->isBuilt() || step >= m_lodStep + m_lodRebuildInterval || step < m_lodStep)
+    {
+        m_lod->build(m_positionBuffer, m_numParticles);
+        m_lodStep = step;
+    }
 }
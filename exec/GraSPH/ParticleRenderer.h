@@ -21,6 +21,8 @@
 #include <Graphics/Graphics.h>
 #include "Common.h"
 #include "ParticleBuffer.h"
+#include "ParticleLod.h"
+#include <memory>
 //--------------------
 
 enum class Falloff
@@ -38,7 +40,9 @@ enum class Falloff
  * A class for flexible rendering of particles.
  *
  * usage:
- * Use setParticleBuffer() to set the buffer the particles are in.
+ * Use setParticleBuffer() to set the buffer the particles are in, or setPositionBuffer() to draw positions stored somewhere
+ * else (eg a DoubleBufferedSnapshot). Update the number of particles to draw using setNumberOfParticles().
+ * Sink particles can be drawn as well, set the buffer with setSinkBuffer() and update the number of sinks using setNumberOfSinks().
  * Then use configureArrays to set the Position of the vec4 Position and the float renderSize within the particle struct.
  * Set desired Model, View, and Projection matrices and the current viewport size then
  * call draw to draw.
@@ -49,6 +53,22 @@ enum class Falloff
  * You can also set a style for the falloff, meaning different functions to calculate how moch darker the particles borders will be.
  * If you enable additive blending particle colors are added onto each other.
  *
+ * enableSplatting() switches to a physically based mode. Every particle is splatted with the line of sight integral of
+ * its SPH kernel into a single channel float target of reduced resolution (viewport / downsample). The resulting column
+ * density is upsampled bilinear and tone mapped using color and brightness. The smoothing lengths need to be set with
+ * setSmlengthBuffer() (setParticleBuffer() does this automatically). Size and falloff settings do not apply in this mode.
+ * Use readColumnDensity() to get the column density for analysis.
+ *
+ * enableCulling() adds a compute pass before drawing, which removes particles outside of the view frustum and writes
+ * the indices of the visible ones into an index buffer, together with an indirect draw command. Sprites with a radius
+ * below a threshold (in pixel) are drawn as single pixel points in a cheap second pass, scaled by the area they would have covered.
+ * Sink particles are not culled.
+ *
+ * enableLod() draws far away particles aggregated into the nodes of an octree (see ParticleLod). Call updateLod() whenever
+ * new positions where set, the hierarchy is rebuild every "rebuildInterval" simulation steps. Nodes that appear smaller
+ * than maxPixelSize are drawn as a single sprite, falloff and brightness are applied as for single particles.
+ * LOD is only used for perspective sized sprites, it replaces the culling pass in that case.
+ *
  * Do NOT disable GL_PROGRAM_POINT_SIZE !!
  * If additive blending is on, do not disable GL_BLEND or change the blending function.
  * Remember to clear the depth buffer if depth testing is enabled!
@@ -60,7 +80,11 @@ public:
 
     void draw();
 
-    void setParticleBuffer(ParticleBuffer buffer); //!< set the particle buffer to be used in rendering
+    void setParticleBuffer(ParticleBuffer buffer); //!< set the particle buffer to be used in rendering, draws its currently active particles
+    void setPositionBuffer(mpu::gph::Buffer positions); //!< set a buffer of vec4 positions (w is mass) to be used in rendering
+    void setNumberOfParticles(uint32_t numParticles){m_numParticles = numParticles;} //!< set the number of particles that will be drawn
+    void setSinkBuffer(mpu::gph::Buffer sinkBuffer); //!< set the buffer where sink particles are stored (see SinkParticles)
+    void setNumberOfSinks(uint32_t numSinks){m_numSinks = numSinks;} //!< set the number of sinks that will be drawn
 
     void setViewportSize(glm::uvec2 viewport); //!< update the viewport size
 
@@ -71,15 +95,67 @@ public:
     void setSize(float size); //!< set the size the particles should be rendered with
     void setColor(glm::vec4 c); //!< set the color of the paricles
     void setBrightness(float b); //!< set the brightness of the particles (usefull with additive blending)
+    void setSinkColor(glm::vec4 c); //!< set the color of sink particles
+    void setSinkSize(float size); //!< set the size sink particles should be rendered with
+
+    void setSmlengthBuffer(mpu::gph::Buffer smlength); //!< set a buffer of float smoothing lengths, needed for splatting
+    void enableSplatting(bool enable, int downsample=2); //!< render the column density using the SPH kernel into a target of size viewport/downsample
+    std::vector<float> readColumnDensity() const; //!< read back the column density of the last splatted frame, row by row starting bottom left
+    glm::uvec2 columnDensitySize() const {return m_splatTexture.size();} //!< size of the column density target
+
+    void enableCulling(bool enable, float minPixelRadius=0.5f); //!< cull particles outside of the view and draw sprites smaller than minPixelRadius as points
+    void enableLod(bool enable, uint32_t rebuildInterval=10, float maxPixelSize=2.0f, uint32_t levels=7); //!< draw far away particles as aggregated octree nodes
+    void updateLod(uint64_t step); //!< rebuild the LOD hierarchy from the current positions if it is older than rebuildInterval steps
 
 private:
+    struct DrawElementsIndirectCommand
+    {
+        uint32_t count;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        uint32_t baseVertex;
+        uint32_t baseInstance;
+    };
+
+    void createSplatTarget(); //!< (re)creates the accumulation target for the current viewport size
+    void cull(bool useSmlength, bool splitSmall); //!< run the culling pass, fills the index buffer and draw commands
+
     mpu::gph::ShaderProgram m_renderShader;
+    mpu::gph::ShaderProgram m_splatShader;
+    mpu::gph::ScreenFillingTri m_resolvePass;
+    mpu::gph::Texture m_splatTexture{nullptr};
+    mpu::gph::Framebuffer m_splatFramebuffer{nullptr};
+    bool m_splatting{false};
+    bool m_hasSmlength{false};
+    int m_splatDownsample{2};
+
+    mpu::gph::ShaderProgram m_cullShader;
+    mpu::gph::ShaderProgram m_pointShader;
+    mpu::gph::Buffer m_positionBuffer{nullptr};
+    mpu::gph::Buffer m_smlengthBuffer{nullptr};
+    mpu::gph::Buffer m_visibleIndices{nullptr}; //!< indices of visible sprites, followed by indices of sub pixel particles
+    mpu::gph::Buffer m_drawCommands; //!< indirect draw commands for sprites and points
+    uint32_t m_indexCapacity{0};
+    bool m_culling{false};
+    bool m_perspective{true};
+    float m_minPixelRadius{0.5f};
+
+    mpu::gph::ShaderProgram m_lodShader;
+    mpu::gph::VertexArray m_lodVao;
+    std::unique_ptr<ParticleLod> m_lod;
+    uint32_t m_lodRebuildInterval{10};
+    float m_lodMaxPixelSize{2.0f};
+    uint64_t m_lodStep{0};
     mpu::gph::VertexArray m_vao;
-    uint32_t m_numOfParticles{0};
+    mpu::gph::VertexArray m_sinkVao;
+    uint32_t m_numParticles{0};
+    uint32_t m_numSinks{0};
     glm::vec2 m_vpSize{0};
     glm::vec4 m_color{1,1,1,1};
     float m_brightness{1};
     float m_size{1};
+    glm::vec4 m_sinkColor{1,1,1,1};
+    float m_sinkSize{1};
 };
 
 #endif //MPUTILS_PARTICLERENDERER_H
@@ -15,23 +15,73 @@
 //--------------------
 #include "ParticleSpawner.h"
 #include <cmath>
+#include <algorithm>
+#include <random>
 //--------------------
 
+namespace {
+    constexpr int MAX_NOISE_OCTAVES = 16; //!< number of noise octaves that are added to the potential in one dispatch
+    constexpr uint32_t RADIAL_TABLE_SIZE = 1024; //!< number of entries in the tables used to spawn radial distributions
+    constexpr uint32_t RADIAL_INTEGRATION_STEPS = 16384; //!< steps used to integrate the radial distributions
+
+    //!< solves the isothermal lane emden equation and returns rho/rho_c at equally spaced xi from 0 to xiMax
+    std::vector<double> isothermalSphere(double xiMax, uint32_t steps)
+    {
+        // psi'' = exp(-psi) - 2/xi * psi', with psi(0) = psi'(0) = 0, integrated with rk4
+        auto derivative = [](double xi, glm::dvec2 y)
+        {
+            if(xi == 0)
+                return glm::dvec2(y.y, 1.0/3.0); // limit of the equation at the center
+            return glm::dvec2(y.y, std::exp(-y.x) - 2.0/xi * y.y);
+        };
+
+        const double h = xiMax / steps;
+        std::vector<double> density(steps+1);
+        glm::dvec2 y(0,0);
+        density[0] = 1;
+        for(uint32_t i = 0; i < steps; i++)
+        {
+            const double xi = i*h;
+            const glm::dvec2 k1 = derivative(xi, y);
+            const glm::dvec2 k2 = derivative(xi + 0.5*h, y + 0.5*h*k1);
+            const glm::dvec2 k3 = derivative(xi + 0.5*h, y + 0.5*h*k2);
+            const glm::dvec2 k4 = derivative(xi + h, y + h*k3);
+            y += h/6.0 * (k1 + 2.0*k2 + 2.0*k3 + k4);
+            density[i+1] = std::exp(-y.x);
+        }
+        return density;
+    }
+}
+
 // function definitions of the ParticleSpawner class
 //-------------------------------------------------------------------
-ParticleSpawner::ParticleSpawner()
-        : m_cubeSpawnShader({{PROJECT_SHADER_PATH"ParticleSpawner/cubeSpawn.comp"}}),
-          m_initialVelocitySimplexShader({{PROJECT_SHADER_PATH"ParticleSpawner/initialVelocitySimplex.comp"}}),
-          m_initialVelocityCurlShader({{PROJECT_SHADER_PATH"ParticleSpawner/initialVelocityCurl.comp"}}),
-          m_addSimplexShader({{PROJECT_SHADER_PATH"ParticleSpawner/addPotential.comp"}}),
-          m_angVelShader({{PROJECT_SHADER_PATH"ParticleSpawner/angVel.comp"}}),
-          m_sphereSpawnShader({{PROJECT_SHADER_PATH"ParticleSpawner/sphereSpawn.comp"}})
+mpu::gph::ShaderProgram& ParticleSpawner::program(const std::string& file, const std::vector<mpu::gph::glsl::Definition>& definitions)
+{
+    std::string key = file;
+    for(auto &&definition : definitions)
+        key += "|" + definition.name + "=" + definition.info.replacement;
+
+    auto it = m_programCache.find(key);
+    if(it == m_programCache.end())
+    {
+        logDEBUG("Spawner") << "Compiling spawner shader " << file;
+        it = m_programCache.emplace(key, mpu::gph::ShaderProgram({{PROJECT_SHADER_PATH + file}}, definitions)).first;
+    }
+    return it->second;
+}
+
+std::vector<mpu::gph::glsl::Definition> ParticleSpawner::tiledDefinitions() const
 {
+    return {
+            {"WGSIZE",{mpu::toString(GENERAL_WGSIZE)}},
+            {"NUM_PARTICLES",{mpu::toString(m_particleBuffer.size())}},
+            {"THREADS_PER_PARTICLE",{mpu::toString(1)}}
+    };
 }
 
-void ParticleSpawner::spawnParticlesCube(const float totalMass, const glm::vec3 &upperBound, const glm::vec3 &lowerBound, const float initialSmlength)
+void ParticleSpawner::spawnParticlesCube(const float totalMass, const glm::vec3 &upperBound, const glm::vec3 &lowerBound, const float initialSmlength, uint32_t seed)
 {
-    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.size() << " in a cube volume from " << glm::to_string(lowerBound)
+    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.activeSize() << " in a cube volume from " << glm::to_string(lowerBound)
                        << " to " << glm::to_string(upperBound);
 
     // generate a particle buffer
@@ -42,10 +92,10 @@ void ParticleSpawner::spawnParticlesCube(const float totalMass, const glm::vec3
     m_totalMass = totalMass;
 
     // calculate particle attributes
-    m_particleMass = m_totalMass / m_particleBuffer.size();
+    m_particleMass = m_totalMass / m_particleBuffer.activeSize();
     glm::vec3 cubeSize = upperBound - lowerBound;
     m_totalVolume = cubeSize.x * cubeSize.y * cubeSize.z;
-    m_particleVolume = m_totalVolume / m_particleBuffer.size();
+    m_particleVolume = m_totalVolume / m_particleBuffer.activeSize();
     m_particleDensity = m_particleMass / m_particleVolume;
 
     logDEBUG("Spawner") << "Total volume: " << m_totalVolume;
@@ -54,20 +104,22 @@ void ParticleSpawner::spawnParticlesCube(const float totalMass, const glm::vec3
                        << " density=" << m_particleDensity;
 
     // call the shader to do the work
-    m_cubeSpawnShader.uniform3f("upper_bound",upperBound);
-    m_cubeSpawnShader.uniform3f("lower_bound",lowerBound);
-    m_cubeSpawnShader.uniform1f("mass",m_particleMass);
-    m_cubeSpawnShader.uniform1f("initial_smlength", initialSmlength);
-    m_cubeSpawnShader.uniform1ui("random_seed", std::time(nullptr)); // time as pseudo random seed
-    m_cubeSpawnShader.uniform1ui("num_of_particles", m_particleBuffer.size());
-    m_cubeSpawnShader.uniform1ui("accMulti", m_particleBuffer.accPerParticle());
-    m_cubeSpawnShader.uniform1ui("hydMulti", m_particleBuffer.hydPerParticle());
-    m_cubeSpawnShader.dispatch(m_particleBuffer.size(),GENERAL_WGSIZE);
+    mpu::gph::ShaderProgram& cubeSpawnShader = program("ParticleSpawner/cubeSpawn.comp");
+    cubeSpawnShader.uniform3f("upper_bound",upperBound);
+    cubeSpawnShader.uniform3f("lower_bound",lowerBound);
+    cubeSpawnShader.uniform1f("mass",m_particleMass);
+    cubeSpawnShader.uniform1f("initial_smlength", initialSmlength);
+    cubeSpawnShader.uniform1ui("random_seed", seed);
+    cubeSpawnShader.uniform1ui("buffer_size", m_particleBuffer.size());
+    cubeSpawnShader.uniform1ui("num_of_particles", m_particleBuffer.activeSize());
+    cubeSpawnShader.uniform1ui("accMulti", m_particleBuffer.accPerParticle());
+    cubeSpawnShader.uniform1ui("hydMulti", m_particleBuffer.hydPerParticle());
+    cubeSpawnShader.dispatch(m_particleBuffer.activeSize(),GENERAL_WGSIZE);
 }
 
-void ParticleSpawner::spawnParticlesSphere(const float totalMass, const float radius, const float initialSmlength, const glm::vec3 &center)
+void ParticleSpawner::spawnParticlesSphere(const float totalMass, const float radius, const float initialSmlength, uint32_t seed, const glm::vec3 &center)
 {
-    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.size() << " in a sphere volume at position " << glm::to_string(center)
+    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.activeSize() << " in a sphere volume at position " << glm::to_string(center)
                        << " with radius " << radius;
 
     // generate a particle buffer
@@ -78,9 +130,9 @@ void ParticleSpawner::spawnParticlesSphere(const float totalMass, const float ra
     m_totalMass = totalMass;
 
     // calculate particle attributes
-    m_particleMass = m_totalMass / m_particleBuffer.size();
+    m_particleMass = m_totalMass / m_particleBuffer.activeSize();
     m_totalVolume = 3.0/3.0 * M_PI * std::pow(radius,3);
-    m_particleVolume = m_totalVolume / m_particleBuffer.size();
+    m_particleVolume = m_totalVolume / m_particleBuffer.activeSize();
     m_particleDensity = m_particleMass / m_particleVolume;
 
     logDEBUG("Spawner") << "Total volume: " << m_totalVolume;
@@ -89,20 +141,23 @@ void ParticleSpawner::spawnParticlesSphere(const float totalMass, const float ra
                        << "; density=" << m_particleDensity;
 
     // call the shader to do the work
-    m_sphereSpawnShader.uniform3f("center",center);
-    m_sphereSpawnShader.uniform1f("radius",radius);
-    m_sphereSpawnShader.uniform1f("mass",m_particleMass);
-    m_sphereSpawnShader.uniform1f("initial_smlength", initialSmlength);
-    m_sphereSpawnShader.uniform1ui("random_seed", std::time(nullptr)); // time as pseudo random seed
-    m_sphereSpawnShader.uniform1ui("num_of_particles", m_particleBuffer.size());
-    m_sphereSpawnShader.uniform1ui("accMulti", m_particleBuffer.accPerParticle());
-    m_sphereSpawnShader.uniform1ui("hydMulti", m_particleBuffer.hydPerParticle());
-    m_sphereSpawnShader.dispatch(m_particleBuffer.size(),GENERAL_WGSIZE);
+    mpu::gph::ShaderProgram& sphereSpawnShader = program("ParticleSpawner/sphereSpawn.comp");
+    sphereSpawnShader.uniform3f("center",center);
+    sphereSpawnShader.uniform1f("radius",radius);
+    sphereSpawnShader.uniform1f("mass",m_particleMass);
+    sphereSpawnShader.uniform1f("initial_smlength", initialSmlength);
+    sphereSpawnShader.uniform1ui("random_seed", seed);
+    sphereSpawnShader.uniform1ui("num_of_particles", m_particleBuffer.activeSize());
+    sphereSpawnShader.uniform1ui("particle_offset", 0);
+    sphereSpawnShader.uniform1ui("buffer_size", m_particleBuffer.size());
+    sphereSpawnShader.uniform1ui("accMulti", m_particleBuffer.accPerParticle());
+    sphereSpawnShader.uniform1ui("hydMulti", m_particleBuffer.hydPerParticle());
+    sphereSpawnShader.dispatch(m_particleBuffer.activeSize(),GENERAL_WGSIZE);
 }
 
-void ParticleSpawner::spawnParticlesMultiSphere(const float totalMass, const std::vector<Sphere> spheres, const float initialSmlength)
+void ParticleSpawner::spawnParticlesMultiSphere(const float totalMass, const std::vector<Sphere> spheres, const float initialSmlength, uint32_t seed)
 {
-    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.size() << " in " << spheres.size() << " Spheres.";
+    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.activeSize() << " in " << spheres.size() << " Spheres.";
 
     // bind the particle buffer
     m_particleBuffer.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
@@ -112,118 +167,327 @@ void ParticleSpawner::spawnParticlesMultiSphere(const float totalMass, const std
     m_totalMass = totalMass;
 
     // calculate particle attributes
-    m_particleMass = m_totalMass / m_particleBuffer.size();
+    m_particleMass = m_totalMass / m_particleBuffer.activeSize();
 
     logDEBUG("Spawner") << "Particle attributes: mass=" << m_particleMass;
 
+    // uniforms that are the same for all spheres
+    mpu::gph::ShaderProgram& sphereSpawnShader = program("ParticleSpawner/sphereSpawn.comp");
+    sphereSpawnShader.uniform1f("mass", m_particleMass);
+    sphereSpawnShader.uniform1f("initial_smlength", initialSmlength);
+    sphereSpawnShader.uniform1ui("buffer_size", m_particleBuffer.size());
+    sphereSpawnShader.uniform1ui("accMulti", m_particleBuffer.accPerParticle());
+    sphereSpawnShader.uniform1ui("hydMulti", m_particleBuffer.hydPerParticle());
+
     uint32_t writtenParticles = 0;
+    uint32_t sphereSeed = seed; // every sphere gets its own seed, so they do not all look the same
     // spawn all the spheres
     for(auto &&s : spheres)
     {
-        uint32_t particles = static_cast<uint32_t>(m_particleBuffer.size() * s.frac);
+        uint32_t particles = static_cast<uint32_t>(m_particleBuffer.activeSize() * s.frac);
         logDEBUG("Spawner") << "Spawning " << particles << " particles in a sphere with radius=" << s.radius << " at "
                            << glm::to_string(s.center);
-        m_sphereSpawnShader.uniform3f("center", s.center);
-        m_sphereSpawnShader.uniform1f("radius", s.radius);
-        m_sphereSpawnShader.uniform1f("mass", m_particleMass);
-        m_sphereSpawnShader.uniform1f("initial_smlength", initialSmlength);
-        m_sphereSpawnShader.uniform1ui("random_seed", std::time(nullptr)); // time as pseudo random seed
-        m_sphereSpawnShader.uniform1ui("num_of_particles", particles);
-        m_sphereSpawnShader.uniform1ui("particle_offset", writtenParticles);
-        m_sphereSpawnShader.uniform1ui("accMulti", m_particleBuffer.accPerParticle());
-        m_sphereSpawnShader.uniform1ui("hydMulti", m_particleBuffer.hydPerParticle());
-        m_sphereSpawnShader.dispatch(particles, GENERAL_WGSIZE);
+        sphereSpawnShader.uniform3f("center", s.center);
+        sphereSpawnShader.uniform1f("radius", s.radius);
+        sphereSpawnShader.uniform1ui("num_of_particles", particles);
+        sphereSpawnShader.uniform1ui("particle_offset", writtenParticles);
+        sphereSpawnShader.uniform1ui("random_seed", sphereSeed++);
+        sphereSpawnShader.dispatch(particles, GENERAL_WGSIZE);
         writtenParticles += particles;
     }
 
     logDEBUG("Spawner") << "Spawned a total of " << writtenParticles << " particles.";
-    if(writtenParticles != m_particleBuffer.size())
+    if(writtenParticles != m_particleBuffer.activeSize())
     {
         logWARNING("Spawner") << "Sphere ratios do not sum up to 1. Particles spawned: " << writtenParticles
-                              << " desired amount: " << m_particleBuffer.size();
-        m_sphereSpawnShader.uniform1ui("particle_offset", writtenParticles);
-        m_sphereSpawnShader.dispatch(m_particleBuffer.size()-writtenParticles, GENERAL_WGSIZE);
+                              << " desired amount: " << m_particleBuffer.activeSize();
+        sphereSpawnShader.uniform1ui("num_of_particles", m_particleBuffer.activeSize()-writtenParticles);
+        sphereSpawnShader.uniform1ui("particle_offset", writtenParticles);
+        sphereSpawnShader.uniform1ui("random_seed", sphereSeed);
+        sphereSpawnShader.dispatch(m_particleBuffer.activeSize()-writtenParticles, GENERAL_WGSIZE);
     }
 }
 
+void ParticleSpawner::spawnParticlesZoomSphere(const float totalMass, const float radius, const std::vector<ZoomLevel> &levels,
+                                               const float transitionWidth, const float numNeighbours, uint32_t seed, const glm::vec3 &center)
+{
+    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.activeSize() << " in a sphere volume with " << levels.size()
+                        << " zoom levels at position " << glm::to_string(center) << " with radius " << radius;
+
+    // the logarithm of the refinement goes smoothly from 0 outside to log(refinement) inside of each level,
+    // with overlapping levels the strongest refinement wins
+    auto refinement = [levels, transitionWidth](double r)
+    {
+        double logRefinement = 0;
+        for(auto &&level : levels)
+        {
+            const double t = glm::clamp( (r - (level.radius - 0.5*transitionWidth)) / std::max<double>(transitionWidth, 1e-12), 0.0, 1.0);
+            const double inside = 1.0 - t*t*(3.0 - 2.0*t);
+            logRefinement = std::max(logRefinement, inside * std::log(level.refinement));
+        }
+        return std::exp(logRefinement);
+    };
+
+    // the density is uniform, so the number of particles needs to follow the refinement
+    spawnRadial(totalMass, radius, [](double){return 1.0;}, refinement, numNeighbours, seed, center);
+
+    m_totalVolume = 4.0/3.0 * M_PI * std::pow(radius,3);
+    m_particleVolume = m_totalVolume / m_particleBuffer.activeSize();
+    m_particleDensity = m_totalMass / m_totalVolume;
+    for(auto &&level : levels)
+        logDEBUG("Spawner") << "Particles inside r=" << level.radius << " have a mass of " << m_particleMass / refinement(0.5*level.radius)
+                            << " compared to " << m_particleMass << " in the outer region.";
+}
+
+void ParticleSpawner::spawnParticlesPowerLawSphere(const float totalMass, const float radius, const float exponent, const float numNeighbours, uint32_t seed, const glm::vec3 &center)
+{
+    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.activeSize() << " in a power law sphere rho ~ r^-" << exponent
+                        << " at position " << glm::to_string(center) << " with radius " << radius;
+    assert_true(exponent < 3, "Spawner", "Power law exponent needs to be smaller than 3, otherwise the mass is infinite.");
+
+    auto density = [exponent](double r){ return std::pow(r, -exponent);};
+    spawnRadial(totalMass, radius, density, density, numNeighbours, seed, center);
+}
+
+void ParticleSpawner::spawnParticlesBonnorEbertSphere(const float totalMass, const float radius, const float xiMax, const float numNeighbours, uint32_t seed, const glm::vec3 &center)
+{
+    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.activeSize() << " in a bonnor ebert sphere with xi_max=" << xiMax
+                        << " at position " << glm::to_string(center) << " with radius " << radius;
+
+    const std::vector<double> profile = isothermalSphere(xiMax, RADIAL_INTEGRATION_STEPS);
+    logDEBUG("Spawner") << "Center to edge density contrast: " << profile.front() / profile.back();
+
+    auto density = [profile, radius](double r)
+    {
+        const double x = glm::clamp(r / radius, 0.0, 1.0) * (profile.size()-1);
+        const size_t i = std::min(static_cast<size_t>(x), profile.size()-2);
+        return glm::mix(profile[i], profile[i+1], x - i);
+    };
+    spawnRadial(totalMass, radius, density, density, numNeighbours, seed, center);
+}
+
+void ParticleSpawner::spawnParticlesPlummerSphere(const float totalMass, const float radius, const float scaleRadius, const float numNeighbours, uint32_t seed, const glm::vec3 &center)
+{
+    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.activeSize() << " in a plummer sphere with scale radius " << scaleRadius
+                        << " at position " << glm::to_string(center) << " truncated at radius " << radius;
+
+    auto density = [scaleRadius](double r){ return std::pow(1.0 + r*r / (scaleRadius*scaleRadius), -2.5);};
+    spawnRadial(totalMass, radius, density, density, numNeighbours, seed, center);
+}
+
+void ParticleSpawner::spawnRadial(const float totalMass, const float radius, const std::function<double(double)> &density,
+                                  const std::function<double(double)> &numberDensity, const float numNeighbours, uint32_t seed, const glm::vec3 &center)
+{
+    m_particleBuffer.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    const uint32_t numParticles = m_particleBuffer.activeSize();
+
+    // integrate particle number and mass in shells
+    const double dr = radius / RADIAL_INTEGRATION_STEPS;
+    std::vector<double> cumulative(RADIAL_INTEGRATION_STEPS+1, 0.0);
+    double unscaledMass = 0;
+    for(uint32_t i = 1; i <= RADIAL_INTEGRATION_STEPS; i++)
+    {
+        const double r = (i-0.5) * dr;
+        const double shell = 4*M_PI * r*r * dr;
+        cumulative[i] = cumulative[i-1] + shell * numberDensity(r);
+        unscaledMass += shell * density(r);
+    }
+    const double totalNumber = cumulative.back();
+    const double densityScale = totalMass / unscaledMass;
+
+    // first table: radius as a function of the cumulative particle fraction
+    std::vector<float> table(3*RADIAL_TABLE_SIZE);
+    uint32_t shell = 1;
+    for(uint32_t j = 0; j < RADIAL_TABLE_SIZE; j++)
+    {
+        const double target = totalNumber * j / (RADIAL_TABLE_SIZE-1);
+        while(shell < RADIAL_INTEGRATION_STEPS && cumulative[shell] < target)
+            shell++;
+        const double inShell = cumulative[shell] > cumulative[shell-1] ?
+                               (target - cumulative[shell-1]) / (cumulative[shell] - cumulative[shell-1]) : 0.0;
+        table[j] = static_cast<float>((shell - 1 + glm::clamp(inShell,0.0,1.0)) * dr);
+    }
+
+    // second and third table: particle mass and matching smoothing length as a function of r/radius
+    for(uint32_t j = 0; j < RADIAL_TABLE_SIZE; j++)
+    {
+        const double r = std::max(double(j), 0.5) / (RADIAL_TABLE_SIZE-1) * radius; // avoid the singularity at the center
+        const double particlesPerVolume = numParticles * numberDensity(r) / totalNumber;
+        table[RADIAL_TABLE_SIZE + j] = static_cast<float>(densityScale * density(r) / particlesPerVolume);
+        table[2*RADIAL_TABLE_SIZE + j] = static_cast<float>(std::cbrt(3.0 * numNeighbours / (4.0 * M_PI * particlesPerVolume)));
+    }
+
+    m_totalMass = totalMass;
+    m_particleMass = table[2*RADIAL_TABLE_SIZE-1]; // mass at the outer edge
+    logDEBUG("Spawner") << "Particle mass from " << table[RADIAL_TABLE_SIZE] << " at the center to " << m_particleMass
+                        << " at the edge, smoothing length from " << table[2*RADIAL_TABLE_SIZE] << " to " << table.back();
+
+    mpu::gph::Buffer tableBuffer(table);
+    tableBuffer.bindBase(SPAWN_TABLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+
+    mpu::gph::ShaderProgram& radialSpawnShader = program("ParticleSpawner/radialSpawn.comp");
+    radialSpawnShader.uniform3f("center", center);
+    radialSpawnShader.uniform1f("radius", radius);
+    radialSpawnShader.uniform1ui("table_size", RADIAL_TABLE_SIZE);
+    radialSpawnShader.uniform1ui("random_seed", seed);
+    radialSpawnShader.uniform1ui("num_of_particles", numParticles);
+    radialSpawnShader.uniform1ui("particle_offset", 0);
+    radialSpawnShader.uniform1ui("buffer_size", m_particleBuffer.size());
+    radialSpawnShader.uniform1ui("accMulti", m_particleBuffer.accPerParticle());
+    radialSpawnShader.uniform1ui("hydMulti", m_particleBuffer.hydPerParticle());
+    radialSpawnShader.dispatch(numParticles,GENERAL_WGSIZE);
+}
+
+void ParticleSpawner::spawnParticlesGlassSphere(const float totalMass, const float radius, const float initialSmlength, GlassGenerator& glass, uint32_t seed, const glm::vec3 &center)
+{
+    logDEBUG("Spawner") << "Spawning " << m_particleBuffer.activeSize() << " from a glass in a sphere volume at position " << glm::to_string(center)
+                       << " with radius " << radius;
+
+    m_particleBuffer.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+
+    m_totalMass = totalMass;
+
+    // calculate particle attributes
+    m_particleMass = m_totalMass / m_particleBuffer.activeSize();
+    m_totalVolume = 4.0/3.0 * M_PI * std::pow(radius,3);
+    m_particleVolume = m_totalVolume / m_particleBuffer.activeSize();
+    m_particleDensity = m_particleMass / m_particleVolume;
+
+    logDEBUG("Spawner") << "Particle attributes: mass=" << m_particleMass << "; volume=" << m_particleVolume
+                       << "; density=" << m_particleDensity;
+
+    // the glass is cached, so this is only slow the first time
+    std::vector<glm::vec4> positions = glass.unitSphere(m_particleBuffer.activeSize(), seed);
+    for(auto &&p : positions)
+        p = glm::vec4(glm::vec3(p) * radius + center, m_particleMass);
+
+    uploadPositions(positions, initialSmlength);
+}
+
+void ParticleSpawner::uploadPositions(const std::vector<glm::vec4>& positions, const float initialSmlength)
+{
+    mpu::gph::Buffer staging(positions);
+    staging.copyTo(m_particleBuffer.positionBuffer);
+
+    mpu::gph::ShaderProgram& resetShader = program("ParticleSpawner/resetAttributes.comp");
+    resetShader.uniform1ui("num_of_particles", static_cast<uint32_t>(positions.size()));
+    resetShader.uniform1ui("particle_offset", 0);
+    resetShader.uniform1ui("buffer_size", m_particleBuffer.size());
+    resetShader.uniform1f("initial_smlength", initialSmlength);
+    resetShader.uniform1ui("accMulti", m_particleBuffer.accPerParticle());
+    resetShader.uniform1ui("hydMulti", m_particleBuffer.hydPerParticle());
+    resetShader.dispatch(static_cast<uint32_t>(positions.size()),GENERAL_WGSIZE);
+}
+
 void ParticleSpawner::addSimplexVelocityField(float frequency, float scale, int seed)
 {
     m_particleBuffer.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
-    m_initialVelocitySimplexShader.uniform1i("seed", seed);
-    m_initialVelocitySimplexShader.uniform1f("frequency", frequency);
-    m_initialVelocitySimplexShader.uniform1f("scale", scale);
+    mpu::gph::ShaderProgram& initialVelocitySimplexShader = program("ParticleSpawner/initialVelocitySimplex.comp");
+    initialVelocitySimplexShader.uniform1i("seed", seed);
+    initialVelocitySimplexShader.uniform1f("frequency", frequency);
+    initialVelocitySimplexShader.uniform1f("scale", scale);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    m_initialVelocitySimplexShader.dispatch(m_particleBuffer.size(),GENERAL_WGSIZE);
+    initialVelocitySimplexShader.dispatch(m_particleBuffer.activeSize(),GENERAL_WGSIZE);
 }
 
 void ParticleSpawner::addCurlVelocityField(float frequency, float scale, int seed)
 {
     m_particleBuffer.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
-    m_initialVelocityCurlShader.uniform1i("seed", seed);
-    m_initialVelocityCurlShader.uniform1f("frequency", frequency);
-    m_initialVelocityCurlShader.uniform1f("scale", scale);
+    mpu::gph::ShaderProgram& initialVelocityCurlShader = program("ParticleSpawner/initialVelocityCurl.comp");
+    initialVelocityCurlShader.uniform1i("seed", seed);
+    initialVelocityCurlShader.uniform1f("frequency", frequency);
+    initialVelocityCurlShader.uniform1f("scale", scale);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    m_initialVelocityCurlShader.dispatch(m_particleBuffer.size(),GENERAL_WGSIZE);
+    initialVelocityCurlShader.dispatch(m_particleBuffer.activeSize(),GENERAL_WGSIZE);
 }
 
-void ParticleSpawner::addMultiFrequencyCurl(std::vector<std::pair<float, float>> freq, int seed, float hmin, float hmax, float massPerParticle)
+void ParticleSpawner::addMultiFrequencyCurl(std::vector<std::pair<float, float>> freq, int seed, float hmin, float hmax)
 {
     m_particleBuffer.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
-    mpu::gph::ShaderProgram doCurlShader({{PROJECT_SHADER_PATH"ParticleSpawner/doSPHCurl.comp"}},
-                                         {
-                                                 {"WGSIZE",{mpu::toString(GENERAL_WGSIZE)}},
-                                                 {"NUM_PARTICLES",{mpu::toString(m_particleBuffer.size())}},
-                                                 {"TILES_PER_THREAD",{mpu::toString(m_particleBuffer.size() / GENERAL_WGSIZE / 1)}}
-                                         });
-
-    mpu::gph::ShaderProgram densityShader({{PROJECT_SHADER_PATH"Simulation/calculateDensity.comp"}},
-                                          {
-                                                  {"WGSIZE",{mpu::toString(GENERAL_WGSIZE)}},
-                                                  {"NUM_PARTICLES",{mpu::toString(m_particleBuffer.size())}},
-                                                  {"TILES_PER_THREAD",{mpu::toString(m_particleBuffer.size() / GENERAL_WGSIZE / 1)}}
-                                          });
-
-    mpu::gph::ShaderProgram adjustH({{PROJECT_SHADER_PATH"Simulation/calculateH.comp"}});
+    const uint32_t numParticles = m_particleBuffer.activeSize();
+
+    mpu::gph::ShaderProgram& doCurlShader = program("ParticleSpawner/doSPHCurl.comp", tiledDefinitions());
+    doCurlShader.uniform1ui("num_of_particles", numParticles);
+
+    mpu::gph::ShaderProgram& densityShader = program("Simulation/calculateDensity.comp", tiledDefinitions());
+    densityShader.uniform1ui("num_of_particles", numParticles);
+
+    mpu::gph::ShaderProgram& adjustH = program("Simulation/calculateH.comp");
     adjustH.uniform1f("hmin", hmin);
     adjustH.uniform1f("hmax", hmax);
-    adjustH.uniform1f("mass_per_particle", massPerParticle);
     adjustH.uniform1f("num_neighbours",50);
+    adjustH.uniform1ui("num_of_particles", numParticles);
 
-    // generate the potential field
-    srand(seed);
-    auto randSeed = []{return (rand() % static_cast<int>(9999));};
-    for(auto &&item : freq)
+    // generate the potential field, all octaves are summed up in a single dispatch
+    // (or a few, if there are more than MAX_NOISE_OCTAVES)
+    mpu::gph::ShaderProgram& addPotentialShader = program("ParticleSpawner/addPotential.comp",
+                                                          {{"MAX_OCTAVES",{mpu::toString(MAX_NOISE_OCTAVES)}}});
+    addPotentialShader.uniform1ui("num_of_particles", numParticles);
+
+    std::mt19937 rng(seed); // unlike rand() this gives the same sequence on every platform
+    auto randSeed = [&rng]{return static_cast<int>(rng() % 9999);};
+    for(size_t first = 0; first < freq.size(); first += MAX_NOISE_OCTAVES)
     {
-        m_addSimplexShader.uniform1i("seed", randSeed());
-        m_addSimplexShader.uniform1f("frequency", item.first);
-        m_addSimplexShader.uniform1f("scale", item.second);
+        const int numOctaves = static_cast<int>(std::min<size_t>(MAX_NOISE_OCTAVES, freq.size() - first));
+        std::vector<float> frequencies(numOctaves);
+        std::vector<float> scales(numOctaves);
+        std::vector<int> seeds(numOctaves);
+        for(int i = 0; i < numOctaves; i++)
+        {
+            seeds[i] = randSeed();
+            frequencies[i] = freq[first+i].first;
+            scales[i] = freq[first+i].second;
+        }
+
+        glProgramUniform1fv(addPotentialShader, addPotentialShader.uniformLocation("frequency"), numOctaves, frequencies.data());
+        glProgramUniform1fv(addPotentialShader, addPotentialShader.uniformLocation("scale"), numOctaves, scales.data());
+        glProgramUniform1iv(addPotentialShader, addPotentialShader.uniformLocation("seed"), numOctaves, seeds.data());
+        addPotentialShader.uniform1i("num_octaves", numOctaves);
+
+        // a later batch writes the same elements as the previous one, so it needs to wait
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        m_addSimplexShader.dispatch(m_particleBuffer.size(),GENERAL_WGSIZE);
+        addPotentialShader.dispatch(numParticles,GENERAL_WGSIZE);
     }
 
-    // adjust the smoothing length to something usefull
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    densityShader.dispatch(m_particleBuffer.size()*1/GENERAL_WGSIZE);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    adjustH.dispatch(m_particleBuffer.size(),GENERAL_WGSIZE);
+    // adjust the smoothing length to something usefull, two iterations
+    for(int i = 0; i < 2; i++)
+    {
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        densityShader.dispatch((numParticles + GENERAL_WGSIZE - 1) / GENERAL_WGSIZE);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        adjustH.dispatch(numParticles,GENERAL_WGSIZE);
+    }
 
-    // another iteration
+    // now calculate the curl
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    densityShader.dispatch(m_particleBuffer.size()*1/GENERAL_WGSIZE);
+    densityShader.dispatch((numParticles + GENERAL_WGSIZE - 1) / GENERAL_WGSIZE);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    adjustH.dispatch(m_particleBuffer.size(),GENERAL_WGSIZE);
+    doCurlShader.dispatch((numParticles + GENERAL_WGSIZE - 1) / GENERAL_WGSIZE);
+}
 
-    // now calculate the curl
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    densityShader.dispatch(m_particleBuffer.size()*1/GENERAL_WGSIZE);
+void ParticleSpawner::addTurbulentVelocityField(float rmsVelocity, float spectralIndex, float boxSize, uint32_t seed, uint32_t gridSize, const glm::vec3 &center)
+{
+    // the field is generated on the cpu and then interpolated to the particles on the gpu
+    TurbulenceGenerator generator(gridSize);
+    mpu::gph::Buffer grid(generator.generate(rmsVelocity, spectralIndex, seed));
+
+    m_particleBuffer.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    grid.bindBase(TURBULENCE_GRID_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+
+    mpu::gph::ShaderProgram& turbulenceShader = program("ParticleSpawner/addTurbulence.comp");
+    turbulenceShader.uniform1ui("num_of_particles", m_particleBuffer.activeSize());
+    turbulenceShader.uniform1i("grid_size", gridSize);
+    turbulenceShader.uniform3f("box_min", center - glm::vec3(0.5f*boxSize));
+    turbulenceShader.uniform1f("cell_size", boxSize / gridSize);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    doCurlShader.dispatch(m_particleBuffer.size()*1/GENERAL_WGSIZE);
+    turbulenceShader.dispatch(m_particleBuffer.activeSize(),GENERAL_WGSIZE);
 }
 
 void ParticleSpawner::addAngularVelocity(glm::vec3 axis)
 {
     m_particleBuffer.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
-    m_angVelShader.uniform3f("axis", axis);
+    mpu::gph::ShaderProgram& angVelShader = program("ParticleSpawner/angVel.comp");
+    angVelShader.uniform3f("axis", axis);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    m_angVelShader.dispatch(m_particleBuffer.size(),GENERAL_WGSIZE);
+    angVelShader.dispatch(m_particleBuffer.activeSize(),GENERAL_WGSIZE);
 }
@@ -16,10 +16,14 @@
 
 // includes
 //--------------------
+#include <map>
+#include <functional>
 #include <Graphics/Graphics.h>
 #include <Log/Log.h>
 #include "Common.h"
 #include "ParticleBuffer.h"
+#include "GlassGenerator.h"
+#include "TurbulenceGenerator.h"
 //--------------------
 
 //-------------------------------------------------------------------
@@ -35,30 +39,52 @@ struct Sphere
     float frac; // the fraction of total particles to be placed in this sphere
 };
 
+//-------------------------------------------------------------------
+/**
+ * struct ZoomLevel
+ *
+ * Defines a refined region for the zoom-in spawn method. Inside the radius particles are lighter than the base particles by "refinement",
+ * so the region contains refinement times as many particles as it would with uniform resolution.
+ */
+struct ZoomLevel
+{
+    float radius; // radius of the refined region around the spawn center
+    float refinement; // mass of a base particle divided by the mass of a particle in this region
+};
+
 //-------------------------------------------------------------------
 /**
  * class ParticleSpawner
  *
  * usage:
- * Construct a object of this class to compile the needed spawning shader.
+ * Construct a object of this class. Shader programs are compiled the first time they are needed and then cached
+ * together with the set of definitions they were compiled with, so calling a spawn method again does not recompile anything.
  * If you have special needs for the particle buffer (eg mappable) use setBufferFlags() to set the Flags you need.
- * Use one of the spawnParticles functions to spawn the particles as a sphere or cube. the particle Buffer will be overwritten
+ * Use one of the spawnParticles functions to spawn the particles as a sphere or cube. The active particles of the buffer will be overwritten
  * in this process. If you want to add particles to an existing buffer make sure to make a copy beforehand. The new Buffer will be bound at
  * the PARTICLE_BUFFER_BINDING specified in the Common.h make sure the same index is used in the shader.
  * Remember to sync memory after spawning (glMemorieBarrier(...))!
+ * All random numbers are derived from the seed passed to the functions, so spawning with the same seeds and parameters
+ * creates the same particles. Use ParticleBuffer::checksum() to verify that two runs start from the same state.
  *
  */
 class ParticleSpawner
 {
 public:
-    ParticleSpawner(); //!< constructor will compile shader
-    void spawnParticlesCube(const float totalMass, const glm::vec3 &upperBound, const glm::vec3 &lowerBound, const float initialSmlength); //!< spawns particles in a cube
-    void spawnParticlesSphere(const float totalMass, const float radius, const float initialSmlength, const glm::vec3 &center = {0, 0, 0}); //!< spawns particles in a sphere
-    void spawnParticlesMultiSphere(const float totalMass, const std::vector<Sphere> spheres, const float initialSmlength); //!< spawns particles in a multiple spheres
+    ParticleSpawner() = default; //!< shaders are compiled lazily on first use
+    void spawnParticlesCube(const float totalMass, const glm::vec3 &upperBound, const glm::vec3 &lowerBound, const float initialSmlength, uint32_t seed); //!< spawns particles in a cube
+    void spawnParticlesSphere(const float totalMass, const float radius, const float initialSmlength, uint32_t seed, const glm::vec3 &center = {0, 0, 0}); //!< spawns particles in a sphere
+    void spawnParticlesMultiSphere(const float totalMass, const std::vector<Sphere> spheres, const float initialSmlength, uint32_t seed); //!< spawns particles in a multiple spheres
+    void spawnParticlesZoomSphere(const float totalMass, const float radius, const std::vector<ZoomLevel> &levels, const float transitionWidth, const float numNeighbours, uint32_t seed, const glm::vec3 &center = {0, 0, 0}); //!< spawns a uniform sphere with nested regions of lighter particles, mass changes smoothly over transitionWidth
+    void spawnParticlesPowerLawSphere(const float totalMass, const float radius, const float exponent, const float numNeighbours, uint32_t seed, const glm::vec3 &center = {0, 0, 0}); //!< spawns a sphere with density proportional to r^-exponent (exponent < 3)
+    void spawnParticlesBonnorEbertSphere(const float totalMass, const float radius, const float xiMax, const float numNeighbours, uint32_t seed, const glm::vec3 &center = {0, 0, 0}); //!< spawns a bonnor ebert sphere, the outer edge is at dimensionless radius xiMax (6.451 is critical)
+    void spawnParticlesPlummerSphere(const float totalMass, const float radius, const float scaleRadius, const float numNeighbours, uint32_t seed, const glm::vec3 &center = {0, 0, 0}); //!< spawns a plummer sphere with scaleRadius, truncated at radius
+    void spawnParticlesGlassSphere(const float totalMass, const float radius, const float initialSmlength, GlassGenerator& glass, uint32_t seed, const glm::vec3 &center = {0, 0, 0}); //!< spawns particles in a sphere using a relaxed glass instead of random positions
 
     void addSimplexVelocityField(float frequency, float scale, int seed); //!< adds a initial random velocity field based on simplex noise to the particles
     void addCurlVelocityField(float frequency, float scale, int seed); //!< adds a initial random velocity fiels based on curl noise to the particles
-    void addMultiFrequencyCurl(std::vector<std::pair<float, float>> freq, int seed, float hmin, float hmax, float massPerParticle); //!< add multiple frequencies of simplex noise and calculate the curl using sph methods (him and max are parameters for the adjust-H-shader)
+    void addMultiFrequencyCurl(std::vector<std::pair<float, float>> freq, int seed, float hmin, float hmax); //!< add multiple frequencies of simplex noise and calculate the curl using sph methods (him and max are parameters for the adjust-H-shader)
+    void addTurbulentVelocityField(float rmsVelocity, float spectralIndex, float boxSize, uint32_t seed, uint32_t gridSize = 64, const glm::vec3 &center = {0, 0, 0}); //!< adds a divergence free gaussian random velocity field with power spectrum k^-spectralIndex, generated by a fft on a periodic box of size boxSize
     void addAngularVelocity(glm::vec3 axis); //!< adds a angular velocity around the axis "Axis" speed depends on the length of axis
 
     // getter
@@ -72,12 +98,13 @@ public:
     void setBuffer(ParticleBuffer buffer){m_particleBuffer=buffer;} //!< set the buffer that is filled with particles
 
 private:
-    mpu::gph::ShaderProgram m_cubeSpawnShader; //!< shader for spawning particles in a cube
-    mpu::gph::ShaderProgram m_sphereSpawnShader; //!< shader for spawning particles in a spere
-    mpu::gph::ShaderProgram m_initialVelocitySimplexShader; //!< shader for adding initial velocity
-    mpu::gph::ShaderProgram m_initialVelocityCurlShader; //!< shader for adding initial velocity
-    mpu::gph::ShaderProgram m_addSimplexShader; //!< shader for adding simplex noise to the particles acceleration field
-    mpu::gph::ShaderProgram m_angVelShader; //!< shader for adding rotational velocity
+    mpu::gph::ShaderProgram& program(const std::string& file, const std::vector<mpu::gph::glsl::Definition>& definitions = {}); //!< returns the program for file compiled with definitions, compiles it on first use
+    std::vector<mpu::gph::glsl::Definition> tiledDefinitions() const; //!< definitions for the shaders that use a fixed work group size and loop over all particles
+    void spawnRadial(const float totalMass, const float radius, const std::function<double(double)> &density, const std::function<double(double)> &numberDensity,
+                     const float numNeighbours, uint32_t seed, const glm::vec3 &center); //!< spawns particles following a radial number density (shape only) and sets masses to match the radial mass density (shape only)
+    void uploadPositions(const std::vector<glm::vec4>& positions, const float initialSmlength); //!< copies positions to the particle buffer and resets all other attributes
+
+    std::map<std::string, mpu::gph::ShaderProgram> m_programCache; //!< all programs compiled so far, keyed by file and definitions
 
     ParticleBuffer m_particleBuffer; //!< the buffer where the particles are stored
 
@@ -0,0 +1,57 @@
+/*
+ * GraSPH
+ * PortableRandom.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements functions to turn the output of a std::mt19937 into floating point random numbers
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_PORTABLERANDOM_H
+#define GRASPH_PORTABLERANDOM_H
+
+// includes
+//--------------------
+#include <random>
+#include <cmath>
+#include <utility>
+//--------------------
+
+// The sequence of a std::mt19937 is defined by the standard, but the results of std::uniform_real_distribution and
+// std::normal_distribution are implementation defined. Use these functions instead where the initial conditions need to
+// be reproducible with a different standard library. Box-Muller still uses std::log, std::sqrt and std::cos,
+// so results might differ in the last bits between math libraries.
+
+/**
+ * @brief returns a float uniformly distributed in [0,1), uses one number of rng
+ */
+inline float uniformFloat(std::mt19937& rng)
+{
+    return static_cast<float>(rng() >> 8) * (1.0f / 16777216.0f);
+}
+
+/**
+ * @brief returns a double uniformly distributed in (0,1], uses two numbers of rng
+ */
+inline double uniformDoubleNonZero(std::mt19937& rng)
+{
+    const uint64_t high = rng() >> 5;
+    const uint64_t low = rng() >> 6;
+    return static_cast<double>((high << 26) + low + 1) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief returns two independent standard normal distributed numbers using the Box-Muller transform, uses four numbers of rng
+ */
+inline std::pair<double,double> normalPair(std::mt19937& rng)
+{
+    const double r = std::sqrt(-2.0 * std::log(uniformDoubleNonZero(rng)));
+    const double phi = 2.0 * M_PI * uniformDoubleNonZero(rng);
+    return {r * std::cos(phi), r * std::sin(phi)};
+}
+
+#endif //GRASPH_PORTABLERANDOM_H
@@ -0,0 +1,75 @@
+/*
+ * GraSPH
+ * ResolutionControl.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the ResolutionControl class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "ResolutionControl.h"
+//--------------------
+
+// function definitions of the ResolutionControl class
+//-------------------------------------------------------------------
+ResolutionControl::ResolutionControl(ParticleBuffer buffer, float mergeDensity, float maxMass, float jeansFactor, float minMass,
+                                     float numNeighbours)
+    : m_centerOfMassShader({{PROJECT_SHADER_PATH"ResolutionControl/centerOfMass.comp"}},
+                           {{"WGSIZE",{mpu::toString(GENERAL_WGSIZE)}}}),
+      m_findPartnersShader({{PROJECT_SHADER_PATH"ResolutionControl/findMergePartners.comp"}},
+                           {{"WGSIZE",{mpu::toString(GENERAL_WGSIZE)}}}),
+      m_mergeShader({{PROJECT_SHADER_PATH"ResolutionControl/mergeParticles.comp"}}),
+      m_splitShader({{PROJECT_SHADER_PATH"ResolutionControl/splitParticles.comp"}},
+                    {{"NUM_PARTICLES",{mpu::toString(buffer.size())}}}),
+      m_particleBuffer(buffer)
+{
+    m_partnerBuffer.recreate();
+    m_partnerBuffer.allocate<uint32_t>(buffer.size());
+    m_centerOfMassBuffer.recreate();
+    m_centerOfMassBuffer.allocate(std::vector<float>(8, 0.0f), GL_DYNAMIC_STORAGE_BIT);
+
+    m_findPartnersShader.uniform1f("merge_density", mergeDensity);
+    m_findPartnersShader.uniform1f("max_mass", maxMass);
+    m_splitShader.uniform1f("jeans_factor", jeansFactor);
+    m_splitShader.uniform1f("min_mass", minMass);
+    m_splitShader.uniform1f("num_neighbours", numNeighbours);
+
+    bind();
+    logDEBUG("ResolutionControl") << "Resolution control initialized. Merge density: " << mergeDensity
+                                  << ", maximum mass: " << maxMass << ", jeans factor: " << jeansFactor
+                                  << ", minimum mass: " << minMass;
+}
+
+void ResolutionControl::bind()
+{
+    m_partnerBuffer.bindBase(MERGE_PARTNER_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_centerOfMassBuffer.bindBase(CENTER_OF_MASS_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+}
+
+void ResolutionControl::mergeAndSplit()
+{
+    const uint32_t numParticles = m_particleBuffer.activeSize();
+    const uint32_t groups = (numParticles + GENERAL_WGSIZE - 1) / GENERAL_WGSIZE;
+    m_centerOfMassShader.uniform1ui("num_of_particles", numParticles);
+    m_findPartnersShader.uniform1ui("num_of_particles", numParticles);
+    m_mergeShader.uniform1ui("num_of_particles", numParticles);
+    m_splitShader.uniform1ui("num_of_particles", numParticles);
+    m_splitShader.uniform1ui("random_seed", m_randomSeed++);
+
+    // outflowing gas is found relative to the center of mass, it is summed up from zero every time
+    m_centerOfMassBuffer.write(std::vector<float>(8, 0.0f));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_centerOfMassShader.dispatch(groups);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_findPartnersShader.dispatch(groups);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_mergeShader.dispatch(numParticles,GENERAL_WGSIZE);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_splitShader.dispatch(numParticles,GENERAL_WGSIZE);
+}
@@ -0,0 +1,60 @@
+/*
+ * GraSPH
+ * ResolutionControl.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the ResolutionControl class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_RESOLUTIONCONTROL_H
+#define GRASPH_RESOLUTIONCONTROL_H
+
+// includes
+//--------------------
+#include <Graphics/Graphics.h>
+#include <Log/Log.h>
+#include "Common.h"
+#include "ParticleBuffer.h"
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class ResolutionControl
+ *
+ * usage:
+ * Changes the resolution of the simulation by merging and splitting particles. Pairs of particles below the merge density
+ * that flow away from the center of mass of all particles are merged into one particle. Particles where the jeans mass is smaller then jeansFactor times the
+ * mass of its neighbours are split into two particles. Mass, momentum and center of mass are conserved in both cases.
+ * Merged particles are flagged for removal and split particles are appended behind the active particles, so the particle
+ * buffer needs to have space left and a ParticleCompactor must be bound. Call ParticleCompactor::compact() after mergeAndSplit().
+ *
+ */
+class ResolutionControl
+{
+public:
+    ResolutionControl() = default;
+    ResolutionControl(ParticleBuffer buffer, float mergeDensity, float maxMass, float jeansFactor, float minMass, float numNeighbours); //!< compile shader and create buffer
+
+    void bind(); //!< bind the merge partner buffer
+    void mergeAndSplit(); //!< merge and split particles, make sure hydro values and speed of sound are up to date
+
+private:
+    mpu::gph::ShaderProgram m_centerOfMassShader; //!< sums up mass, position and momentum of all particles
+    mpu::gph::ShaderProgram m_findPartnersShader; //!< every particle that can merge chooses a partner
+    mpu::gph::ShaderProgram m_mergeShader; //!< particles that chose each other are merged
+    mpu::gph::ShaderProgram m_splitShader; //!< particles with unresolved jeans mass are split
+
+    mpu::gph::Buffer m_partnerBuffer{nullptr}; //!< merge partner for each particle
+    mpu::gph::Buffer m_centerOfMassBuffer{nullptr}; //!< mass weighted position, mass and momentum of all particles
+    ParticleBuffer m_particleBuffer; //!< the particles
+
+    uint32_t m_randomSeed{0}; //!< increased every time particles are split
+};
+
+
+#endif //GRASPH_RESOLUTIONCONTROL_H
@@ -40,6 +40,28 @@ constexpr float TOTAL_MASS              = 20; // total mass of all particles
 constexpr float SPAWN_RADIUS            = 6; // radius of the initial cloud
 constexpr unsigned int NUM_PARTICLES    = 16384; // total number of particles, use power of 2 for convenience
 
+// initial conditions
+constexpr unsigned int SPAWN_SEED       = 1612; // all random numbers used for spawning are derived from this, same seed means same initial conditions
+constexpr bool USE_GLASS                = false; // spawn particles from a relaxed glass instead of random positions
+constexpr unsigned int GLASS_SEED       = 1612; // seed used for the random positions the glass is relaxed from
+constexpr float GLASS_TOLERANCE         = 0.01; // relaxation stops when the rms of the relative density fluctuations is below this
+constexpr int GLASS_MAX_ITERATIONS      = 2000; // maximum number of relaxation steps
+const std::string GLASS_CACHE_DIRECTORY = "glass_cache"; // relaxed glasses are stored here and reused, leave empty to disable the cache
+const std::string IC_FILE                = ""; // load particles from this binary file instead of spawning them, see InitialConditionLoader.h for the format
+constexpr unsigned int IC_CHUNK_SIZE    = 65536; // number of particles uploaded at once while loading IC_FILE
+constexpr bool USE_ZOOM                 = false; // spawn lighter particles in the center of the cloud (overrides USE_GLASS)
+constexpr float ZOOM_RADIUS             = 0.25f*SPAWN_RADIUS; // radius of the refined region
+constexpr float ZOOM_REFINEMENT         = 10; // particles in the refined region are this much lighter
+constexpr float ZOOM_TRANSITION         = 0.1f*SPAWN_RADIUS; // width of the layer where the particle mass changes
+constexpr int DENSITY_PROFILE            = 0; // 0: uniform, 1: power law, 2: bonnor ebert, 3: plummer (overrides USE_GLASS, ignored with USE_ZOOM)
+constexpr float POWER_LAW_EXPONENT      = 1.5; // rho ~ r^-exponent for the power law profile
+constexpr float BONNOR_EBERT_XI         = 6.451; // dimensionless outer radius of the bonnor ebert sphere, 6.451 is critical
+constexpr float PLUMMER_RADIUS          = 0.3f*SPAWN_RADIUS; // scale radius of the plummer profile
+constexpr bool USE_FFT_TURBULENCE       = false; // use a fft generated turbulent velocity field instead of multi frequency curl noise
+constexpr float TURBULENCE_RMS_VELOCITY = 0.3; // rms velocity of the turbulent field
+constexpr float TURBULENCE_SPECTRAL_INDEX = 4; // power per mode falls of with k^-index, 4 gives a burgers like spectrum
+constexpr unsigned int TURBULENCE_GRID  = 64; // grid resolution used for the fft, power of 2
+
 // gravity
 constexpr float EPS_FACTOR  = 0.2; // a particle behaves like a plummer sphere with a radius equal to its smoothing length multiplied by this factor
 
@@ -59,6 +81,36 @@ constexpr float INITIAL_H       = 0.3; // initial kernel radius
 constexpr float HMIN            = 0.025; // smallest kernel radius
 constexpr float HMAX            = 2; // biggest kernel radius
 
+// sink particles
+constexpr bool ENABLE_SINKS             = false; // turn collapsed gas into sink particles, which removes the gas particles from the simulation
+constexpr float SINK_DENSITY_THRESHOLD  = 32768; // density above which a particle may become a sink
+constexpr float SINK_RADIUS             = HMIN; // accretion radius of new sink particles
+constexpr unsigned int MAX_SINKS        = 1024; // maximum number of sink particles
+constexpr unsigned int SINK_WGSIZE      = 256; // work group size used to compute the forces on a sink
+
+// resolution control
+constexpr bool ENABLE_RESOLUTION_CONTROL            = false; // merge particles in unimportant regions and split particles where the jeans mass is not resolved
+constexpr unsigned int RESOLUTION_CONTROL_INTERVAL  = 10; // number of simulation steps between merging and splitting
+constexpr float MERGE_DENSITY                       = 0.002; // outflowing particles below this density can be merged
+constexpr float MERGE_MAX_MASS                      = 4*TOTAL_MASS / NUM_PARTICLES; // particles will not be merged above this mass
+constexpr float SPLIT_JEANS_FACTOR                  = 2; // particles are split when the jeans mass is less then this times the mass of all neighbours
+constexpr float SPLIT_MIN_MASS                      = 0.25f*TOTAL_MASS / NUM_PARTICLES; // particles will not be split below this mass
+
+// distributed simulation (only used when compiled with GRASPH_USE_MPI)
+constexpr unsigned int LOAD_BALANCE_INTERVAL    = 50; // number of simulation steps between load balancing
+constexpr unsigned int PSEUDO_PARTICLE_CELLS    = 8; // cells per dimension used to approximate the gravity of other domains
+
+// buffer size, only leave headroom when split particles or ghosts of other domains need it
+#ifdef GRASPH_USE_MPI
+constexpr unsigned int PARTICLE_CAPACITY    = 2*NUM_PARTICLES; // local particles plus ghosts of the neighbouring domains
+#else
+constexpr unsigned int PARTICLE_CAPACITY    = ENABLE_RESOLUTION_CONTROL ? 2*NUM_PARTICLES : NUM_PARTICLES; // maximum number of particles when particles are split
+#endif
+
+// scheduling
+constexpr double SIMULATION_FRAME_BUDGET    = 0.014; // gpu time in seconds the simulation may use before the renderer gets new positions
+constexpr unsigned int MAX_STEPS_PER_FRAME  = 64; // maximum number of simulation steps before the renderer gets new positions
+
 // visuals
 constexpr int HEIGHT    = 1024; // window size in px
 constexpr int WIDTH     = 1024;
@@ -66,7 +118,40 @@ constexpr float PARTICLE_RENDER_SIZE    = 0.08; // radius of a particle
 constexpr float PARTICLE_BRIGHTNESS     = 0.9; // radius of a particle
 const glm::vec4 PARTICLE_COLOR          = glm::vec4(0.9,0.3,0.1,1); // color of the particle
 const glm::vec4 REFBOX_COLOR            = glm::vec4(0.5,0.9,0.5,1); // color of the reference box
+const glm::vec4 SINK_COLOR              = glm::vec4(0.2,0.4,1.0,1); // color of sink particles
+constexpr float SINK_RENDER_SIZE        = 0.1; // radius of a sink particle
 constexpr float PERFORMANCE_DISPLAY_INT = 4.0f; // seconds between performance display is updated
+constexpr std::size_t FRAME_STATS_WINDOW = 1024; // frame time percentiles are computed over this many frames
+constexpr double FRAME_SPIKE_THRESHOLD  = 0.1; // frames that take longer (in seconds) are logged with the profiling zones they contain, 0 to disable
+constexpr bool SPLAT_RENDERING          = false; // render the column density using the SPH kernel instead of sprites
+constexpr int SPLAT_DOWNSAMPLE          = 2; // the column density is accumulated at viewport size / SPLAT_DOWNSAMPLE
+constexpr bool PARTICLE_CULLING         = false; // only draw particles inside of the view frustum (gpu culling pass)
+constexpr float CULL_MIN_PIXEL_RADIUS   = 0.5f; // sprites with a smaller radius in pixel are drawn as single points
+constexpr bool LOD_RENDERING           = false; // draw far away particles aggregated in the nodes of an octree
+constexpr unsigned int LOD_LEVELS       = 7; // levels of the LOD octree, the finest has 2^(LOD_LEVELS-1) cells per dimension
+constexpr unsigned int LOD_REBUILD_INTERVAL = 10; // simulation steps between rebuilding the LOD octree
+constexpr float LOD_MAX_PIXEL_SIZE      = 2.0f; // octree nodes that appear smaller (in pixel) are drawn as one sprite
+
+// movie recording
+constexpr bool RECORD_MOVIE             = false; // render into an offscreen framebuffer and write every new snapshot to an image
+constexpr bool MOVIE_HEADLESS           = false; // hide the window and start the simulation right away
+constexpr int MOVIE_WIDTH               = 1920; // resolution of the movie in px, independent of the window size
+constexpr int MOVIE_HEIGHT              = 1080;
+constexpr bool MOVIE_PNG                = true; // write png files, otherwise raw rgba
+constexpr unsigned int MOVIE_FRAMES     = 0; // stop after this many frames, 0 to record until the window is closed
+constexpr int MOVIE_ENCODER_THREADS     = 4; // threads encoding and writing frames
+const std::string MOVIE_DIRECTORY       = "movie"; // frames are written here
+
+// metrics
+constexpr bool EXPORT_METRICS           = false; // periodically write performance metrics to files
+constexpr int METRICS_EXPORT_INTERVAL   = 5000; // milliseconds between two exports
+const std::string METRICS_PROMETHEUS_FILE = "grasph.prom"; // prometheus text format, replaced on every export, empty to disable
+const std::string METRICS_JSON_FILE     = "grasph_metrics.jsonl"; // one line of json is appended on every export, empty to disable
+
+// profiling
+constexpr bool ENABLE_PROFILING         = false; // record cpu and gpu time of the simulation passes, define MPU_NO_PROFILING to remove all zones
+const std::string PROFILE_TRACE_FILE    = "grasph_trace.json"; // chrome trace written on exit, empty to disable
+constexpr unsigned int GPU_ZONES_PER_STEP = 16; // upper bound of the gpu profiling zones in one simulation step, sizes the query ring
 
 // threads and workgroups
 constexpr unsigned int DENSITY_THREADS_PER_PARTICLE = 16;
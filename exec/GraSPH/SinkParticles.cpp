@@ -0,0 +1,147 @@
+/*
+ * GraSPH
+ * SinkParticles.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the SinkParticles class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "SinkParticles.h"
+#include "Settings.h"
+//--------------------
+
+// function definitions of the SinkParticles class
+//-------------------------------------------------------------------
+SinkParticles::SinkParticles(ParticleBuffer buffer, uint32_t maxSinks, float densityThreshold, float sinkRadius, float epsFactor)
+    : m_candidateShader({{PROJECT_SHADER_PATH"Sinks/findSinkCandidates.comp"}},
+                        {
+                                {"MAX_SINKS",{mpu::toString(maxSinks)}},
+                                {"WGSIZE",{mpu::toString(SINK_WGSIZE)}}
+                        }),
+      m_formShader({{PROJECT_SHADER_PATH"Sinks/formSinks.comp"}},
+                   {
+                           {"MAX_SINKS",{mpu::toString(maxSinks)}},
+                           {"WGSIZE",{mpu::toString(SINK_WGSIZE)}}
+                   }),
+      m_accreteShader({{PROJECT_SHADER_PATH"Sinks/accreteGas.comp"}},
+                      {
+                              {"MAX_SINKS",{mpu::toString(maxSinks)}},
+                              {"WGSIZE",{mpu::toString(SINK_WGSIZE)}}
+                      }),
+      m_applyAccretionShader({{PROJECT_SHADER_PATH"Sinks/applyAccretion.comp"}},{{"MAX_SINKS",{mpu::toString(maxSinks)}}}),
+      m_gasGravityShader({{PROJECT_SHADER_PATH"Sinks/sinkGravity.comp"}},{{"MAX_SINKS",{mpu::toString(maxSinks)}}}),
+      m_sinkAccelerationShader({{PROJECT_SHADER_PATH"Sinks/sinkAcceleration.comp"}},
+                               {
+                                       {"MAX_SINKS",{mpu::toString(maxSinks)}},
+                                       {"WGSIZE",{mpu::toString(SINK_WGSIZE)}}
+                               }),
+      m_integrateShader({{PROJECT_SHADER_PATH"Sinks/integrateSinks.comp"}},{{"MAX_SINKS",{mpu::toString(maxSinks)}}}),
+      m_particleBuffer(buffer),
+      m_maxSinks(maxSinks)
+{
+    // the count and the dispatch arguments (zero groups) are followed by the sinks, everything starts at zero
+    std::vector<uint32_t> sinkData(sinkBufferHeaderSize/sizeof(uint32_t) + maxSinks*sizeof(Sink)/sizeof(uint32_t), 0);
+    sinkData[2] = 1;
+    sinkData[3] = 1;
+    m_sinkBuffer.recreate();
+    m_sinkBuffer.allocate(sinkData);
+    m_accretionBuffer.recreate();
+    m_accretionBuffer.allocate(std::vector<float>(8*maxSinks, 0.0f));
+    m_candidateBuffer.recreate();
+    m_candidateBuffer.allocate<uint32_t>(buffer.size());
+    m_countReadback.recreate();
+    m_countReadback.allocate<uint32_t>(1, GL_MAP_READ_BIT);
+
+    m_candidateShader.uniform1f("density_threshold", densityThreshold);
+    m_candidateShader.uniform1f("sink_radius", sinkRadius);
+    m_formShader.uniform1f("sink_radius", sinkRadius);
+    m_gasGravityShader.uniform1f("eps_factor2", epsFactor*epsFactor);
+    m_sinkAccelerationShader.uniform1f("eps_factor2", epsFactor*epsFactor);
+
+    bind();
+    logDEBUG("Sinks") << "Sink particles initialized. Maximum number of sinks: " << m_maxSinks
+                      << ", density threshold: " << densityThreshold << ", accretion radius: " << sinkRadius;
+}
+
+void SinkParticles::bind()
+{
+    m_sinkBuffer.bindBase(SINK_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_accretionBuffer.bindBase(SINK_ACCRETION_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+    m_candidateBuffer.bindBase(SINK_CANDIDATE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+}
+
+void SinkParticles::addGravity()
+{
+    // the number of sinks is only known on the gpu, without sinks the shaders return right away
+    const uint32_t numParticles = m_particleBuffer.activeSize();
+    m_gasGravityShader.uniform1ui("num_of_particles", numParticles);
+    m_sinkAccelerationShader.uniform1ui("num_of_particles", numParticles);
+
+    m_gasGravityShader.dispatch(numParticles,GENERAL_WGSIZE);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_sinkBuffer);
+    m_sinkAccelerationShader.dispatchIndirect(sinkDispatchOffset);
+}
+
+void SinkParticles::integrate(float dt, float nextDt)
+{
+    m_integrateShader.uniform1f("dt", dt);
+    m_integrateShader.uniform1f("next_dt", nextDt);
+    m_integrateShader.dispatch(m_maxSinks,GENERAL_WGSIZE);
+}
+
+void SinkParticles::formAndAccrete()
+{
+    const uint32_t numParticles = m_particleBuffer.activeSize();
+    const uint32_t groups = (numParticles + SINK_WGSIZE - 1) / SINK_WGSIZE;
+    m_candidateShader.uniform1ui("num_of_particles", numParticles);
+    m_formShader.uniform1ui("num_of_particles", numParticles);
+    m_accreteShader.uniform1ui("num_of_particles", numParticles);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_candidateShader.dispatch(groups);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_formShader.dispatch(groups);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_accreteShader.dispatch(groups);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    m_applyAccretionShader.dispatch(m_maxSinks,GENERAL_WGSIZE);
+
+    readNumberOfSinks();
+}
+
+void SinkParticles::readNumberOfSinks()
+{
+    // the copy is only read once it is done, so we never wait for the gpu
+    if(m_countFence)
+    {
+        if(glClientWaitSync(m_countFence.get(), GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+            return;
+
+        const uint32_t sinkCounter = m_countReadback.read<uint32_t>(1,0)[0];
+        if(sinkCounter > m_maxSinks && !m_overflowWarned)
+        {
+            logWARNING("Sinks") << "Maximum number of sinks (" << m_maxSinks << ") reached, no more sinks will be created.";
+            m_overflowWarned = true;
+        }
+
+        const uint32_t numSinks = std::min(sinkCounter, m_maxSinks);
+        if(numSinks != m_numSinks)
+        {
+            logDEBUG("Sinks") << "Number of sinks changed from " << m_numSinks << " to " << numSinks;
+            m_numSinks = numSinks;
+        }
+    }
+
+    // start the next readback
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_sinkBuffer.copyTo<uint32_t>(m_countReadback,1);
+    m_countFence.reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), glDeleteSync);
+}
@@ -0,0 +1,94 @@
+/*
+ * GraSPH
+ * SinkParticles.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the SinkParticles class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_SINKPARTICLES_H
+#define GRASPH_SINKPARTICLES_H
+
+// includes
+//--------------------
+#include <Graphics/Graphics.h>
+#include <Log/Log.h>
+#include "Common.h"
+#include "ParticleBuffer.h"
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class SinkParticles
+ *
+ * usage:
+ * Manages sink particles, which represent gas that collapsed below the resolution of the simulation.
+ * A sink is created from a particle above the density threshold if the gas around it is bound and converging.
+ * Sinks accrete all bound gas inside their accretion radius and only take part in the simulation via gravity.
+ * Particles are accreted by setting their mass to zero and counting them in the control buffer of a ParticleCompactor,
+ * make sure to bind it and call ParticleCompactor::compact() after formAndAccrete().
+ *
+ * Call addGravity() after the accelerations of the gas particles were calculated and integrate() together with the gas
+ * integrator. Then call formAndAccrete() using the new particle positions.
+ *
+ * The number of sinks stays on the gpu, passes that run once per sink use indirect dispatch. It is read back
+ * asynchronously for size(), so size() might lag behind the simulation by a few steps.
+ *
+ * The sink buffer starts with the number of sinks and the indirect dispatch arguments (16 byte) followed by the sinks.
+ * Each sink is a Sink struct of three vec4, see shader/Sinks/sinkBuffer.glsl.
+ *
+ */
+class SinkParticles
+{
+public:
+    struct Sink
+    {
+        glm::vec4 position; //!< w is the mass
+        glm::vec4 velocity; //!< w is the accretion radius
+        glm::vec4 acceleration; //!< w is unused
+    };
+    static constexpr uint32_t sinkBufferHeaderSize = sizeof(glm::vec4); //!< size of the count in front of the first sink in bytes
+    static constexpr GLintptr sinkDispatchOffset = sizeof(uint32_t); //!< offset of the indirect dispatch arguments in the sink buffer
+
+    SinkParticles() = default;
+    SinkParticles(ParticleBuffer buffer, uint32_t maxSinks, float densityThreshold, float sinkRadius, float epsFactor); //!< compile shader and create the sink buffer
+
+    void bind(); //!< bind the sink and accretion buffer
+    void addGravity(); //!< add the gravity of the sinks to the gas and calculate the acceleration of the sinks
+    void integrate(float dt, float nextDt); //!< integrate the sinks using the same leapfrog scheme as the gas
+    void formAndAccrete(); //!< form new sinks and let all sinks accrete the gas around them
+
+    uint32_t size() const {return m_numSinks;} //!< returns the last number of sinks that was read back from the gpu
+    uint32_t maxSize() const {return m_maxSinks;} //!< returns the maximum number of sinks
+    mpu::gph::Buffer getSinkBuffer() const {return m_sinkBuffer;} //!< returns the buffer where the sinks are stored
+
+private:
+    void readNumberOfSinks(); //!< update m_numSinks if the last readback finished, and start a new one
+
+    mpu::gph::ShaderProgram m_candidateShader; //!< finds dense bound particles that may turn into sinks
+    mpu::gph::ShaderProgram m_formShader; //!< turns the densest candidates into sinks
+    mpu::gph::ShaderProgram m_accreteShader; //!< particles get accreted by a sink
+    mpu::gph::ShaderProgram m_applyAccretionShader; //!< the accreted mass and momentum is added to the sink
+    mpu::gph::ShaderProgram m_gasGravityShader; //!< gravity of the sinks acting on the gas
+    mpu::gph::ShaderProgram m_sinkAccelerationShader; //!< gravity of gas and other sinks acting on the sinks
+    mpu::gph::ShaderProgram m_integrateShader; //!< integrates the sinks
+
+    mpu::gph::Buffer m_sinkBuffer{nullptr}; //!< number of sinks and the sinks
+    mpu::gph::Buffer m_accretionBuffer{nullptr}; //!< mass, momentum and center of mass of the accreted gas for each sink
+    mpu::gph::Buffer m_candidateBuffer{nullptr}; //!< one flag per particle, set if it may turn into a sink
+    mpu::gph::Buffer m_countReadback{nullptr}; //!< the number of sinks is copied here to be read without waiting for the gpu
+    std::shared_ptr<std::remove_pointer_t<GLsync>> m_countFence; //!< signaled when the copy to m_countReadback is done
+    ParticleBuffer m_particleBuffer; //!< the gas particles
+
+    uint32_t m_maxSinks{0}; //!< maximum number of sinks
+    uint32_t m_numSinks{0}; //!< number of sinks as of the last readback
+    bool m_overflowWarned{false}; //!< true if there already was a warning about reaching the maximum number of sinks
+};
+
+
+#endif //GRASPH_SINKPARTICLES_H
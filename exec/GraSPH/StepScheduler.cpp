@@ -0,0 +1,61 @@
+/*
+ * GraSPH
+ * StepScheduler.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the StepScheduler class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "StepScheduler.h"
+//--------------------
+
+// function definitions of the StepScheduler class
+//-------------------------------------------------------------------
+StepScheduler::StepScheduler(double frameBudget, unsigned int maxSteps)
+    : m_queryPending(numQueries, false),
+      m_frameBudget(frameBudget),
+      m_maxSteps(std::max(maxSteps,1u))
+{
+    for(unsigned int i = 0; i < numQueries; i++)
+        m_queries.emplace_back(GL_TIME_ELAPSED);
+}
+
+void StepScheduler::beginStep()
+{
+    // the result of the last step that used this query should be ready by now
+    if(m_queryPending[m_currentQuery])
+        readResult(m_currentQuery);
+
+    m_queries[m_currentQuery].begin();
+}
+
+void StepScheduler::endStep()
+{
+    m_queries[m_currentQuery].end();
+    m_queryPending[m_currentQuery] = true;
+    m_currentQuery = (m_currentQuery + 1) % numQueries;
+}
+
+void StepScheduler::readResult(unsigned int query)
+{
+    const uint64_t stepTimeNs = m_queries[query].result();
+    const double stepTime = stepTimeNs * 1.0e-9;
+    m_queryPending[query] = false;
+    if(m_stepTimeHistogram)
+        m_stepTimeHistogram->record(stepTimeNs);
+
+    m_averageStepTime = (m_averageStepTime > 0) ? (1.0-smoothing) * m_averageStepTime + smoothing * stepTime : stepTime;
+
+    const double steps = (m_averageStepTime > 0) ? m_frameBudget / m_averageStepTime : m_maxSteps;
+    const unsigned int newStepsPerFrame = static_cast<unsigned int>(glm::clamp(steps, 1.0, double(m_maxSteps)));
+    if(newStepsPerFrame != m_stepsPerFrame)
+        logDEBUG2("StepScheduler") << "Running " << newStepsPerFrame << " steps per frame, average step time is " << m_averageStepTime*1000.0 << " ms.";
+    m_stepsPerFrame = newStepsPerFrame;
+}
@@ -0,0 +1,68 @@
+/*
+ * GraSPH
+ * StepScheduler.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the StepScheduler class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_STEPSCHEDULER_H
+#define GRASPH_STEPSCHEDULER_H
+
+// includes
+//--------------------
+#include <vector>
+#include <Graphics/Graphics.h>
+#include <Log/Log.h>
+#include <Metrics/Histogram.h>
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class StepScheduler
+ *
+ * usage:
+ * Decides how many simulation steps are run before the result is handed to the renderer.
+ * The gpu time of every step is measured using timer queries. Results are read a few steps later, so measuring
+ * does not stall the pipeline. The number of steps per frame is then chosen, so the steps fit into the frame budget.
+ *
+ * Call beginStep() and endStep() around each simulation step and use stepsPerFrame() to find out how many steps
+ * to run before publishing the next frame. At least one and at most maxSteps steps are run per frame.
+ *
+ */
+class StepScheduler
+{
+public:
+    StepScheduler(double frameBudget, unsigned int maxSteps); //!< frameBudget is the gpu time in seconds the simulation may use per frame
+
+    void beginStep(); //!< call before a simulation step is started
+    void endStep(); //!< call after all commands of a simulation step were issued
+
+    unsigned int stepsPerFrame() const {return m_stepsPerFrame;} //!< number of steps to run before the next frame is published
+    double averageStepTime() const {return m_averageStepTime;} //!< average gpu time of a step in seconds
+    void setStepTimeHistogram(mpu::Histogram* histogram) {m_stepTimeHistogram = histogram;} //!< every measured step time is also recorded here (in ns), nullptr to disable
+
+private:
+    static constexpr unsigned int numQueries = 4; //!< number of steps that can be in flight before results are read
+    static constexpr double smoothing = 0.1; //!< weight of a new measurement in the average step time
+
+    void readResult(unsigned int query); //!< update the step time using the result of a query
+
+    std::vector<mpu::gph::Query> m_queries; //!< one time elapsed query per step in flight
+    std::vector<bool> m_queryPending; //!< true if the query was used and its result was not read yet
+    unsigned int m_currentQuery{0}; //!< query used for the current step
+
+    double m_frameBudget; //!< gpu time per frame in seconds
+    unsigned int m_maxSteps; //!< upper limit of steps per frame
+    double m_averageStepTime{0}; //!< average gpu time of one step in seconds
+    unsigned int m_stepsPerFrame{1}; //!< current number of steps per frame
+    mpu::Histogram* m_stepTimeHistogram{nullptr}; //!< optional histogram of all measured step times
+};
+
+
+#endif //GRASPH_STEPSCHEDULER_H
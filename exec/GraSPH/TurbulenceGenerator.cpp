@@ -0,0 +1,162 @@
+/*
+ * GraSPH
+ * TurbulenceGenerator.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the TurbulenceGenerator class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "TurbulenceGenerator.h"
+#include "PortableRandom.h"
+#include <cmath>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <Log/Log.h>
+//--------------------
+
+// function definitions of the TurbulenceGenerator class
+//-------------------------------------------------------------------
+TurbulenceGenerator::TurbulenceGenerator(uint32_t gridSize) : m_gridSize(gridSize)
+{
+    assert_critical(gridSize >= 2 && (gridSize & (gridSize-1)) == 0, "TurbulenceGenerator", "Grid size needs to be a power of 2.");
+}
+
+std::vector<glm::vec4> TurbulenceGenerator::generate(float rmsVelocity, float spectralIndex, uint32_t seed, float kmin, float kmax) const
+{
+    const uint32_t n = m_gridSize;
+    const size_t cells = size_t(n)*n*n;
+    if(kmax <= 0)
+        kmax = n/2;
+
+    logDEBUG("Turbulence") << "Generating turbulent velocity field on a " << n << "^3 grid, spectral index " << spectralIndex
+                           << ", k from " << kmin << " to " << kmax << ", seed " << seed;
+
+    // draw the modes, six normal random numbers are drawn for every cell so the field only depends on the seed and the grid size
+    std::mt19937 rng(seed);
+    std::vector<complex> field[3] = {std::vector<complex>(cells), std::vector<complex>(cells), std::vector<complex>(cells)};
+    for(uint32_t z = 0; z < n; z++)
+        for(uint32_t y = 0; y < n; y++)
+            for(uint32_t x = 0; x < n; x++)
+            {
+                complex a[3];
+                for(auto &&c : a)
+                {
+                    const std::pair<double,double> normal = normalPair(rng);
+                    c = complex(normal.first, normal.second);
+                }
+
+                const glm::dvec3 k( (x <= n/2) ? double(x) : double(x) - n,
+                                    (y <= n/2) ? double(y) : double(y) - n,
+                                    (z <= n/2) ? double(z) : double(z) - n);
+                const double kLength = glm::length(k);
+                if(kLength < kmin || kLength > kmax || kLength == 0)
+                    continue;
+
+                // remove the compressive part, so only modes perpendicular to k remain
+                const complex kDotA = k.x*a[0] + k.y*a[1] + k.z*a[2];
+                const double amplitude = std::pow(kLength, -0.5*spectralIndex);
+                const size_t id = (size_t(z)*n + y)*n + x;
+                for(int i = 0; i < 3; i++)
+                    field[i][id] = amplitude * (a[i] - k[i] * kDotA / (kLength*kLength));
+            }
+
+    // transform each component in its own thread
+    std::thread workers[3];
+    for(int i = 0; i < 3; i++)
+        workers[i] = std::thread([this, &field, i]{ fft3d(field[i], true); });
+    for(auto &&worker : workers)
+        worker.join();
+
+    // the real part of a divergence free field is still divergence free, so we do not need hermitian symmetry
+    std::vector<glm::vec4> velocity(cells);
+    double sumV2 = 0;
+    for(size_t id = 0; id < cells; id++)
+    {
+        const glm::dvec3 v(field[0][id].real(), field[1][id].real(), field[2][id].real());
+        sumV2 += glm::dot(v,v);
+        velocity[id] = glm::vec4(v, 0);
+    }
+
+    const double rms = std::sqrt(sumV2 / cells);
+    if(rms > 0)
+    {
+        const float scale = static_cast<float>(rmsVelocity / rms);
+        for(auto &&v : velocity)
+            v *= scale;
+    }
+    else
+        logWARNING("Turbulence") << "No modes between kmin and kmax, turbulent velocity field is zero.";
+
+    return velocity;
+}
+
+void TurbulenceGenerator::fft(complex* data, uint32_t n, bool inverse)
+{
+    // bit reversal permutation
+    for(uint32_t i = 1, j = 0; i < n; i++)
+    {
+        uint32_t bit = n >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j)
+            std::swap(data[i], data[j]);
+    }
+
+    // butterflies
+    for(uint32_t length = 2; length <= n; length <<= 1)
+    {
+        const double angle = 2 * M_PI / length * (inverse ? 1 : -1);
+        const complex wLength(std::cos(angle), std::sin(angle));
+        for(uint32_t i = 0; i < n; i += length)
+        {
+            complex w(1);
+            for(uint32_t j = 0; j < length/2; j++)
+            {
+                const complex u = data[i+j];
+                const complex v = data[i+j+length/2] * w;
+                data[i+j] = u + v;
+                data[i+j+length/2] = u - v;
+                w *= wLength;
+            }
+        }
+    }
+}
+
+void TurbulenceGenerator::fft3d(std::vector<complex>& data, bool inverse) const
+{
+    const uint32_t n = m_gridSize;
+    std::vector<complex> line(n);
+
+    // one pass per axis, every line is copied so the transform can work on contiguous memory
+    const size_t strides[3] = {1, n, size_t(n)*n};
+    for(size_t stride : strides)
+    {
+        for(size_t a = 0; a < n; a++)
+            for(size_t b = 0; b < n; b++)
+            {
+                // start of the line, the two other axes are a and b
+                size_t start;
+                if(stride == 1)
+                    start = (a*n + b)*n;
+                else if(stride == n)
+                    start = a*n*n + b;
+                else
+                    start = a*n + b;
+
+                for(uint32_t i = 0; i < n; i++)
+                    line[i] = data[start + i*stride];
+                fft(line.data(), n, inverse);
+                for(uint32_t i = 0; i < n; i++)
+                    data[start + i*stride] = line[i];
+            }
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * GraSPH
+ * TurbulenceGenerator.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the TurbulenceGenerator class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef GRASPH_TURBULENCEGENERATOR_H
+#define GRASPH_TURBULENCEGENERATOR_H
+
+// includes
+//--------------------
+#include <complex>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class TurbulenceGenerator
+ *
+ * usage:
+ * Generates a divergence free gaussian random velocity field on a periodic grid with gridSize^3 cells (gridSize needs to be a power of 2).
+ * The amplitude of every mode is drawn from a normal distribution with variance k^-spectralIndex for kmin <= |k| <= kmax (in units of
+ * the fundamental mode), the compressive part is removed in fourier space and the field is transformed back using a 3D FFT.
+ * The result is scaled so that the rms velocity equals rmsVelocity. The same seed and parameters always produce the same field.
+ * The field is returned as a vector of vec4 in x-major order (w is unused), ready to be uploaded to the gpu.
+ *
+ */
+class TurbulenceGenerator
+{
+public:
+    explicit TurbulenceGenerator(uint32_t gridSize = 64); //!< set the grid resolution
+    std::vector<glm::vec4> generate(float rmsVelocity, float spectralIndex, uint32_t seed, float kmin = 1, float kmax = 0) const; //!< generate the field, kmax = 0 means gridSize/2
+
+    uint32_t gridSize() const {return m_gridSize;} //!< number of cells in each direction
+
+private:
+    typedef std::complex<double> complex;
+    static void fft(complex* data, uint32_t n, bool inverse); //!< in place radix 2 fft of a contiguous array
+    void fft3d(std::vector<complex>& data, bool inverse) const; //!< fft along all three axis of a gridSize^3 array
+
+    uint32_t m_gridSize; //!< number of cells in each direction
+};
+
+
+#endif //GRASPH_TURBULENCEGENERATOR_H
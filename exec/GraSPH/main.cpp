@@ -1,15 +1,32 @@
 #include <Log/Log.h>
 #include <Log/ConsoleSink.h>
-#include <Timer/DeltaTimer.h>
+#include <Timer/FrameTimer.h>
 #include <Graphics/Graphics.h>
 #include <numeric>
+#include <algorithm>
 #include <Timer/Stopwatch.h>
+#include <Metrics/MetricsExporter.h>
+#include <Profiler/Profiler.h>
+#include <thread>
+#include <atomic>
 
 #include "Common.h"
 #include "ParticleSpawner.h"
+#include "InitialConditionLoader.h"
 #include "ParticleRenderer.h"
+#include "ParticleCompactor.h"
+#include "SinkParticles.h"
+#include "ResolutionControl.h"
+#include "DoubleBufferedSnapshot.h"
+#include "StepScheduler.h"
+#include "MovieRecorder.h"
 #include "Settings.h"
 
+#ifdef GRASPH_USE_MPI
+    #include "DomainDecomposition.h"
+    #include "DistributedParticles.h"
+#endif
+
 double DT = INITIAL_DT;
 
 long double timeUnitInYears(const long double time)
@@ -60,6 +77,12 @@ float getNextRefCubeSize()
     return size;
 }
 
+uint32_t tiledWorkGroups(uint32_t numParticles, uint32_t wgSize, uint32_t threadsPerParticle)
+{
+    // one work group per tile of particles alive, for each thread that works on the same particle
+    return (numParticles + wgSize - 1) / wgSize * threadsPerParticle;
+}
+
 static const std::vector<GLfloat> cube =
 {
         -0.5f,-0.5f,-0.5f,
@@ -98,8 +121,24 @@ int main()
     // initialise log
     mpu::Log mainLog(mpu::DEBUG, mpu::ConsoleSink());
 
+#ifdef GRASPH_USE_MPI
+    // every rank simulates its own domain on its own gpu, only rank 0 is displayed
+    // all communication happens in the simulation thread, never in two threads at once
+    int mpiThreadSupport;
+    MPI_Init_thread(nullptr, nullptr, MPI_THREAD_SERIALIZED, &mpiThreadSupport);
+    if(mpiThreadSupport < MPI_THREAD_SERIALIZED)
+        logWARNING("MPI") << "MPI library does not support calls from the simulation thread.";
+    std::atexit([](){MPI_Finalize();});
+    DomainDecomposition decomposition;
+    const bool isMainRank = decomposition.rank() == 0;
+#else
+    const bool isMainRank = true;
+#endif
+
     // create window and init gl
     mpu::gph::Window window(WIDTH,HEIGHT,"Star Formation Sim");
+    if(!isMainRank || (RECORD_MOVIE && MOVIE_HEADLESS))
+        window.hide();
 
     // add the shader include pathes
     mpu::gph::addShaderIncludePath(LIB_SHADER_PATH);
@@ -108,7 +147,13 @@ int main()
     // set some gl options
     glClearColor(0, 0, 0, 1);
     glClearDepth(1.f);
-    mpu::gph::enableVsync(false);
+    mpu::gph::enableVsync(true); // the simulation runs in its own thread, so rendering can stay at display rate
+
+    // profiling zones are always compiled in, but only recorded when ENABLE_PROFILING is set
+    mpu::Profiler::setEnabled(ENABLE_PROFILING);
+    mpu::Profiler::setThreadName("Render");
+    mpu::gph::GpuProfiler renderGpuProfiler("GPU render");
+    renderGpuProfiler.makeCurrent();
 
     // set up a reference cube
     mpu::gph::Buffer refCubeVert(cube);
@@ -119,19 +164,70 @@ int main()
     cubeRefShader.uniform4f("color",REFBOX_COLOR);
 
     // generate some particles
-    ParticleBuffer pb(NUM_PARTICLES,ACCEL_THREADS_PER_PARTICLE,DENSITY_THREADS_PER_PARTICLE);
-    ParticleSpawner spawner;
-    spawner.setBuffer(pb);
-    spawner.spawnParticlesSphere(TOTAL_MASS,SPAWN_RADIUS, INITIAL_H);
+    // leave some room for particles created by splitting
+    // when running distributed, rank 0 spawns all particles and sends them to the other ranks
+    ParticleBuffer pb(PARTICLE_CAPACITY,ACCEL_THREADS_PER_PARTICLE,DENSITY_THREADS_PER_PARTICLE);
+    pb.setActiveSize(isMainRank ? NUM_PARTICLES : 0);
+    if(isMainRank && !IC_FILE.empty())
+    {
+        PROFILE_SCOPE("load initial conditions");
+        InitialConditionLoader loader(IC_CHUNK_SIZE);
+        loader.load(pb, IC_FILE, INITIAL_H);
+    }
+    else if(isMainRank)
+    {
+        PROFILE_GPU_SCOPE("spawn");
+        ParticleSpawner spawner;
+        spawner.setBuffer(pb);
+        if(USE_ZOOM)
+            spawner.spawnParticlesZoomSphere(TOTAL_MASS, SPAWN_RADIUS, {{ZOOM_RADIUS, ZOOM_REFINEMENT}}, ZOOM_TRANSITION, NUM_NEIGHBOURS, SPAWN_SEED);
+        else if(DENSITY_PROFILE == 1)
+            spawner.spawnParticlesPowerLawSphere(TOTAL_MASS, SPAWN_RADIUS, POWER_LAW_EXPONENT, NUM_NEIGHBOURS, SPAWN_SEED);
+        else if(DENSITY_PROFILE == 2)
+            spawner.spawnParticlesBonnorEbertSphere(TOTAL_MASS, SPAWN_RADIUS, BONNOR_EBERT_XI, NUM_NEIGHBOURS, SPAWN_SEED);
+        else if(DENSITY_PROFILE == 3)
+            spawner.spawnParticlesPlummerSphere(TOTAL_MASS, SPAWN_RADIUS, PLUMMER_RADIUS, NUM_NEIGHBOURS, SPAWN_SEED);
+        else if(USE_GLASS)
+        {
+            GlassGenerator glass(GLASS_CACHE_DIRECTORY, GLASS_TOLERANCE, GLASS_MAX_ITERATIONS, NUM_NEIGHBOURS);
+            spawner.spawnParticlesGlassSphere(TOTAL_MASS, SPAWN_RADIUS, INITIAL_H, glass, GLASS_SEED);
+        }
+        else
+            spawner.spawnParticlesSphere(TOTAL_MASS,SPAWN_RADIUS, INITIAL_H, SPAWN_SEED);
+
+        if(USE_FFT_TURBULENCE)
+            spawner.addTurbulentVelocityField(TURBULENCE_RMS_VELOCITY, TURBULENCE_SPECTRAL_INDEX, 2*SPAWN_RADIUS, SPAWN_SEED, TURBULENCE_GRID);
+        else
+            spawner.addMultiFrequencyCurl( {
+                                                   {{0.9},{0.1}},
+                                                   {{0.6},{0.3}},
+                                                   {{0.4},{0.3}},
+                                                   {{0.3},{0.6}},
+                                           },SPAWN_SEED,HMIN,HMAX);
+        spawner.addAngularVelocity({0,0.15f,0});
+    }
+    if(isMainRank) // runs with the same checksum start from exactly the same state
+        logINFO("Spawner") << "Initial conditions: " << pb.activeSize() << " particles, checksum " << pb.checksum();
+    pb.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+
+#ifdef GRASPH_USE_MPI
+    // split the particles along a space filling curve
+    DistributedParticles distributed(pb, decomposition, PSEUDO_PARTICLE_CELLS, EPS_FACTOR);
+    distributed.balance();
+#endif
 
-    spawner.addMultiFrequencyCurl( {
-                                           {{0.9},{0.1}},
-                                           {{0.6},{0.3}},
-                                           {{0.4},{0.3}},
-                                           {{0.3},{0.6}},
-                                   },1612,HMIN,HMAX,TOTAL_MASS / NUM_PARTICLES);
-    spawner.addAngularVelocity({0,0.15f,0});
+    // removes particles that where accreted by sinks
+    ParticleCompactor compactor(pb);
 
+    // sink particles
+    SinkParticles sinks;
+    if(ENABLE_SINKS)
+        sinks = SinkParticles(pb, MAX_SINKS, SINK_DENSITY_THRESHOLD, SINK_RADIUS, EPS_FACTOR);
+
+    // merging and splitting of particles
+    ResolutionControl resolutionControl;
+    if(ENABLE_RESOLUTION_CONTROL)
+        resolutionControl = ResolutionControl(pb, MERGE_DENSITY, MERGE_MAX_MASS, SPLIT_JEANS_FACTOR, SPLIT_MIN_MASS, NUM_NEIGHBOURS);
 
     // create a renderer
     ParticleRenderer renderer;
@@ -143,6 +239,13 @@ int main()
     renderer.setColor(PARTICLE_COLOR);
     renderer.setBrightness(PARTICLE_BRIGHTNESS);
     renderer.setSize(PARTICLE_RENDER_SIZE);
+    if(ENABLE_SINKS)
+        renderer.setSinkBuffer(sinks.getSinkBuffer());
+    renderer.setSinkColor(SINK_COLOR);
+    renderer.setSinkSize(SINK_RENDER_SIZE);
+    renderer.enableSplatting(SPLAT_RENDERING, SPLAT_DOWNSAMPLE);
+    renderer.enableCulling(PARTICLE_CULLING, CULL_MIN_PIXEL_RADIUS);
+    renderer.enableLod(LOD_RENDERING, LOD_REBUILD_INTERVAL, LOD_MAX_PIXEL_SIZE, LOD_LEVELS);
 
     // create camera
     mpu::gph::Camera camera(std::make_shared<mpu::gph::SimpleWASDController>(&window,10,4));
@@ -150,24 +253,33 @@ int main()
     camera.setClip(0.0001,200);
     camera.setPosition({0,0, 2.5 * SPAWN_RADIUS});
 
+    // render to image files
+    std::unique_ptr<MovieRecorder> recorder;
+    if(RECORD_MOVIE && isMainRank)
+    {
+        recorder = std::make_unique<MovieRecorder>(MOVIE_DIRECTORY, glm::uvec2(MOVIE_WIDTH,MOVIE_HEIGHT),
+                                                   MOVIE_PNG ? FrameFormat::PNG : FrameFormat::RAW, 3, MOVIE_ENCODER_THREADS);
+        renderer.setViewportSize(recorder->resolution());
+        camera.setAspect(float(MOVIE_WIDTH) / float(MOVIE_HEIGHT));
+    }
+
 
     // compile and confiure all the shader
     mpu::gph::ShaderProgram adjustH({{PROJECT_SHADER_PATH"Simulation/calculateH.comp"}});
     adjustH.uniform1f("hmin",HMIN);
     adjustH.uniform1f("hmax",HMAX);
-    adjustH.uniform1f("mass_per_particle", TOTAL_MASS / NUM_PARTICLES);
     adjustH.uniform1f("num_neighbours",NUM_NEIGHBOURS);
 
     mpu::gph::ShaderProgram densityShader({{PROJECT_SHADER_PATH"Simulation/calculateDensity.comp"}},
                                           {
                                             {"WGSIZE",{mpu::toString(DENSITY_WGSIZE)}},
-                                            {"NUM_PARTICLES",{mpu::toString(NUM_PARTICLES)}},
-                                            {"TILES_PER_THREAD",{mpu::toString(NUM_PARTICLES / DENSITY_WGSIZE / DENSITY_THREADS_PER_PARTICLE)}}
+                                            {"NUM_PARTICLES",{mpu::toString(PARTICLE_CAPACITY)}},
+                                            {"THREADS_PER_PARTICLE",{mpu::toString(DENSITY_THREADS_PER_PARTICLE)}}
                                           });
 
     mpu::gph::ShaderProgram hydroAccum({{PROJECT_SHADER_PATH"Simulation/densityAccumulator.comp"}},
                                   {
-                                   {"NUM_PARTICLES",{mpu::toString(NUM_PARTICLES)}},
+                                   {"NUM_PARTICLES",{mpu::toString(PARTICLE_CAPACITY)}},
                                    {"HYDROS_PER_PARTICLE",{mpu::toString(DENSITY_THREADS_PER_PARTICLE)}}
                                   });
     hydroAccum.uniform1f("a",A);
@@ -178,8 +290,8 @@ int main()
     mpu::gph::ShaderProgram pressureShader({{PROJECT_SHADER_PATH"Simulation/calculateAcceleration.comp"}},
                                            {
                                                    {"WGSIZE",{mpu::toString(PRESSURE_WGSIZE)}},
-                                                   {"NUM_PARTICLES",{mpu::toString(NUM_PARTICLES)}},
-                                                   {"TILES_PER_THREAD",{mpu::toString(NUM_PARTICLES / PRESSURE_WGSIZE / ACCEL_THREADS_PER_PARTICLE)}}
+                                                   {"NUM_PARTICLES",{mpu::toString(PARTICLE_CAPACITY)}},
+                                                   {"THREADS_PER_PARTICLE",{mpu::toString(ACCEL_THREADS_PER_PARTICLE)}}
                                            });
     pressureShader.uniform1f("alpha",VISC);
     pressureShader.uniform1f("eps_factor2",EPS_FACTOR*EPS_FACTOR);
@@ -189,7 +301,7 @@ int main()
 
     mpu::gph::ShaderProgram integrator({{PROJECT_SHADER_PATH"Simulation/integrateLeapfrog.comp"}},
                                       {
-                                       {"NUM_PARTICLES",{mpu::toString(NUM_PARTICLES)}},
+                                       {"NUM_PARTICLES",{mpu::toString(PARTICLE_CAPACITY)}},
                                        {"ACCELERATIONS_PER_PARTICLE",{mpu::toString(ACCEL_THREADS_PER_PARTICLE)}}
                                       });
     integrator.uniform1f("dt",DT);
@@ -204,46 +316,162 @@ int main()
     mmb.bindBase(MM_BUFFER_BINDING,GL_SHADER_STORAGE_BUFFER);
 
     // group shader dispatches into useful functions
-    auto findSml = [densityShader,hydroAccum,adjustH](int iterations)
+    auto setNumberOfParticles = [densityShader,pressureShader,hydroAccum,integrator,adjustH](uint32_t numParticles)
+    {
+        adjustH.uniform1ui("num_of_particles",numParticles);
+        densityShader.uniform1ui("num_of_particles",numParticles);
+        hydroAccum.uniform1ui("num_of_particles",numParticles);
+        pressureShader.uniform1ui("num_of_particles",numParticles);
+        integrator.uniform1ui("num_of_particles",numParticles);
+    };
+
+    auto findSml = [densityShader,hydroAccum,adjustH,pb,setNumberOfParticles
+#ifdef GRASPH_USE_MPI
+                    ,&distributed
+#endif
+                    ](int iterations)
     {
+        PROFILE_GPU_SCOPE("findSml");
         for(int i=0; i<iterations; i++)
         {
+#ifdef GRASPH_USE_MPI
+            distributed.exchangeGhosts();
+#endif
+            setNumberOfParticles(pb.activeSize());
             glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-            densityShader.dispatch(NUM_PARTICLES*DENSITY_THREADS_PER_PARTICLE/DENSITY_WGSIZE);
+            densityShader.dispatch(tiledWorkGroups(pb.activeSize(),DENSITY_WGSIZE,DENSITY_THREADS_PER_PARTICLE));
             glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-            hydroAccum.dispatch(NUM_PARTICLES,GENERAL_WGSIZE);
+            hydroAccum.dispatch(pb.activeSize(),GENERAL_WGSIZE);
             glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-            adjustH.dispatch(NUM_PARTICLES,GENERAL_WGSIZE);
+#ifdef GRASPH_USE_MPI
+            // ghosts did not see all their neighbours, they are updated by their owner
+            distributed.removeGhosts();
+            adjustH.uniform1ui("num_of_particles",pb.activeSize());
+#endif
+            adjustH.dispatch(pb.activeSize(),GENERAL_WGSIZE);
         }
     };
 
-    auto startSimulation = [densityShader,pressureShader,hydroAccum,integrator,adjustH]()
+    auto startSimulation = [densityShader,pressureShader,hydroAccum,integrator,adjustH,pb,setNumberOfParticles
+#ifdef GRASPH_USE_MPI
+                            ,&distributed
+#endif
+                            ]()
     {
+        PROFILE_GPU_SCOPE("startSimulation");
+#ifdef GRASPH_USE_MPI
+        distributed.exchangeGhosts();
+#endif
+        uint32_t numParticles = pb.activeSize();
+        setNumberOfParticles(numParticles);
 
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        densityShader.dispatch(NUM_PARTICLES*DENSITY_THREADS_PER_PARTICLE/DENSITY_WGSIZE);
+        densityShader.dispatch(tiledWorkGroups(numParticles,DENSITY_WGSIZE,DENSITY_THREADS_PER_PARTICLE));
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        hydroAccum.dispatch(NUM_PARTICLES,GENERAL_WGSIZE);
+        hydroAccum.dispatch(numParticles,GENERAL_WGSIZE);
+#ifdef GRASPH_USE_MPI
+        distributed.updateGhostHydro();
+#endif
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        pressureShader.dispatch(NUM_PARTICLES*ACCEL_THREADS_PER_PARTICLE/PRESSURE_WGSIZE);
+        pressureShader.dispatch(tiledWorkGroups(numParticles,PRESSURE_WGSIZE,ACCEL_THREADS_PER_PARTICLE));
+#ifdef GRASPH_USE_MPI
+        distributed.removeGhosts();
+        numParticles = pb.activeSize();
+        setNumberOfParticles(numParticles);
+        distributed.addRemoteGravity();
+#endif
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
         integrator.uniform1f("not_first_step",1);
-        integrator.dispatch(NUM_PARTICLES,GENERAL_WGSIZE);
+        integrator.dispatch(numParticles,GENERAL_WGSIZE);
         integrator.uniform1f("not_first_step",1);
     };
 
-    auto simulate = [densityShader,pressureShader,hydroAccum,integrator,adjustH]()
+    uint32_t stepsSinceResolutionControl = 0;
+    auto simulate = [densityShader,pressureShader,hydroAccum,integrator,adjustH,pb,setNumberOfParticles,
+                     &sinks,&resolutionControl,&compactor,&stepsSinceResolutionControl
+#ifdef GRASPH_USE_MPI
+                     ,&distributed
+#endif
+                     ](double nextDt)
     {
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        adjustH.dispatch(NUM_PARTICLES,GENERAL_WGSIZE);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        densityShader.dispatch(NUM_PARTICLES*DENSITY_THREADS_PER_PARTICLE/DENSITY_WGSIZE);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        hydroAccum.dispatch(NUM_PARTICLES,GENERAL_WGSIZE);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        pressureShader.dispatch(NUM_PARTICLES*ACCEL_THREADS_PER_PARTICLE/PRESSURE_WGSIZE);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        integrator.dispatch(NUM_PARTICLES,GENERAL_WGSIZE);
+        // particles might have been added or removed, so only simulate the ones that are alive
+        uint32_t numParticles = pb.activeSize();
+        setNumberOfParticles(numParticles);
+
+        {
+            PROFILE_GPU_SCOPE("adjustH");
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            adjustH.dispatch(numParticles,GENERAL_WGSIZE);
+        }
+#ifdef GRASPH_USE_MPI
+        {
+            // ghosts are appended after the local particles, with the smoothing length their owner just computed
+            PROFILE_GPU_SCOPE("exchangeGhosts");
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            distributed.exchangeGhosts();
+            numParticles = pb.activeSize();
+            setNumberOfParticles(numParticles);
+        }
+#endif
+        {
+            PROFILE_GPU_SCOPE("density");
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            densityShader.dispatch(tiledWorkGroups(numParticles,DENSITY_WGSIZE,DENSITY_THREADS_PER_PARTICLE));
+        }
+        {
+            PROFILE_GPU_SCOPE("hydro");
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            hydroAccum.dispatch(numParticles,GENERAL_WGSIZE);
+#ifdef GRASPH_USE_MPI
+            distributed.updateGhostHydro();
+#endif
+        }
+        {
+            PROFILE_GPU_SCOPE("pressure");
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            pressureShader.dispatch(tiledWorkGroups(numParticles,PRESSURE_WGSIZE,ACCEL_THREADS_PER_PARTICLE));
+        }
+#ifdef GRASPH_USE_MPI
+        {
+            // from here on only local particles are simulated
+            PROFILE_GPU_SCOPE("remoteGravity");
+            distributed.removeGhosts();
+            numParticles = pb.activeSize();
+            setNumberOfParticles(numParticles);
+            distributed.addRemoteGravity();
+        }
+#endif
+        if(ENABLE_SINKS)
+        {
+            PROFILE_GPU_SCOPE("sinkGravity");
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            sinks.addGravity();
+        }
+        {
+            PROFILE_GPU_SCOPE("integrate");
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            integrator.dispatch(numParticles,GENERAL_WGSIZE);
+        }
+
+        if(ENABLE_SINKS)
+        {
+            PROFILE_GPU_SCOPE("sinks");
+            sinks.integrate(DT,nextDt);
+            sinks.formAndAccrete();
+        }
+
+        if(ENABLE_RESOLUTION_CONTROL && ++stepsSinceResolutionControl >= RESOLUTION_CONTROL_INTERVAL)
+        {
+            PROFILE_GPU_SCOPE("resolutionControl");
+            stepsSinceResolutionControl = 0;
+            resolutionControl.mergeAndSplit();
+        }
+
+        if(ENABLE_SINKS || ENABLE_RESOLUTION_CONTROL)
+        {
+            PROFILE_GPU_SCOPE("compact");
+            compactor.compact();
+        }
     };
 
     findSml(20);
@@ -257,26 +485,195 @@ int main()
     glm::vec3 refCubePos{0,0,0};
     float refCubeSpeed = 0.2;
 
+    // performance metrics, they are always recorded and written to files if EXPORT_METRICS is set
+    mpu::MetricsRegistry metrics;
+    mpu::Counter& stepCounter = metrics.counter("grasph_steps_total", "Number of simulation steps.");
+    mpu::Histogram& stepTime = metrics.histogram("grasph_step_seconds", "Wall time of a simulation step including the timestep readback.", {}, 1.0e-9);
+    mpu::Histogram& stepGpuTime = metrics.histogram("grasph_step_gpu_seconds", "Gpu time of a simulation step.", {}, 1.0e-9);
+    mpu::Histogram& frameTime = metrics.histogram("grasph_frame_seconds", "Time between two rendered frames.", {}, 1.0e-9);
+    mpu::Gauge& dtGauge = metrics.gauge("grasph_dt", "Current timestep in internal units.");
+    mpu::Gauge& simulatedYears = metrics.gauge("grasph_simulated_years", "Simulated time in years.");
+    mpu::Gauge& yearsPerSecond = metrics.gauge("grasph_simulated_years_per_second", "Simulated years per second of wall time.");
+    mpu::Gauge& particleGauge = metrics.gauge("grasph_particles", "Number of particles on this rank.");
+    mpu::Gauge& sinkGauge = metrics.gauge("grasph_sinks", "Number of sink particles.");
+    dtGauge.set(DT);
+
+    std::unique_ptr<mpu::MetricsExporter> metricsExporter;
+    if(EXPORT_METRICS)
+    {
+#ifdef GRASPH_USE_MPI
+        // every rank writes its own files
+        const std::string rankSuffix = "." + mpu::toString(decomposition.rank());
+#else
+        const std::string rankSuffix;
+#endif
+        metricsExporter = std::make_unique<mpu::MetricsExporter>(metrics,
+                METRICS_PROMETHEUS_FILE.empty() ? "" : METRICS_PROMETHEUS_FILE + rankSuffix,
+                METRICS_JSON_FILE.empty() ? "" : METRICS_JSON_FILE + rankSuffix,
+                std::chrono::milliseconds(METRICS_EXPORT_INTERVAL));
+    }
+
     // timing
-    mpu::DeltaTimer timer;
+    mpu::FrameTimer timer(FRAME_STATS_WINDOW, FRAME_SPIKE_THRESHOLD);
     double dt;
     int nbframes =0;
     double elapsedPerT = 0;
+    double lastSimulationTime = DT;
+    uint64_t lastStep = 0;
 
-    double lag = 0;
-    double simulationTime = DT;
-
-    double newDT = DT;
-
-    bool runSim = false;
     bool readyToPrint=true;
     bool readyToChangeRef=true;
     bool printRefcubeSize=false;
-    while( window.update())
+
+    // the renderer draws copies of the positions, so it never has to wait for the simulation
+    DoubleBufferedSnapshot snapshot(PARTICLE_CAPACITY, ENABLE_SINKS ? sinks.getSinkBuffer().size() : 0);
+    snapshot.publish(pb, sinks.getSinkBuffer(), {pb.activeSize(), sinks.size(), DT, 0});
+
+    // the simulation runs in its own thread, using a hidden window whose context shares all objects with the main window
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    mpu::gph::Window simulationContext(1,1,"Simulation",nullptr,window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    window.makeContextCurrent();
+
+    std::atomic_bool runSim{RECORD_MOVIE && MOVIE_HEADLESS};
+    std::atomic_bool stopSimulation{false};
+    std::atomic_bool simulationStopped{false};
+
+    glFinish(); // all objects need to be created before they are used in the other context
+    std::thread simulationThread([&]()
     {
+        simulationContext.makeContextCurrent();
+        mpu::Profiler::setThreadName("Simulation");
+        // results are collected after every step, but the gpu might lag behind by up to a frame
+        mpu::gph::GpuProfiler simulationGpuProfiler("GPU simulation", GPU_ZONES_PER_STEP * (MAX_STEPS_PER_FRAME+1));
+        simulationGpuProfiler.makeCurrent();
+
+        // buffer bindings are part of the context state
+        pb.bindAll(PARTICLE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER);
+        compactor.bind();
+        if(ENABLE_SINKS)
+            sinks.bind();
+        if(ENABLE_RESOLUTION_CONTROL)
+            resolutionControl.bind();
+#ifdef GRASPH_USE_MPI
+        distributed.bind();
+        uint32_t stepsSinceBalance = 0;
+#endif
+
+        // gpu time queries are not shared between contexts, so the scheduler is created here
+        StepScheduler scheduler(SIMULATION_FRAME_BUDGET, MAX_STEPS_PER_FRAME);
+        scheduler.setStepTimeHistogram(&stepGpuTime);
+
+        // the timesteps are copied into a persistently mapped buffer, so no buffer is created or mapped per step
+        constexpr GLbitfield READBACK_FLAGS = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        mpu::gph::Buffer timestepReadback(PARTICLE_CAPACITY * sizeof(float), READBACK_FLAGS);
+        mpu::gph::BufferMap<float> timestepMap = timestepReadback.map<float>(PARTICLE_CAPACITY, 0, READBACK_FLAGS);
+
+        double simulationTime = DT;
+        uint64_t step = 0;
+        while(true)
+        {
+#ifdef GRASPH_USE_MPI
+            // rank 0 decides when to simulate, how many steps to run and when to stop
+            int state[3] = {stopSimulation, runSim, static_cast<int>(scheduler.stepsPerFrame())};
+            MPI_Bcast(state, 3, MPI_INT, 0, MPI_COMM_WORLD);
+            if(state[0])
+                break;
+            const bool simulateFrame = (state[1] != 0);
+            const unsigned int stepsThisFrame = static_cast<unsigned int>(state[2]);
+#else
+            if(stopSimulation)
+                break;
+            const bool simulateFrame = runSim;
+            const unsigned int stepsThisFrame = scheduler.stepsPerFrame();
+#endif
+            if(!simulateFrame)
+            {
+                mpu::sleep_ms(12);
+                continue;
+            }
+
+            // run as many steps as fit into the frame budget, then hand the result to the renderer
+            for(unsigned int i = 0; i < stepsThisFrame; i++)
+            {
+                PROFILE_SCOPE("step");
+                const auto stepStart = std::chrono::steady_clock::now();
+
+                // only particles that are alive decide on the timestep
+                float desiredMaxDT;
+                {
+                    PROFILE_GPU_SCOPE("timestep readback");
+
+                    // the readback waits for the gpu anyway, so this is where particles removed in the last step are counted
+                    compactor.synchronize();
+                    const uint32_t numParticles = pb.activeSize();
+                    pb.timestepBuffer.copyTo<float>(timestepReadback,numParticles);
+                    GLsync readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                    glClientWaitSync(readbackFence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+                    glDeleteSync(readbackFence);
+                    desiredMaxDT = (numParticles == 0) ? float(MAX_DT) : *std::min_element(timestepMap.begin(),timestepMap.begin()+numParticles);
+                }
+#ifdef GRASPH_USE_MPI
+                // all ranks use the same timestep
+                desiredMaxDT = static_cast<float>(decomposition.globalMin(desiredMaxDT));
+#endif
+
+                const double newDT = glm::clamp( desiredMaxDT, float(MIN_DT),float(MAX_DT));
+                integrator.uniform1f("next_dt",newDT);
+
+                scheduler.beginStep();
+                simulate(newDT);
+                scheduler.endStep();
+#ifdef GRASPH_USE_MPI
+                // redistribute particles based on the compute time each rank needed
+                if(++stepsSinceBalance >= LOAD_BALANCE_INTERVAL)
+                {
+                    PROFILE_GPU_SCOPE("balance");
+                    compactor.synchronize();
+                    distributed.balance();
+                    stepsSinceBalance = 0;
+                }
+#endif
+                simulationTime += DT;
+                step++;
+                if(newDT != DT)
+                {
+                    DT = newDT;
+                    integrator.uniform1f("dt",DT);
+                }
+
+                stepTime.recordDuration(std::chrono::steady_clock::now() - stepStart);
+                stepCounter.inc();
+                dtGauge.set(DT);
+                simulationGpuProfiler.collect();
+            }
+
+            {
+                PROFILE_GPU_SCOPE("publish");
+                compactor.synchronize();
+                snapshot.publish(pb, sinks.getSinkBuffer(), {pb.activeSize(), sinks.size(), simulationTime, step});
+            }
+            simulationGpuProfiler.collect();
+            particleGauge.set(pb.activeSize());
+            sinkGauge.set(sinks.size());
+            simulatedYears.set(static_cast<double>(timeUnitInYears(simulationTime)));
+        }
+
+        glFinish();
+        simulationStopped = true;
+    });
+
+    while( window.update() && !simulationStopped)
+    {
+        PROFILE_SCOPE("frame");
+        renderGpuProfiler.collect();
         dt = timer.getDeltaTime();
+        frameTime.recordDuration(std::chrono::duration<double>(dt));
         camera.update(dt);
 
+        if(recorder)
+            recorder->bind();
+
         if(window.getKey(GLFW_KEY_3) != GLFW_PRESS)
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -345,6 +742,19 @@ int main()
         else if(window.getKey(GLFW_KEY_2) == GLFW_PRESS)
             runSim = false;
 
+        // switch to the newest positions published by the simulation
+        const bool newSnapshot = snapshot.acquire();
+        if(newSnapshot)
+        {
+            renderer.setPositionBuffer(snapshot.positions());
+            renderer.setSmlengthBuffer(snapshot.smlength());
+            renderer.setNumberOfParticles(snapshot.info().numParticles);
+            renderer.updateLod(snapshot.info().step);
+            if(ENABLE_SINKS)
+                renderer.setSinkBuffer(snapshot.sinks());
+            renderer.setNumberOfSinks(snapshot.info().numSinks);
+        }
+
         if(window.getKey(GLFW_KEY_P) == GLFW_PRESS && readyToPrint)
         {
             readyToPrint=false;
@@ -354,7 +764,9 @@ int main()
             mm.uniform4f("lower",refcubeTransform*glm::vec4(-0.5f,-0.5f,-0.5f,1.0f));
             mm.uniform4f("upper",refcubeTransform*glm::vec4(0.5f,0.5f,0.5f,1.0f));
             glMemoryBarrier(GL_ALL_BARRIER_BITS);
-            mm.dispatch(NUM_PARTICLES,GENERAL_WGSIZE);
+            snapshot.positions().bindBase(PARTICLE_POSITION_BUFFER_BINDING,GL_SHADER_STORAGE_BUFFER);
+            mm.uniform1ui("num_of_particles",snapshot.info().numParticles);
+            mm.dispatch(snapshot.info().numParticles,GENERAL_WGSIZE);
             glFinish();
             glMemoryBarrier(GL_ALL_BARRIER_BITS);
             auto a = mmb.read<float>(1);
@@ -363,59 +775,89 @@ int main()
         else if(window.getKey(GLFW_KEY_P) == GLFW_RELEASE)
             readyToPrint=true;
 
-        mpu::gph::Buffer temp;
-        temp.allocate<float>(pb.size(),GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT);
-        pb.timestepBuffer.copyTo(temp);
-        std::vector<float> dtdata = temp.read<float>( pb.size(),0);
-        float desiredMaxDT = *std::min(dtdata.begin(),dtdata.end());
+        {
+            PROFILE_GPU_SCOPE("render");
 
-        newDT = glm::clamp( desiredMaxDT, float(MIN_DT),float(MAX_DT));
-        integrator.uniform1f("next_dt",newDT);
+            // render the particles
+            renderer.draw();
 
-        if(runSim)
+            // render the reference cube
+            refCube.bind();
+            cubeRefShader.use();
+            cubeRefShader.uniformMat4("model_view_projection", renderer.getViewProjection() * glm::scale(glm::translate(glm::mat4(1),refCubePos),glm::vec3(referenceCubeSize)));
+            glDrawArrays(GL_LINES, 0, cube.size());
+        }
+
+        // store the frame and show a preview
+        if(recorder)
         {
-            simulate();
-            lag += DT;
-            simulationTime += DT;
-            if(newDT != DT)
+            if(newSnapshot && runSim)
+                recorder->capture();
+            const glm::uvec2 windowSize(window.getSize());
+            recorder->unbind(windowSize);
+            if(!MOVIE_HEADLESS)
             {
-                DT = newDT;
-                integrator.uniform1f("dt",DT);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                recorder->blitToScreen(windowSize);
             }
-        } else
-        {
-            mpu::sleep_ms(12);
         }
 
-        // render the particles
-        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
-        renderer.draw();
-
-        // render the reference cube
-        refCube.bind();
-        cubeRefShader.use();
-        cubeRefShader.uniformMat4("model_view_projection", renderer.getViewProjection() * glm::scale(glm::translate(glm::mat4(1),refCubePos),glm::vec3(referenceCubeSize)));
-        glDrawArrays(GL_LINES, 0, cube.size());
+        // the simulation may overwrite the snapshot once drawing is done
+        snapshot.release();
 
         // performance display
         nbframes++;
         elapsedPerT += dt;
         if(elapsedPerT >= PERFORMANCE_DISPLAY_INT)
         {
+            const DoubleBufferedSnapshot::Info& info = snapshot.info();
+            const double lag = info.simulationTime - lastSimulationTime;
+            const uint64_t steps = info.step - lastStep;
+            const mpu::FrameStats frameStats = timer.stats();
+            yearsPerSecond.set(static_cast<double>(timeUnitInYears(lag)/elapsedPerT));
             std::cout << 1000.0*elapsedPerT/double(nbframes) << " ms/frame -- "
+                      << 1000.0*frameStats.p50 << " / " << 1000.0*frameStats.p95 << " / " << 1000.0*frameStats.p99 << " / "
+                      << 1000.0*frameStats.max << " ms p50/p95/p99/max of the last " << frameStats.frames << " frames -- "
                       << nbframes/elapsedPerT << " fps -- "
-                      << timeUnitInYears(simulationTime) << " simulated years -- "
+                      << steps/elapsedPerT << " steps/second -- "
+                      << timeUnitInYears(info.simulationTime) << " simulated years -- "
                       << timeUnitInYears(lag)/elapsedPerT << " years/second -- "
-                      << timeUnitInYears(lag)/nbframes << " years/frame -- "
-                      << simulationTime << " internal time -- "
+                      << info.simulationTime << " internal time -- "
                       << lag/elapsedPerT << " speed -- "
-                      << lag/nbframes << " average dt"
+                      << ((steps > 0) ? lag/steps : 0.0) << " average dt -- "
+                      << info.numParticles << " particles on this rank -- "
+                      << info.numSinks << " sinks"
                       << std::endl;
             nbframes = 0;
             elapsedPerT = 0;
-            lag = 0;
+            lastSimulationTime = info.simulationTime;
+            lastStep = info.step;
+
+            for(const auto& spike : timer.takeSpikes())
+            {
+                if(ENABLE_PROFILING)
+                    logWARNING("Frame") << "Frame " << spike.frame << " took " << 1000.0*spike.duration << " ms, profiling zones:\n" << spike.zones;
+                else
+                    logWARNING("Frame") << "Frame " << spike.frame << " took " << 1000.0*spike.duration << " ms";
+            }
         }
+
+        if(recorder && MOVIE_FRAMES > 0 && recorder->framesCaptured() >= MOVIE_FRAMES)
+            break;
+    }
+
+    stopSimulation = true;
+    simulationThread.join();
+    if(recorder)
+        recorder->finish();
+
+    if(ENABLE_PROFILING)
+    {
+        renderGpuProfiler.collect();
+        logINFO("Profiler") << "Time spent in profiling zones:\n" << mpu::Profiler::report();
+        if(!PROFILE_TRACE_FILE.empty() && mpu::Profiler::writeChromeTrace(PROFILE_TRACE_FILE))
+            logINFO("Profiler") << "Trace written to " << PROFILE_TRACE_FILE << ", open it in chrome://tracing or ui.perfetto.dev";
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "common.glsl"
+
+// all attributes of a particle that are send to other ranks, same layout as ParticleRecord in DomainDecomposition.h
+struct ParticleRecord
+{
+    vec4 position; // w is the mass
+    vec4 velocity; // w is the speed of sound
+    vec4 hydro;
+    float smlength;
+    float timestep;
+    float padding[2];
+};
+
+layout(binding=PARTICLE_POSITION_BUFFER_BINDING,std430) buffer ParticlePositions
+{
+    vec4 positions[];
+};
+
+layout(binding=PARTICLE_VELOCITY_BUFFER_BINDING,std430) buffer ParticleVelocities
+{
+    vec4 velocities[];
+};
+
+layout(binding=PARTICLE_HYDRO_BUFFER_BINDING,std430) buffer ParticleHydro
+{
+    vec4 hydro[];
+};
+
+layout(binding=PARTICLE_SMLENGTH_BUFFER_BINDING,std430) buffer ParticleSmlength
+{
+    float smlength[];
+};
+
+layout(binding=PARTICLE_TIMESTEP_BUFFER_BINDING,std430) buffer ParticleTimestep
+{
+    float timestep[];
+};
+
+layout(binding=PARTICLE_RECORD_BUFFER_BINDING,std430) buffer ParticleRecords
+{
+    ParticleRecord records[];
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "common.glsl"
+
+// counters used to remove and add particles, see ParticleCompactor.h
+// other shaders only declare the first two counters
+layout(binding=PARTICLE_CONTROL_BUFFER_BINDING,std430) buffer ParticleControl
+{
+    uint removed_particles; // number of particles that where removed by setting their mass to zero
+    uint added_particles; // number of particles that where appended behind the alive particles
+    uint num_holes; // number of removed particles in front of the new end of the buffer
+    uint num_movers; // number of alive particles behind the new end of the buffer
+    uint old_num_of_particles; // number of particles alive before removing particles, including the added ones
+    uint new_num_of_particles; // number of particles alive after removing particles
+    uint find_groups_x; // indirect dispatch arguments for findHoles.comp
+    uint find_groups_y;
+    uint find_groups_z;
+    uint move_groups_x; // indirect dispatch arguments for moveParticles.comp
+    uint move_groups_y;
+    uint move_groups_z;
+    uint lists[]; // NUM_PARTICLES indices of holes followed by NUM_PARTICLES indices of movers
+};
@@ -0,0 +1,103 @@
+// shared definitions of the level of detail pyramid
+// level l has 2^l cells per dimension, all levels are stored one after another starting with level 0
+// every cell uses two vec4: (sum of mass*position, sum of mass) and (number of particles, unused)
+
+layout(binding=LOD_CELL_BUFFER_BINDING,std430) buffer LodCells
+{
+    vec4 cells[];
+};
+
+layout(binding=LOD_BOUNDS_BUFFER_BINDING,std430) buffer LodBounds
+{
+    uvec4 boundsMin; // stored as ordered uint, so atomics can be used
+    uvec4 boundsMax;
+};
+
+uint levelOffset(uint level)
+{
+    return ((1u << (3u*level)) - 1u) / 7u;
+}
+
+uint cellIndex(uint level, uvec3 cell)
+{
+    const uint res = 1u << level;
+    return levelOffset(level) + (cell.z * res + cell.y) * res + cell.x;
+}
+
+uvec3 cellCoord(uint level, uint localIndex)
+{
+    const uint res = 1u << level;
+    return uvec3(localIndex % res, (localIndex / res) % res, localIndex / (res*res));
+}
+
+// floats can be compared as uints after flipping the sign bit (positive) or all bits (negative)
+uint floatToOrderedUint(float f)
+{
+    const uint u = floatBitsToUint(f);
+    return ((u & 0x80000000u) != 0u) ? ~u : (u | 0x80000000u);
+}
+
+float orderedUintToFloat(uint u)
+{
+    return uintBitsToFloat(((u & 0x80000000u) != 0u) ? (u & 0x7FFFFFFFu) : ~u);
+}
+
+vec3 lowerBound()
+{
+    return vec3(orderedUintToFloat(boundsMin.x), orderedUintToFloat(boundsMin.y), orderedUintToFloat(boundsMin.z));
+}
+
+// the pyramid is a cube, so all cells are cubes as well
+float boundsSize()
+{
+    const vec3 upper = vec3(orderedUintToFloat(boundsMax.x), orderedUintToFloat(boundsMax.y), orderedUintToFloat(boundsMax.z));
+    const vec3 extent = upper - lowerBound();
+    return max(max(extent.x, extent.y), max(extent.z, 1e-6));
+}
+
+uvec3 finestCell(vec3 position, uint finestLevel)
+{
+    const float res = float(1u << finestLevel);
+    const vec3 rel = (position - lowerBound()) / boundsSize();
+    return uvec3(clamp(ivec3(rel * res), ivec3(0), ivec3(res-1)));
+}
+
+// level of detail selection
+//--------------------
+// cells that appear smaller than max_pixel_size on screen are drawn as one sprite, a cell is drawn if it is accepted
+// and none of its ancestors is, particles are drawn individually if none of the cells containing them is accepted
+
+layout(binding=LOD_COMMAND_BUFFER_BINDING,std430) buffer LodCommands
+{
+    uint nodeCommand[4]; // DrawArraysIndirectCommand for the aggregated nodes
+    uint particleCommand[5]; // DrawElementsIndirectCommand for the remaining particles
+};
+
+uniform mat4 model_view_projection;
+uniform vec4 frustum_planes[6]; // normalized planes in model space, normals point inwards
+uniform float pixel_scale; // viewport_size.y * projection[1][1] / 2, converts size/w into a radius in pixel
+uniform float max_pixel_size;
+
+bool isAccepted(uint level, uvec3 cell)
+{
+    const uint idx = cellIndex(level, cell);
+    const vec4 sum = cells[2*idx];
+    if(sum.w <= 0)
+        return false;
+
+    const vec3 com = sum.xyz / sum.w;
+    const float w = dot(vec4(model_view_projection[0][3],model_view_projection[1][3],model_view_projection[2][3],model_view_projection[3][3]), vec4(com,1));
+    if(w <= 0)
+        return false;
+
+    const float cellSize = boundsSize() / float(1u << level);
+    return pixel_scale * cellSize / w <= max_pixel_size;
+}
+
+bool inFrustum(vec3 position, float radius)
+{
+    for(int i=0; i<6; i++)
+        if(dot(frustum_planes[i], vec4(position,1)) < -radius)
+            return false;
+    return true;
+}
@@ -0,0 +1,13 @@
+#version 450
+
+in float coverage;
+
+uniform vec4 color;
+uniform float brightness;
+
+out vec4 fragment_color;
+
+void main()
+{
+	fragment_color = color * brightness * coverage;
+}
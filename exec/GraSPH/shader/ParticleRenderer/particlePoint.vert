@@ -0,0 +1,23 @@
+#version 450
+
+#include "common.glsl"
+
+layout(location=RENDERER_POSITION_ARRAY) in vec4 input_position;
+
+uniform mat4 model_view_projection;
+uniform mat4 projection;
+uniform vec2 viewport_size;
+uniform float render_size;
+
+out float coverage;
+
+// draws particles whose sprite would be smaller than a pixel as single pixel points
+void main()
+{
+	gl_Position = model_view_projection * input_position;
+	gl_PointSize = 1;
+
+	// fraction of the pixel the sprite would have covered, keeps the total brightness when blending additive
+	const float pixelRadius = 0.5 * viewport_size.y * projection[1][1] * render_size / gl_Position.w;
+	coverage = min(3.14159265 * pixelRadius * pixelRadius, 1.0);
+}
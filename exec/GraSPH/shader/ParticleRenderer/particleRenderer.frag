@@ -5,9 +5,11 @@ in float radius;
 
 uniform vec4 color;
 uniform float brightness;
+uniform vec4 sink_color;
 
 out vec4 fragment_color;
 flat in int isSink;
+flat in float weight;
 
 void main()
 {
@@ -20,13 +22,13 @@ void main()
         discard;
 #endif
 
-//    if(isSink>0)
-//    {
-//        fragment_color = vec4(0,0,50,1);
-//        return;
-//    }
+    if(isSink>0)
+    {
+        fragment_color = sink_color;
+        return;
+    }
 
     vec4 falloffColor;
     PARTICLE_FALLOFF(); // this is defined via preprocessor macros when compiling
-	fragment_color = falloffColor*brightness;
+	fragment_color = falloffColor*brightness*weight;
 }
\ No newline at end of file
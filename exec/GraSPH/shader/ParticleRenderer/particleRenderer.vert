@@ -4,30 +4,36 @@
 
 layout(location=RENDERER_POSITION_ARRAY) in vec4 input_position;
 layout(location=RENDERER_MASS_ARRAY) in float mass;
+#ifdef PARTICLES_LOD
+layout(location=RENDERER_SMLENGTH_ARRAY) in float node_radius; // when drawing LOD nodes mass is the number of particles in the node
+#endif
 
 uniform mat4 model_view_projection;
 uniform mat4 projection;
 uniform vec2 viewport_size;
 uniform float render_size;
-uniform float mass_thres;
+uniform float sink_size;
+uniform int render_sinks; // set to 1 when drawing sink particles
 
 out vec2 center;
 out float radius;
 flat out int isSink;
+flat out float weight;
 
 void main()
 {
 	gl_Position = model_view_projection * input_position;
 
-    float size;
-//    if(mass > mass_thres)
-//    {
-//         size = render_size* 4;
-//        isSink =1;
-//    } else {
-//    isSink =0;
-    size = render_size;
-//    }
+    float size = (render_sinks > 0) ? sink_size : render_size;
+    isSink = render_sinks;
+    weight = 1.0;
+
+#ifdef PARTICLES_LOD
+    // spread the light of all particles in the node over the bigger sprite
+    const float nodeSize = max(size, node_radius);
+    weight = mass * (size*size) / (nodeSize*nodeSize);
+    size = nodeSize;
+#endif
 
 #ifdef PARTICLES_PERSPECTIVE
 	gl_PointSize = viewport_size.y * projection[1][1] * size / gl_Position.w;
@@ -0,0 +1,20 @@
+#version 450
+
+#include "mathConst.glsl"
+
+in vec2 center;
+in float radius;
+in float columnFactor;
+
+out float column_density;
+
+// the line of sight integral of the 3D spline kernel is approximated by the normalized 2D spline kernel
+void main()
+{
+    const float q = length(gl_FragCoord.xy - center) / radius;
+    if(q > 1.0)
+        discard;
+
+    const float w = (q <= 0.5) ? 1.0 - 6.0*q*q + 6.0*q*q*q : 2.0*pow(1.0-q,3);
+    column_density = columnFactor * 40.0/(7.0*PI) * w;
+}
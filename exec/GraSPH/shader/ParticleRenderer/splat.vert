@@ -0,0 +1,29 @@
+#version 450
+
+#include "common.glsl"
+
+layout(location=RENDERER_POSITION_ARRAY) in vec4 input_position;
+layout(location=RENDERER_MASS_ARRAY) in float mass;
+layout(location=RENDERER_SMLENGTH_ARRAY) in float smlength;
+
+uniform mat4 model_view_projection;
+uniform mat4 projection;
+uniform vec2 target_size; // size of the accumulation target in pixel
+
+out vec2 center;
+out float radius;
+out float columnFactor;
+
+void main()
+{
+	gl_Position = model_view_projection * input_position;
+
+    // particles smaller than a pixel are enlarged to one pixel, so their mass is not lost
+    const float pixelRadius = gl_Position.w / (target_size.y * projection[1][1]);
+    const float h = max(smlength, pixelRadius);
+
+	gl_PointSize = target_size.y * projection[1][1] * h / gl_Position.w;
+	center = (0.5 * gl_Position.xy/gl_Position.w +0.5) * target_size;
+	radius = gl_PointSize / 2;
+	columnFactor = mass / (h*h);
+}
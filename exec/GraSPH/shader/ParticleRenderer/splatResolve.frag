@@ -0,0 +1,16 @@
+#version 450
+
+in vec2 texCoord;
+
+uniform sampler2D column_density;
+uniform vec4 color;
+uniform float brightness;
+
+out vec4 fragment_color;
+
+// tone maps the column density, linear filtering of the sampler upsamples the low resolution target
+void main()
+{
+    const float sigma = texture(column_density, texCoord).r;
+    fragment_color = color * (1.0 - exp(-brightness * sigma));
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common.glsl"
+
+// a sink particle only interacts with the gas via gravity and accretion
+struct Sink
+{
+    vec4 position; // w is the mass
+    vec4 velocity; // w is the accretion radius
+    vec4 acceleration; // w is unused
+};
+
+layout(binding=SINK_BUFFER_BINDING,std430) buffer SinkParticles
+{
+    uint num_sinks; // might be bigger then MAX_SINKS when there was an overflow, use numberOfSinks()
+    uint sink_groups_x; // indirect dispatch arguments with one work group per sink, written by applyAccretion.comp
+    uint sink_groups_y;
+    uint sink_groups_z;
+    Sink sinks[];
+};
+
+// the number of sinks that are actually stored in the buffer
+uint numberOfSinks()
+{
+    return min(num_sinks, MAX_SINKS);
+}
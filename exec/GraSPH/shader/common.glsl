@@ -13,6 +13,7 @@
 
 // buffer bindings
 #define RENDERER_POSITION_BUFFER_BINDING 0
+#define RENDERER_SMLENGTH_BUFFER_BINDING 1
 
 #define PARTICLE_BUFFER_BINDING 2
 #define PARTICLE_POSITION_BUFFER_BINDING 2
@@ -24,9 +25,34 @@
 #define PARTICLE_BALSARA_BUFFER_BINDING 8
 #define MM_BUFFER_BINDING 9
 
+#define PARTICLE_CONTROL_BUFFER_BINDING 10
+#define SINK_BUFFER_BINDING 11
+#define SINK_ACCRETION_BUFFER_BINDING 12
+#define MERGE_PARTNER_BUFFER_BINDING 13
+#define PSEUDO_PARTICLE_BUFFER_BINDING 14
+#define GLASS_POSITION_BUFFER_BINDING 15
+#define GLASS_VELOCITY_BUFFER_BINDING 16
+#define GLASS_DENSITY_BUFFER_BINDING 17
+#define IC_STAGING_BUFFER_BINDING 18
+#define TURBULENCE_GRID_BUFFER_BINDING 19
+#define SPAWN_TABLE_BUFFER_BINDING 20
+#define CULL_INDEX_BUFFER_BINDING 21
+#define CULL_COMMAND_BUFFER_BINDING 22
+#define LOD_CELL_BUFFER_BINDING 23
+#define LOD_BOUNDS_BUFFER_BINDING 24
+#define LOD_NODE_BUFFER_BINDING 25
+#define LOD_NODE_RADIUS_BUFFER_BINDING 26
+#define LOD_COMMAND_BUFFER_BINDING 27
+#define LOD_INDEX_BUFFER_BINDING 28
+#define SINK_CANDIDATE_BUFFER_BINDING 29
+#define CENTER_OF_MASS_BUFFER_BINDING 30
+#define PARTICLE_RECORD_BUFFER_BINDING 31
+#define PARTICLE_INDEX_BUFFER_BINDING 32
+
 // arrays for rendering data
 #define RENDERER_POSITION_ARRAY 0
 #define RENDERER_MASS_ARRAY 1
+#define RENDERER_SMLENGTH_ARRAY 2
 
 // defines for buffer access
 
@@ -52,3 +78,9 @@
 #define CURL xyz
 #define DIV w
 
+// sink buffer
+#define ACCRETION_RADIUS w
+
+// merge partner buffer
+#define NO_PARTNER 0xFFFFFFFFu
+
@@ -0,0 +1,79 @@
+/*
+ * mpUtils
+ * main.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Microbenchmark for the throughput of the Log class
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include <Log/Log.h>
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+//--------------------
+
+// a sink that only counts messages, so only the cost of the log itself is measured
+struct CountingSink
+{
+    explicit CountingSink(std::atomic<uint64_t>* counter) : counter(counter) {}
+    void operator()(const mpu::LogMessage&) {(*counter)++;}
+    std::atomic<uint64_t>* counter;
+};
+
+void runBenchmark(int numThreads, int messagesPerThread, mpu::LogOverflowPolicy policy, const std::string& policyName)
+{
+    std::atomic<uint64_t> printed{0};
+    uint64_t dropped;
+    double logTime;
+    double totalTime;
+    {
+        mpu::Log log(mpu::LogLvl::ALL, CountingSink(&printed));
+        log.setOverflowPolicy(policy);
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for(int t = 0; t < numThreads; t++)
+            threads.emplace_back([&log, messagesPerThread]()
+            {
+                for(int i = 0; i < messagesPerThread; i++)
+                    log(mpu::LogLvl::INFO, MPU_FILEPOS, "Benchmark") << "message number " << i;
+            });
+        for(auto& thread : threads)
+            thread.join();
+        logTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        log.close(); // wait until everything is printed
+        totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        dropped = log.getDroppedMessages();
+    }
+
+    const double numMessages = double(numThreads) * messagesPerThread;
+    std::cout << policyName << "\t" << numThreads << " threads\t"
+              << numMessages / logTime / 1e6 << " M msg/s logged\t"
+              << (printed) / totalTime / 1e6 << " M msg/s printed\t"
+              << dropped << " dropped" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    const int messagesPerThread = (argc > 1) ? std::stoi(argv[1]) : 200000;
+    const int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "Log throughput, queue capacity " << MPU_LOG_QUEUE_CAPACITY << ", " << messagesPerThread << " messages per thread" << std::endl;
+    for(int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        runBenchmark(threads, messagesPerThread, mpu::LogOverflowPolicy::BLOCK, "BLOCK      ");
+        runBenchmark(threads, messagesPerThread, mpu::LogOverflowPolicy::DROP_OLDEST, "DROP_OLDEST");
+        runBenchmark(threads, messagesPerThread, mpu::LogOverflowPolicy::DROP_NEWEST, "DROP_NEWEST");
+    }
+    return 0;
+}
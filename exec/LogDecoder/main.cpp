@@ -0,0 +1,121 @@
+/*
+ * mpUtils
+ * main.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Renders log files written by the BinarySink to text
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include <Log/Log.h>
+#include <Log/BinarySink.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <unordered_map>
+#include <vector>
+//--------------------
+
+// prints one message in the same format the FileSink uses, but with nanosecond resolution
+void printMessage(std::ostream& os, const mpu::BinaryLogRecord& record, const char* payload,
+                  const std::unordered_map<uint32_t,std::string>& strings)
+{
+    const std::chrono::nanoseconds timestamp(record.timestamp);
+    const time_t timepoint = std::chrono::duration_cast<std::chrono::seconds>(timestamp).count();
+    const long fraction = static_cast<long>((timestamp - std::chrono::seconds(timepoint)).count());
+
+    struct tm timeStruct;
+    localtime_r(&timepoint, &timeStruct);
+
+    os << "[" << mpu::toString(static_cast<mpu::LogLvl>(record.level)) << "]"
+       << " [" << std::put_time( &timeStruct, "%c") << " +" << std::setw(9) << std::setfill('0') << fraction << "ns]"
+       << std::setfill(' ');
+
+    auto module = strings.find(record.moduleId);
+    if(module != strings.end())
+        os << " (" << module->second << "):";
+
+    os << "\t";
+    os.write(payload, record.payloadSize);
+    os << "\tThread: " << std::setbase(16) << record.threadId << std::setbase(10);
+
+    auto position = strings.find(record.positionId);
+    if(position != strings.end())
+        os << "\t@File: " << position->second;
+
+    os << "\n";
+}
+
+// decodes one file, returns false if the file is not a valid binary log
+bool decodeFile(const std::string& filename, std::ostream& os)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if(!file.is_open())
+    {
+        std::cerr << "Could not open " << filename << std::endl;
+        return false;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    mpu::BinaryLogFileHeader header;
+    if(data.size() < sizeof(header))
+    {
+        std::cerr << filename << " is not a binary log file" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if(std::memcmp(header.magic, mpu::binaryLogMagic, sizeof(header.magic)) != 0 || header.version != mpu::binaryLogVersion)
+    {
+        std::cerr << filename << " is not a binary log file or has an unsupported version" << std::endl;
+        return false;
+    }
+
+    std::unordered_map<uint32_t,std::string> strings;
+    std::size_t offset = (sizeof(header) + 7) & ~std::size_t(7);
+    while(offset + sizeof(mpu::BinaryLogRecord) <= data.size())
+    {
+        mpu::BinaryLogRecord record;
+        std::memcpy(&record, data.data() + offset, sizeof(record));
+        if(record.size == 0)
+            break;
+        if(record.size < sizeof(record) || offset + record.size > data.size()
+           || sizeof(record) + record.payloadSize > record.size)
+        {
+            std::cerr << filename << " is corrupted at offset " << offset << std::endl;
+            return false;
+        }
+
+        const char* payload = data.data() + offset + sizeof(record);
+        if(record.type == mpu::BinaryLogRecordType::STRING)
+            strings[record.moduleId].assign(payload, record.payloadSize);
+        else if(record.type == mpu::BinaryLogRecordType::MESSAGE)
+            printMessage(os, record, payload, strings);
+
+        offset += record.size;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <binary log file> [more files ...]\n"
+                  << "Renders log files written by mpu::BinarySink to text on the standard output.\n"
+                  << "Pass rotated files oldest first to get a continuous log." << std::endl;
+        return 1;
+    }
+
+    bool success = true;
+    for(int i = 1; i < argc; i++)
+        success = decodeFile(argv[i], std::cout) && success;
+
+    return success ? 0 : 1;
+}
@@ -71,9 +71,13 @@ GLuint offset_of(TMember T::* field) noexcept
 #include "Window.h"
 #include "Utils/Transform.h"
 #include "Utils/ModelViewProjection.h"
+#include "Utils/GpuProfiler.h"
 #include "Opengl/Buffer.h"
 #include "Opengl/VertexArray.h"
 #include "Opengl/Shader.h"
+#include "Opengl/Query.h"
+#include "Opengl/Texture.h"
+#include "Opengl/Framebuffer.h"
 #include "Rendering/Camera.h"
 #include "Rendering/screenFillingTri.h"
 //--------------------
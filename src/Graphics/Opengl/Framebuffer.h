@@ -0,0 +1,58 @@
+/*
+ * mpUtils
+ * Framebuffer.h
+ *
+ * Contains the Framebuffer class to manage an openGL framebuffer object
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+#pragma once
+
+#include <cinttypes>
+#include <GL/glew.h>
+#include "Handle.h"
+#include "Texture.h"
+#include "Log/Log.h"
+
+namespace mpu {
+namespace gph {
+
+/**
+ * class Framebuffer
+ *
+ * Class to manage an openGL framebuffer object. Copying a Framebuffer results in two references to the same object.
+ *
+ * usage:
+ * Attach textures using attach(), then call isComplete() to check if the framebuffer can be used.
+ * Use bind() to render into it and unbind() to switch back to the default framebuffer.
+ * Unlike buffers and textures, framebuffer objects are not shared between openGL contexts.
+ *
+ */
+class Framebuffer : public Handle<uint32_t, decltype(&glCreateFramebuffers), &glCreateFramebuffers, decltype(&glDeleteFramebuffers), &glDeleteFramebuffers>
+{
+public:
+    Framebuffer() = default; //!< creates a new framebuffer object
+    explicit Framebuffer(nullptr_t) : Handle(nullptr) {} //!< creates no framebuffer
+
+    void attach(GLenum attachment, const Texture& texture, int level = 0) const {glNamedFramebufferTexture(*this, attachment, texture, level);} //!< attach a texture, eg at GL_COLOR_ATTACHMENT0
+
+    bool isComplete() const //!< check if the framebuffer can be rendered to, logs an error if not
+    {
+        const GLenum status = glCheckNamedFramebufferStatus(*this, GL_FRAMEBUFFER);
+        if(status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            logERROR("Framebuffer") << "Framebuffer is not complete, status: " << status;
+            return false;
+        }
+        return true;
+    }
+
+    void bind(GLenum target = GL_FRAMEBUFFER) const {glBindFramebuffer(target, *this);} //!< bind the framebuffer to "target"
+    static void unbind(GLenum target = GL_FRAMEBUFFER) {glBindFramebuffer(target, 0);} //!< bind the default framebuffer
+};
+
+}}
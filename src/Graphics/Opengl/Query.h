@@ -0,0 +1,67 @@
+/*
+ * mpUtils
+ * Query.h
+ *
+ * Contains the Query class to manage an openGL query object
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+#pragma once
+
+#include <cinttypes>
+#include <GL/glew.h>
+#include "Handle.h"
+
+namespace mpu {
+namespace gph {
+
+/**
+ * class Query
+ *
+ * Class to manage an openGL query object. Copying a Query results in two references to the same query object.
+ *
+ * usage:
+ * Create the query with the target it will be used with, eg GL_TIME_ELAPSED, GL_TIMESTAMP or GL_SAMPLES_PASSED.
+ * Use begin() and end() around the commands you want to measure, or timestamp() for GL_TIMESTAMP queries.
+ * Results are available some time later, when the gpu executed the commands. Use isResultAvailable() to check
+ * without stalling, result() will wait for the result.
+ *
+ */
+class Query : public Handle<uint32_t, decltype(&glCreateQueries), &glCreateQueries, decltype(&glDeleteQueries), &glDeleteQueries, GLenum>
+{
+public:
+    explicit Query(GLenum target) : Handle(target), m_target(target) {} //!< creates a query for "target"
+    explicit Query(nullptr_t) : Handle(nullptr) {} //!< creates no query
+
+    void begin() const {glBeginQuery(m_target, *this);} //!< start the query
+    void end() const {glEndQuery(m_target);} //!< end the query
+    void timestamp() const {glQueryCounter(*this, GL_TIMESTAMP);} //!< record the gpu time once all previous commands are executed (target needs to be GL_TIMESTAMP)
+
+    bool isResultAvailable() const; //!< returns true if the result can be read without waiting
+    uint64_t result() const; //!< returns the result, waits until it is available (time is in nanoseconds)
+
+    GLenum target() const {return m_target;} //!< returns the target of this query
+
+private:
+    GLenum m_target{0};
+};
+
+inline bool Query::isResultAvailable() const
+{
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(*this, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available == GL_TRUE;
+}
+
+inline uint64_t Query::result() const
+{
+    GLuint64 result = 0;
+    glGetQueryObjectui64v(*this, GL_QUERY_RESULT, &result);
+    return result;
+}
+
+}}
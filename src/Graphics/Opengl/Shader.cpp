@@ -146,6 +146,12 @@ namespace gph {
 		glDispatchCompute(groups.x,groups.y,groups.z);
 	}
 
+	void ShaderProgram::dispatchIndirect(GLintptr offset) const
+	{
+		use();
+		glDispatchComputeIndirect(offset);
+	}
+
 	void ShaderProgram::uniform1i(const std::string_view uniform, const int32_t value) const
 	{
 		glProgramUniform1i(*this, uniformLocation(uniform), value);
@@ -112,6 +112,7 @@ namespace gph {
         void dispatch(uint32_t groups) const; //!< start a 1D compute shader run using a fixed group size
         void dispatch(glm::u32vec2 groups) const; //!< start a 2D compute shader run using a fixed group size
         void dispatch(glm::uvec3 groups) const; //!< start a 3D compute shader run using a fixed group size
+        void dispatchIndirect(GLintptr offset = 0) const; //!< start a compute shader run using a fixed group size, the number of groups is read from the buffer bound to GL_DISPATCH_INDIRECT_BUFFER at offset (in bytes)
 
         // uniform upload functions --------------------------------------------
 
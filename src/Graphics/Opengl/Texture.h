@@ -0,0 +1,80 @@
+/*
+ * mpUtils
+ * Texture.h
+ *
+ * Contains the Texture class to manage an openGL texture object
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+#pragma once
+
+#include <cinttypes>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Handle.h"
+
+namespace mpu {
+namespace gph {
+
+/**
+ * class Texture
+ *
+ * Class to manage an openGL texture object. Copying a Texture results in two references to the same texture object.
+ *
+ * usage:
+ * Create the texture with the target it will be used with, eg GL_TEXTURE_2D. Use allocate2D() to create immutable storage.
+ * Set filtering and wrapping with setFilter() and setWrap(). Bind it to a texture unit with bind() to use it as a sampler,
+ * or attach it to a Framebuffer to render into it. read() copies the content of a mip level back to the cpu.
+ * Allocating again is not possible (immutable storage), call recreate(target) first.
+ *
+ */
+class Texture : public Handle<uint32_t, decltype(&glCreateTextures), &glCreateTextures, decltype(&glDeleteTextures), &glDeleteTextures, GLenum>
+{
+public:
+    explicit Texture(GLenum target) : Handle(target), m_target(target) {} //!< creates a texture for "target"
+    explicit Texture(nullptr_t) : Handle(nullptr) {} //!< creates no texture
+
+    void allocate2D(GLenum internalFormat, glm::uvec2 size, int levels = 1) //!< create immutable storage for a 2D texture
+    {
+        glTextureStorage2D(*this, levels, internalFormat, size.x, size.y);
+        m_size = size;
+    }
+
+    void setFilter(GLenum minFilter, GLenum magFilter) const //!< set the minification and magnification filter
+    {
+        glTextureParameteri(*this, GL_TEXTURE_MIN_FILTER, minFilter);
+        glTextureParameteri(*this, GL_TEXTURE_MAG_FILTER, magFilter);
+    }
+
+    void setWrap(GLenum wrap) const //!< set the wrapping mode for all directions
+    {
+        glTextureParameteri(*this, GL_TEXTURE_WRAP_S, wrap);
+        glTextureParameteri(*this, GL_TEXTURE_WRAP_T, wrap);
+        glTextureParameteri(*this, GL_TEXTURE_WRAP_R, wrap);
+    }
+
+    void bind(GLuint unit) const {glBindTextureUnit(unit, *this);} //!< bind to texture unit "unit"
+    void clear(int level = 0) const {glClearTexImage(*this, level, GL_RED, GL_FLOAT, nullptr);} //!< set all texels to zero
+
+    template <typename T>
+    std::vector<T> read(GLenum format, GLenum type, int components = 1, int level = 0) const //!< read a mip level back to the cpu, T is the type of one component
+    {
+        std::vector<T> data(size_t(m_size.x) * m_size.y * components);
+        glGetTextureImage(*this, level, format, type, static_cast<GLsizei>(data.size()*sizeof(T)), data.data());
+        return data;
+    }
+
+    GLenum target() const {return m_target;} //!< returns the target of this texture
+    glm::uvec2 size() const {return m_size;} //!< returns the size of the base level set in allocate2D
+
+private:
+    GLenum m_target{0};
+    glm::uvec2 m_size{0,0};
+};
+
+}}
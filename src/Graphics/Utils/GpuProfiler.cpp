@@ -0,0 +1,103 @@
+/*
+ * mpUtils
+ * GpuProfiler.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the GpuProfiler class, which adds the gpu time of profiling zones to the timeline of the Profiler
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "GpuProfiler.h"
+#include "Log/Log.h"
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+namespace gph {
+//--------------------
+
+namespace {
+    thread_local GpuProfiler* t_currentProfiler = nullptr;
+}
+
+// function definitions of the GpuProfiler class
+//-------------------------------------------------------------------
+GpuProfiler::GpuProfiler(std::string trackName, std::size_t maxZonesInFlight)
+    : m_zones(std::max<std::size_t>(maxZonesInFlight,1)), m_track(Profiler::createTrack(std::move(trackName)))
+{
+}
+
+void GpuProfiler::makeCurrent()
+{
+    t_currentProfiler = this;
+}
+
+GpuProfiler* GpuProfiler::current()
+{
+    return t_currentProfiler;
+}
+
+int GpuProfiler::beginZone(const char* name)
+{
+    if(m_inFlight == m_zones.size())
+    {
+        if(!m_warnedSkipped)
+        {
+            logWARNING("GpuProfiler") << "More than " << m_zones.size() << " gpu zones are waiting for results on track \""
+                                      << m_track->name() << "\", new zones are skipped. Call collect() more often "
+                                      << "or increase maxZonesInFlight.";
+            m_warnedSkipped = true;
+        }
+        return -1;
+    }
+
+    const std::size_t index = (m_first + m_inFlight) % m_zones.size();
+    m_inFlight++;
+
+    Zone& zone = m_zones[index];
+    zone.name = name;
+    zone.depth = m_depth++;
+    zone.ended = false;
+    zone.begin.timestamp();
+    return static_cast<int>(index);
+}
+
+void GpuProfiler::endZone(int zone)
+{
+    m_zones[zone].end.timestamp();
+    m_zones[zone].ended = true;
+    m_depth = m_zones[zone].depth;
+}
+
+void GpuProfiler::collect()
+{
+    if(m_inFlight == 0)
+        return;
+
+    // gpu timestamps are converted to the cpu clock using the current time of both
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    const int64_t offset = Profiler::now() - static_cast<int64_t>(gpuNow);
+
+    // zones are collected in the order they were started, an outer zone keeps all inner ones from being collected until it ended
+    while(m_inFlight > 0)
+    {
+        Zone& zone = m_zones[m_first];
+        if(!zone.ended || !zone.end.isResultAvailable())
+            break;
+
+        m_track->record({zone.name, static_cast<int64_t>(zone.begin.result()) + offset,
+                         static_cast<int64_t>(zone.end.result()) + offset, zone.depth});
+        m_first = (m_first + 1) % m_zones.size();
+        m_inFlight--;
+    }
+}
+
+}}
@@ -0,0 +1,119 @@
+/*
+ * mpUtils
+ * GpuProfiler.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the GpuProfiler class, which adds the gpu time of profiling zones to the timeline of the Profiler
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_GPUPROFILER_H
+#define MPUTILS_GPUPROFILER_H
+
+// includes
+//--------------------
+#include <memory>
+#include <string>
+#include <vector>
+#include "../Opengl/Query.h"
+#include "../../Profiler/Profiler.h"
+//--------------------
+
+// defines
+//--------------------
+
+// measure cpu and gpu time until the end of the current scope, NAME needs to be a string literal
+#ifdef MPU_NO_PROFILING
+    #define PROFILE_GPU_SCOPE(NAME)
+#else
+    #define PROFILE_GPU_SCOPE(NAME) mpu::gph::GpuProfileZone _MPU_PROFILE_CONCAT(_mpu_gpu_profile_zone_,__LINE__)(NAME)
+#endif
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+namespace gph {
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class GpuProfiler
+ *
+ * usage:
+ * Measures when the gpu executed the commands of a profiling zone using timestamp queries, and adds them to a
+ * track of the Profiler. Gpu times are converted to the cpu clock, so cpu and gpu work show on one timeline.
+ *
+ * Create one GpuProfiler for each OpenGL context, while the context is current, and call makeCurrent() from the
+ * thread that uses the context. PROFILE_GPU_SCOPE("name") then records a cpu zone and a gpu zone.
+ * Call collect() regularly (eg once per frame, or after every step of a simulation that runs many steps per frame),
+ * it reads all results that are available without waiting for the gpu. If more than maxZonesInFlight zones are waiting
+ * for results, new gpu zones are skipped and a warning is logged the first time this happens. Choose maxZonesInFlight
+ * larger than the number of zones started between two calls to collect(), the gpu might be a few frames behind.
+ *
+ */
+class GpuProfiler
+{
+public:
+    explicit GpuProfiler(std::string trackName, std::size_t maxZonesInFlight = 256);
+
+    void makeCurrent(); //!< PROFILE_GPU_SCOPE on the calling thread uses this profiler
+    static GpuProfiler* current(); //!< the profiler used by the calling thread, or nullptr
+
+    int beginZone(const char* name); //!< start a zone, returns -1 if the zone is not recorded
+    void endZone(int zone); //!< end the zone returned by beginZone()
+    void collect(); //!< add all zones whose results are available to the profiler
+
+private:
+    struct Zone
+    {
+        const char* name{nullptr};
+        Query begin{GL_TIMESTAMP};
+        Query end{GL_TIMESTAMP};
+        uint32_t depth{0};
+        bool ended{false};
+    };
+
+    std::vector<Zone> m_zones; //!< ring of zones in flight
+    std::size_t m_first{0}; //!< oldest zone that was not collected
+    std::size_t m_inFlight{0}; //!< number of zones that were not collected
+    uint32_t m_depth{0}; //!< depth of the next zone
+    bool m_warnedSkipped{false}; //!< skipped zones are only reported once
+    std::shared_ptr<ProfileTrack> m_track;
+};
+
+//-------------------------------------------------------------------
+/**
+ * class GpuProfileZone
+ * measures cpu and gpu time from its construction to its destruction, use via the PROFILE_GPU_SCOPE macro
+ */
+class GpuProfileZone
+{
+public:
+    explicit GpuProfileZone(const char* name) : m_cpuZone(name)
+    {
+        if(Profiler::isEnabled() && (m_profiler = GpuProfiler::current()))
+            m_zone = m_profiler->beginZone(name);
+    }
+
+    ~GpuProfileZone()
+    {
+        if(m_zone >= 0)
+            m_profiler->endZone(m_zone);
+    }
+
+    GpuProfileZone(const GpuProfileZone& other) = delete;
+    GpuProfileZone& operator=(const GpuProfileZone& other) = delete;
+
+private:
+    ProfileZone m_cpuZone;
+    GpuProfiler* m_profiler{nullptr};
+    int m_zone{-1};
+};
+
+}}
+#endif //MPUTILS_GPUPROFILER_H
@@ -0,0 +1,268 @@
+/*
+ * mpUtils
+ * BinarySink.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the BinarySink class, which writes compact binary log records to a memory mapped file
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "BinarySink.h"
+#include <cstring>
+#include <experimental/filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu{
+//--------------------
+
+namespace {
+    constexpr std::size_t minBinaryLogSize = 64*1024; // makes sure every message fits into an empty file
+    constexpr std::size_t padToRecord(std::size_t size) { return (size + 7u) & ~std::size_t(7u); }
+    constexpr std::size_t truncateToRecord(std::size_t size) { return size & ~std::size_t(7u); }
+}
+
+// function definitions of the BinarySink class
+//-------------------------------------------------------------------
+BinarySink::BinarySink(std::string sFilename, std::size_t maxFileSize, int numLogsToKeep)
+    : m_maxFileSize(truncateToRecord(std::max(maxFileSize,minBinaryLogSize))), m_numLogsToKeep(numLogsToKeep), m_logfileName(std::move(sFilename))
+{
+    openFile();
+}
+
+BinarySink::~BinarySink()
+{
+    closeFile();
+}
+
+BinarySink::BinarySink(BinarySink&& other) noexcept
+    : m_fd(other.m_fd), m_data(other.m_data), m_used(other.m_used), m_maxFileSize(other.m_maxFileSize),
+      m_numLogsToKeep(other.m_numLogsToKeep), m_logfileName(std::move(other.m_logfileName)),
+      m_nextStringId(other.m_nextStringId), m_moduleIds(std::move(other.m_moduleIds)),
+      m_positionIds(std::move(other.m_positionIds)), m_threadIds(std::move(other.m_threadIds))
+{
+    other.m_fd = -1;
+    other.m_data = nullptr;
+}
+
+BinarySink& BinarySink::operator=(BinarySink&& other) noexcept
+{
+    if(this != &other)
+    {
+        closeFile();
+        m_fd = other.m_fd;
+        m_data = other.m_data;
+        m_used = other.m_used;
+        m_maxFileSize = other.m_maxFileSize;
+        m_numLogsToKeep = other.m_numLogsToKeep;
+        m_logfileName = std::move(other.m_logfileName);
+        m_nextStringId = other.m_nextStringId;
+        m_moduleIds = std::move(other.m_moduleIds);
+        m_positionIds = std::move(other.m_positionIds);
+        m_threadIds = std::move(other.m_threadIds);
+        other.m_fd = -1;
+        other.m_data = nullptr;
+    }
+    return *this;
+}
+
+void BinarySink::operator()(const LogMessage &msg)
+{
+    BinaryLogRecord record{};
+    record.type = BinaryLogRecordType::MESSAGE;
+    record.level = static_cast<uint16_t>(msg.lvl);
+    record.timestamp = msg.timestamp.count();
+    record.threadId = threadId(msg.threadId);
+
+    uint32_t payloadSize = static_cast<uint32_t>(std::min<std::size_t>(msg.sMessage.size(), UINT32_MAX));
+    record.moduleId = moduleId(msg.sModue);
+    record.positionId = positionId(msg.sFilePosition);
+    if( (msg.sModue.empty() || record.moduleId != 0) && (msg.sFilePosition.empty() || record.positionId != 0)
+        && writeRecord(record, msg.sMessage.data(), payloadSize))
+        return;
+
+    // the file is full, start a new one and try again, truncating the message if it is larger then the whole file
+    rotateLog();
+    record.moduleId = moduleId(msg.sModue);
+    record.positionId = positionId(msg.sFilePosition);
+    const std::size_t available = m_maxFileSize - m_used - sizeof(BinaryLogRecord) - 8;
+    payloadSize = static_cast<uint32_t>(std::min<std::size_t>(payloadSize, available));
+    writeRecord(record, msg.sMessage.data(), payloadSize);
+}
+
+std::size_t BinarySink::PositionHash::operator()(const std::pair<const char*, int>& p) const
+{
+    return std::hash<const char*>()(p.first) ^ (std::hash<int>()(p.second) << 1);
+}
+
+uint32_t BinarySink::moduleId(std::string_view module)
+{
+    if(module.empty())
+        return 0;
+
+    auto it = m_moduleIds.find(module);
+    if(it != m_moduleIds.end())
+        return it->second;
+
+    const uint32_t id = defineString(module);
+    if(id != 0)
+        m_moduleIds.emplace(module,id);
+    return id;
+}
+
+uint32_t BinarySink::positionId(const LogPosition& pos)
+{
+    if(pos.empty())
+        return 0;
+
+    const std::pair<const char*,int> key(pos.file,pos.line);
+    auto it = m_positionIds.find(key);
+    if(it != m_positionIds.end())
+        return it->second;
+
+    // positions are formatted once per call site and file
+    std::ostringstream ss;
+    ss << pos;
+    const uint32_t id = defineString(ss.str());
+    if(id != 0)
+        m_positionIds.emplace(key,id);
+    return id;
+}
+
+uint64_t BinarySink::threadId(std::thread::id id)
+{
+    auto it = m_threadIds.find(id);
+    if(it != m_threadIds.end())
+        return it->second;
+
+    // there is no portable way to get the number, so use the same representation the other sinks print
+    std::ostringstream ss;
+    ss << id;
+    uint64_t value = 0;
+    try
+    {
+        value = std::stoull(ss.str());
+    }
+    catch(const std::exception&)
+    {
+        value = std::hash<std::thread::id>()(id);
+    }
+    m_threadIds.emplace(id,value);
+    return value;
+}
+
+uint32_t BinarySink::defineString(std::string_view s)
+{
+    BinaryLogRecord record{};
+    record.type = BinaryLogRecordType::STRING;
+    record.moduleId = m_nextStringId;
+    if(!writeRecord(record, s.data(), static_cast<uint32_t>(s.size())))
+        return 0;
+    return m_nextStringId++;
+}
+
+bool BinarySink::writeRecord(BinaryLogRecord record, const char* payload, uint32_t payloadSize)
+{
+    const std::size_t size = padToRecord(sizeof(BinaryLogRecord) + static_cast<std::size_t>(payloadSize));
+
+    // always keep room for the terminating zero size field
+    if(m_data == nullptr || m_used + size + sizeof(uint32_t) > m_maxFileSize)
+        return false;
+
+    record.size = 0;
+    record.payloadSize = payloadSize;
+    char* dst = m_data + m_used;
+    std::memcpy(dst, &record, sizeof(BinaryLogRecord));
+    std::memcpy(dst + sizeof(BinaryLogRecord), payload, payloadSize);
+
+    // the size is written last, a reader never sees a partially written record
+    const uint32_t finalSize = static_cast<uint32_t>(size);
+    std::atomic_signal_fence(std::memory_order_release);
+    std::memcpy(dst, &finalSize, sizeof(uint32_t));
+
+    m_used += size;
+    return true;
+}
+
+void BinarySink::openFile()
+{
+    namespace fs = std::experimental::filesystem;
+
+    // rename all existing files deleting the oldest (if logs kept is zero or one this will not be executed at all)
+    for(int i=m_numLogsToKeep-1; i >= 1; i--)
+    {
+        if(fs::exists( m_logfileName + "." + toString(i)))
+            fs::rename( m_logfileName + "." + toString(i), m_logfileName + "." + toString(i+1));
+    }
+
+    // if we want to keep at least one, move the original
+    if(m_numLogsToKeep > 0 && fs::exists( m_logfileName))
+        fs::rename( m_logfileName, m_logfileName + ".1");
+
+    m_fd = open(m_logfileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(m_fd < 0)
+        throw std::runtime_error("Log: Could not open binary log file " + m_logfileName);
+
+    // the file is zero filled, so unused space reads as the end of the data
+    if(ftruncate(m_fd, static_cast<off_t>(m_maxFileSize)) != 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+        throw std::runtime_error("Log: Could not allocate binary log file " + m_logfileName);
+    }
+
+    void* data = mmap(nullptr, m_maxFileSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if(data == MAP_FAILED)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+        throw std::runtime_error("Log: Could not map binary log file " + m_logfileName);
+    }
+    m_data = static_cast<char*>(data);
+
+    BinaryLogFileHeader header{};
+    std::memcpy(header.magic, binaryLogMagic, sizeof(header.magic));
+    header.version = binaryLogVersion;
+    std::memcpy(m_data, &header, sizeof(header));
+    m_used = padToRecord(sizeof(header));
+
+    m_nextStringId = 1;
+    m_moduleIds.clear();
+    m_positionIds.clear();
+}
+
+void BinarySink::closeFile()
+{
+    if(m_data != nullptr)
+    {
+        munmap(m_data, m_maxFileSize);
+        m_data = nullptr;
+    }
+
+    if(m_fd >= 0)
+    {
+        // cut the unused space, keeping the terminating zero size field
+        if(ftruncate(m_fd, static_cast<off_t>(m_used + sizeof(uint32_t))) != 0)
+            std::cerr << "Log: Could not truncate binary log file " << m_logfileName << std::endl;
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void BinarySink::rotateLog()
+{
+    closeFile();
+    openFile();
+}
+
+}
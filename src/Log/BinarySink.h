@@ -0,0 +1,126 @@
+/*
+ * mpUtils
+ * BinarySink.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the BinarySink class, which writes compact binary log records to a memory mapped file
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_BINARYSINK_H
+#define MPUTILS_BINARYSINK_H
+
+// includes
+//--------------------
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "Log.h"
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+//-------------------------------------------------------------------
+// binary log file format
+// A file starts with a BinaryLogFileHeader followed by records. Every record starts with a BinaryLogRecord header
+// followed by payloadSize bytes of payload, the whole record is padded to a multiple of 8 bytes.
+// Strings that are used by many messages (modules and file positions) are stored once per file in a STRING record
+// and then referenced by their id. Id 0 means "no string". A record with size 0 marks the end of the data.
+// All values are stored in host byte order.
+
+constexpr char binaryLogMagic[4] = {'M','P','L','B'};
+constexpr uint32_t binaryLogVersion = 1;
+
+struct BinaryLogFileHeader
+{
+    char magic[4];
+    uint32_t version;
+};
+
+enum class BinaryLogRecordType : uint16_t
+{
+    MESSAGE = 1, // a log message, payload is the message text
+    STRING = 2 // defines the string with the id stored in moduleId, payload is the string
+};
+
+struct BinaryLogRecord
+{
+    uint32_t size; //!< size of the record including header, payload and padding, 0 marks the end of the data
+    uint32_t payloadSize; //!< number of bytes of payload after the header
+    BinaryLogRecordType type;
+    uint16_t level; //!< the LogLvl of the message
+    uint32_t moduleId; //!< id of the module string, for STRING records the id that is defined
+    uint32_t positionId; //!< id of the file position string
+    uint32_t reserved;
+    int64_t timestamp; //!< nanoseconds since epoch
+    uint64_t threadId; //!< the std::thread::id as the other sinks print it
+};
+
+static_assert(sizeof(BinaryLogRecord) % 8 == 0, "binary log records need to keep 8 byte alignment");
+
+//-------------------------------------------------------------------
+/**
+ * class BinarySink
+ *
+ * usage:
+ * Create an instance of BinarySink and pass it to the log class to write log messages to a binary file.
+ * No formatting happens on the logger thread, messages are copied into a memory mapped file together with
+ * a nanosecond timestamp, level, thread id and ids for the module and file position.
+ * Use the LogDecoder tool to render the file to text.
+ * The file is allocated with maxFileSize bytes (rounded down to whole records), when it is full it is rotated and numLogsToKeep old files are kept.
+ * Every file is self contained. Messages that do not fit into an empty file are truncated.
+ * Since data is written to a shared mapping, everything that was logged survives a crash of the process.
+ *
+ */
+class BinarySink
+{
+public:
+    explicit BinarySink(std::string sFilename, std::size_t maxFileSize = 64*1024*1024, int numLogsToKeep = 1); // filesize in bytes
+    ~BinarySink();
+
+    BinarySink(const BinarySink& other) = delete;
+    BinarySink& operator=(const BinarySink& other) = delete;
+    BinarySink(BinarySink&& other) noexcept;
+    BinarySink& operator=(BinarySink&& other) noexcept;
+
+    void operator()(const LogMessage &msg);
+
+private:
+    struct PositionHash
+    {
+        std::size_t operator()(const std::pair<const char*,int>& p) const;
+    };
+
+    void openFile(); //!< rotates old files and maps a new one
+    void closeFile(); //!< unmaps the file and truncates it to the used size
+    void rotateLog();
+
+    uint32_t moduleId(std::string_view module); //!< returns the id of module, writes the string record if needed
+    uint32_t positionId(const LogPosition& pos); //!< returns the id of pos, writes the string record if needed
+    uint64_t threadId(std::thread::id id); //!< returns the numeric value of a thread id
+    uint32_t defineString(std::string_view s); //!< writes a string record and returns its id
+    bool writeRecord(BinaryLogRecord record, const char* payload, uint32_t payloadSize); //!< false if the file is full
+
+    int m_fd{-1};
+    char* m_data{nullptr};
+    std::size_t m_used{0}; // bytes written so far
+    std::size_t m_maxFileSize; // max file size before log is rotated
+    int m_numLogsToKeep; // number of old logs to keep
+    std::string m_logfileName; // save the filename to manage old logfiles
+
+    uint32_t m_nextStringId{1};
+    std::unordered_map<std::string_view, uint32_t> m_moduleIds; // module names have static storage duration
+    std::unordered_map<std::pair<const char*,int>, uint32_t, PositionHash> m_positionIds; // keyed by file and line
+    std::unordered_map<std::thread::id, uint64_t> m_threadIds; // numeric thread ids, converted once per thread
+};
+
+}
+#endif //MPUTILS_BINARYSINK_H
@@ -14,6 +14,10 @@
 // includes
 //--------------------
 #include "FileSink.h"
+#include <cerrno>
+#include <experimental/filesystem>
+#include <fcntl.h>
+#include <unistd.h>
 //--------------------
 
 // namespace
@@ -21,23 +25,215 @@
 namespace mpu{
 //--------------------
 
-// function definitions of the FileSink class
+namespace {
+    // lets a std::ostream format directly into the end of a string
+    class AppendBuffer : public std::streambuf
+    {
+    public:
+        explicit AppendBuffer(std::string* t) : target(t) {}
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if(!traits_type::eq_int_type(c, traits_type::eof()))
+                target->push_back(traits_type::to_char_type(c));
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            target->append(s, static_cast<size_t>(n));
+            return n;
+        }
+
+    private:
+        std::string* target;
+    };
+}
+
 //-------------------------------------------------------------------
-FileSink::FileSink(std::string sFilename, std:: size_t maxFileSize, int numLogsToKeep) : sLogfileName(sFilename), maxFileSize(maxFileSize), iNumLogsToKeep(numLogsToKeep)
+// state of a file sink, shared between the logger thread and the helper thread
+struct FileSink::State
 {
-    rotateLog();
+    State(std::string filename, std::size_t maxSize, int numLogs, FileSinkSettings s)
+        : sLogfileName(std::move(filename)), maxFileSize(maxSize), iNumLogsToKeep(numLogs), settings(s),
+          appendBuffer(&buffer), formatter(&appendBuffer)
+    {}
+
+    void openFile(); // opens a new empty log file (mtx needs to be locked or the helper not running)
+    void writeBuffer(std::size_t count = std::string::npos); // writes the first count bytes of the buffer to the file (mtx needs to be locked)
+    void startRotation(std::unique_lock<std::mutex>& lck, std::size_t count); // writes count bytes, then switches to a new file and hands the old one to the helper
+    void shiftOldLogs(); // renames the old logs, the newest one is expected at sLogfileName.0
+    void helperMainfunc();
+
+    const std::string sLogfileName; // save the filename to manage old logfiles
+    const std::size_t maxFileSize; // max file size before log is rotated
+    const int iNumLogsToKeep; // number of old logs to keep
+    const FileSinkSettings settings;
+
+    std::mutex mtx; // protects everything below
+    std::condition_variable helperCv; // wakes the helper when there is data in the buffer or a rotation to perform
+    std::condition_variable rotationCv; // signals the logger thread that the last rotation is finished
+    std::thread helper;
+    bool bShouldHelperRun{false};
+    bool bRotationPending{false};
+    int oldFd{-1}; // file descriptor of the file that is being rotated
 
-    if (!file.is_open())
+    int fd{-1};
+    std::size_t fileSize{0}; // bytes in the current file, without the buffer
+    std::string buffer; // formatted messages that are not yet written
+    std::chrono::steady_clock::time_point oldestBuffered; // time when the first message in the buffer was added
+    AppendBuffer appendBuffer;
+    std::ostream formatter; // formats messages into the buffer
+};
+
+void FileSink::State::openFile()
+{
+    fd = open(sLogfileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if(fd < 0)
         throw std::runtime_error("Log: Could not open output file stream!");
+    fileSize = 0;
 }
 
-void FileSink::operator()(const LogMessage &msg)
+void FileSink::State::writeBuffer(std::size_t count)
+{
+    count = std::min(count, buffer.size());
+    std::size_t written = 0;
+    while(written < count)
+    {
+        const ssize_t n = write(fd, buffer.data() + written, count - written);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            std::cerr << "Log: Could not write to log file " << sLogfileName << std::endl;
+            break;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+
+    if(settings.syncOnFlush && written > 0)
+        fdatasync(fd);
+
+    fileSize += written;
+    buffer.erase(0, count);
+}
+
+void FileSink::State::startRotation(std::unique_lock<std::mutex>& lck, std::size_t count)
+{
+    // the helper can only handle one file at a time
+    rotationCv.wait(lck, [this]{return !bRotationPending;});
+
+    writeBuffer(count);
+
+    // moving the current file out of the way is a single rename, everything else is left to the helper
+    if(iNumLogsToKeep > 0)
+        rename(sLogfileName.c_str(), (sLogfileName + ".0").c_str());
+
+    oldFd = fd;
+    openFile();
+    bRotationPending = true;
+    helperCv.notify_one();
+}
+
+void FileSink::State::shiftOldLogs()
+{
+    namespace fs = std::experimental::filesystem;
+
+    // rename all existing files deleting the oldest (if logs kept is zero or one this will not be executed at all)
+    for(int i=iNumLogsToKeep-1; i >= 1; i--)
+    {
+        if(fs::exists( sLogfileName + "." + toString(i)))
+            fs::rename( sLogfileName + "." + toString(i), sLogfileName + "." + toString(i+1));
+    }
+
+    // if we want to keep at least one, move the original
+    if(iNumLogsToKeep > 0 && fs::exists( sLogfileName + ".0"))
+        fs::rename( sLogfileName + ".0", sLogfileName + ".1");
+}
+
+void FileSink::State::helperMainfunc()
+{
+    std::unique_lock<std::mutex> lck(mtx);
+    while(bShouldHelperRun || bRotationPending)
+    {
+        if(bRotationPending)
+        {
+            const int fdToClose = oldFd;
+            lck.unlock();
+
+            if(settings.syncOnFlush)
+                fdatasync(fdToClose);
+            close(fdToClose);
+            shiftOldLogs();
+
+            lck.lock();
+            oldFd = -1;
+            bRotationPending = false;
+            rotationCv.notify_all();
+        }
+        else if(!buffer.empty())
+        {
+            const auto deadline = oldestBuffered + settings.maxDelay;
+            if(std::chrono::steady_clock::now() >= deadline)
+                writeBuffer();
+            else
+                helperCv.wait_until(lck, deadline);
+        }
+        else
+            helperCv.wait(lck);
+    }
+}
+
+// function definitions of the FileSink class
+//-------------------------------------------------------------------
+FileSink::FileSink(std::string sFilename, std:: size_t maxFileSize, int numLogsToKeep, FileSinkSettings settings)
+    : m_state(std::make_unique<State>(std::move(sFilename), maxFileSize, numLogsToKeep, settings))
+{
+    namespace fs = std::experimental::filesystem;
+
+    // keep the log of the last run
+    if(numLogsToKeep > 0 && fs::exists(m_state->sLogfileName))
+    {
+        fs::rename(m_state->sLogfileName, m_state->sLogfileName + ".0");
+        m_state->shiftOldLogs();
+    }
+    m_state->openFile();
+
+    // the helper is only needed for delayed writes and rotation
+    if(settings.bufferSize > 0 || maxFileSize > 0)
+    {
+        m_state->buffer.reserve(settings.bufferSize);
+        m_state->bShouldHelperRun = true;
+        m_state->helper = std::thread(&State::helperMainfunc, m_state.get());
+    }
+}
+
+FileSink::~FileSink()
 {
-    if(maxFileSize != 0 && ((std::size_t)(file.tellp()) + msg.sMessage.size()) > maxFileSize)
+    if(!m_state)
+        return;
+
     {
-        rotateLog();
+        std::lock_guard<std::mutex> lck(m_state->mtx);
+        m_state->writeBuffer();
+        m_state->bShouldHelperRun = false;
+        m_state->helperCv.notify_one();
     }
 
+    if(m_state->helper.joinable())
+        m_state->helper.join();
+
+    if(m_state->settings.syncOnFlush)
+        fdatasync(m_state->fd);
+    close(m_state->fd);
+}
+
+FileSink::FileSink(FileSink&& other) noexcept = default;
+FileSink& FileSink::operator=(FileSink&& other) noexcept = default;
+
+void FileSink::operator()(const LogMessage &msg)
+{
     struct tm timeStruct;
 #ifdef __linux__
     localtime_r(&msg.timepoint, &timeStruct);
@@ -45,6 +241,13 @@ void FileSink::operator()(const LogMessage &msg)
 #error please implement this for your operating system
 #endif
 
+    State& s = *m_state;
+    std::unique_lock<std::mutex> lck(s.mtx);
+
+    bool wasEmpty = s.buffer.empty();
+    const std::size_t oldSize = s.buffer.size();
+    std::ostream& file = s.formatter;
+
     file <<  "[" << toString(msg.lvl) << "]"
         << " [" << std::put_time( &timeStruct, "%c") << "]";
 
@@ -57,31 +260,22 @@ void FileSink::operator()(const LogMessage &msg)
     if(!msg.sFilePosition.empty())
         file << "\t@File: " << msg.sFilePosition;
 
-    file << std::endl;
-}
-
-void FileSink::rotateLog()
-{
-    namespace fs = std::experimental::filesystem;
-    if(file.is_open())
-        file.close();
+    file << '\n';
 
-    // rename all existing files deleting the oldest (if logs kept is zero or one this will not be executed at all)
-    for(int i=iNumLogsToKeep-1; i >= 1; i--)
+    // rotate before the message if it would not fit into the current file anymore
+    if(s.maxFileSize != 0 && s.fileSize + s.buffer.size() > s.maxFileSize && s.fileSize + oldSize > 0)
     {
-        if(fs::exists( sLogfileName + "." + toString(i)))
-            fs::rename( sLogfileName + "." + toString(i), sLogfileName + "." + toString(i+1));
+        s.startRotation(lck, oldSize);
+        wasEmpty = true;
     }
 
-    // if we want to keep at least one, move the original
-    if(iNumLogsToKeep > 0 && fs::exists( sLogfileName))
-        fs::rename( sLogfileName, sLogfileName + ".1");
-
-    file.open(sLogfileName, std::ofstream::out | std::ofstream::trunc);
+    if(wasEmpty)
+        s.oldestBuffered = std::chrono::steady_clock::now();
 
-    if (!file.is_open())
-        throw std::runtime_error("Log: Could not open output file stream!");
+    if(s.buffer.size() >= s.settings.bufferSize || (msg.lvl <= s.settings.flushLevel && msg.lvl != LogLvl::NOLOG))
+        s.writeBuffer();
+    else if(wasEmpty)
+        s.helperCv.notify_one();
 }
 
-
-}
\ No newline at end of file
+}
@@ -16,8 +16,7 @@
 
 // includes
 //--------------------
-#include <fstream>
-#include <experimental/filesystem>
+#include <chrono>
 #include <memory>
 #include <stdexcept>
 #include "Log.h"
@@ -28,6 +27,19 @@
 namespace mpu {
 //--------------------
 
+//-------------------------------------------------------------------
+/**
+ * struct FileSinkSettings
+ * controls latency and durability of a FileSink
+ */
+struct FileSinkSettings
+{
+    std::size_t bufferSize = 0; //!< messages are collected until this many bytes are buffered, 0 writes every message right away
+    std::chrono::milliseconds maxDelay{100}; //!< buffered messages are written to the file after at most this time
+    LogLvl flushLevel = LogLvl::WARNING; //!< messages with this or a higher priority are written right away together with the buffer
+    bool syncOnFlush = false; //!< call fdatasync after every write, so messages survive a crash of the operating system
+};
+
 //-------------------------------------------------------------------
 /**
  * class FileSink
@@ -35,23 +47,28 @@ namespace mpu {
  * usage:
  * create an instance of file sink and pass it to the log class to log messages to a file.
  * Use maxFileSize and numLogsToKeep to enable logrotation. If maxFileSize is 0 Logs will not be rotated.
+ * Pass FileSinkSettings with a bufferSize to enable buffering. Messages are then collected and written in one
+ * call when the buffer is full, maxDelay has passed, an important message is logged, or the sink is destroyed.
+ * When the file is rotated, writing continues in the new file right away while a helper thread closes the
+ * old file and renames the old logs.
  *
  */
 class FileSink
 {
 public:
-    FileSink(std::string sFilename, std:: size_t maxFileSize = 0, int numLogsToKeep = 1); // filesize in bytes
+    FileSink(std::string sFilename, std:: size_t maxFileSize = 0, int numLogsToKeep = 1,
+             FileSinkSettings settings = FileSinkSettings()); // filesize in bytes
+    ~FileSink();
+
+    FileSink(FileSink&& other) noexcept;
+    FileSink& operator=(FileSink&& other) noexcept;
+
     void operator()(const LogMessage &msg);
 
 private:
-    std::ofstream file;
-    void rotateLog();
-
-    std::size_t maxFileSize; // max file size before log is rotated
-    int iNumLogsToKeep; // number of old logs to keep
-    std::string sLogfileName; // save the filename to manage old logfiles
+    struct State; // file, buffer and helper thread live on the heap, so the sink can be moved
+    std::unique_ptr<State> m_state;
 };
 
-
 }
 #endif //MPUTILS_FILESINK_H
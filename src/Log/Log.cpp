@@ -14,6 +14,7 @@
 // includes
 //--------------------
 #include <aliases.h>
+#include <unordered_set>
 #include "Log.h"
 //--------------------
 
@@ -27,6 +28,39 @@ const std::string LogLvlToString[] = {"NOLOG", "FATAL_ERROR", "ERROR", "WARNING"
                                       "ALL"};
 const std::string LogLvlStringInvalid = "INVALID";
 
+namespace {
+    // messages that are not in use, shared by all logs
+    struct MessagePool
+    {
+        static constexpr size_t maxKeptCapacity = 4096; // larger message strings are not kept in the pool
+        LogQueue<LogMessage*> freeMessages{2*MPU_LOG_QUEUE_CAPACITY};
+        ~MessagePool()
+        {
+            LogMessage* lm;
+            while(freeMessages.pop(lm))
+                delete lm;
+        }
+    };
+
+    MessagePool& messagePool()
+    {
+        static MessagePool pool;
+        return pool;
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const LogPosition& pos)
+{
+    if(pos.empty())
+        return os;
+    os << pos.file;
+    if(pos.line > 0)
+        os << " Line: " << pos.line;
+    if(pos.function)
+        os << " Function " << pos.function;
+    return os;
+}
+
 // functions of the Log class
 //-------------------------------------------------------------------
 Log::~Log()
@@ -49,70 +83,170 @@ void Log::close()
     logLvl = LogLvl::NOLOG;
 
     // wait for the logger to print all queued messages and join the thread
-    std::unique_lock<std::mutex> lck(loggerMtx);
-    if(bShouldLoggerRun)
-    {
-        bShouldLoggerRun = false;
-        loggerCv.notify_one();
-    }
-    lck.unlock();
+    if(bShouldLoggerRun.exchange(false))
+        wakeLogger();
     if(loggerMainThread.joinable())
         loggerMainThread.join();
-    lck.lock();
+
+    // messages that raced with the shutdown are discarded
+    LogMessage* msg;
+    while(messageQueue.pop(msg))
+        releaseMessage(msg);
 
     // remove all sinks
+    std::lock_guard<std::mutex> lck(loggerMtx);
     printFunctions.clear();
     logLvl = oldLvl;
 }
 
 void Log::logMessage(LogMessage* lm)
 {
-    if(!printFunctions.empty() && lm->lvl <= logLvl)
+    if(printFunctions.empty() || lm->lvl > logLvl)
+    {
+        releaseMessage(lm);
+        return;
+    }
+
+    while(!messageQueue.push(lm))
     {
-        std::lock_guard<std::mutex> lck(queueMtx);
-        messageQueue.push(lm);
-        loggerCv.notify_one();
+        switch(overflowPolicy)
+        {
+            case LogOverflowPolicy::DROP_NEWEST:
+                releaseMessage(lm);
+                droppedMessages++;
+                return;
+            case LogOverflowPolicy::DROP_OLDEST:
+            {
+                LogMessage* oldest;
+                if(messageQueue.pop(oldest))
+                {
+                    releaseMessage(oldest);
+                    droppedMessages++;
+                }
+                break;
+            }
+            case LogOverflowPolicy::BLOCK:
+            default:
+                wakeLogger();
+                yield();
+                break;
+        }
     }
+
+    // only wake the logger if it is actually waiting, the fence pairs with the one in loggerMainfunc
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(bLoggerSleeping)
+        wakeLogger();
 }
 
-LogStream Log::operator()(const LogLvl lvl, std::string&& sFilepos, std::string&& sModule)
+LogStream Log::operator()(const LogLvl lvl, const LogPosition pos, const char* sModule)
 {
-    LogMessage* lm = new LogMessage;
+    LogMessage* lm = allocateMessage();
     lm->lvl = lvl;
-    lm->sFilePosition = std::move(sFilepos);
-    lm->sModue = std::move(sModule);
+    lm->sFilePosition = pos;
+    lm->sModue = sModule;
     lm->threadId = std::this_thread::get_id();
-    lm->timepoint = time(nullptr);
+    const auto now = std::chrono::system_clock::now();
+    lm->timepoint = std::chrono::system_clock::to_time_t(now);
+    lm->timestamp = now.time_since_epoch();
 
     return LogStream( (*this), lm);
 }
 
+LogStream Log::operator()(const LogLvl lvl, const LogPosition pos, const std::string& sModule)
+{
+    return (*this)(lvl, pos, internString(sModule));
+}
+
+LogMessage* Log::allocateMessage()
+{
+    LogMessage* lm;
+    if(messagePool().freeMessages.pop(lm))
+        return lm;
+    return new LogMessage;
+}
+
+void Log::releaseMessage(LogMessage* lm)
+{
+    lm->sMessage.clear();
+    if(lm->sMessage.capacity() > MessagePool::maxKeptCapacity || !messagePool().freeMessages.push(lm))
+        delete lm;
+}
+
+const char* Log::internString(const std::string& s)
+{
+    static std::mutex internMtx;
+    static std::unordered_set<std::string> internedStrings;
+
+    std::lock_guard<std::mutex> lck(internMtx);
+    return internedStrings.insert(s).first->c_str();
+}
+
+void Log::wakeLogger()
+{
+    std::lock_guard<std::mutex> lck(wakeMtx);
+    loggerCv.notify_one();
+}
+
+void Log::reportDrops()
+{
+    const uint64_t dropped = droppedMessages;
+    if(dropped == reportedDrops)
+        return;
+
+    LogMessage msg;
+    msg.lvl = LogLvl::WARNING;
+    msg.sModue = "Log";
+    msg.sMessage = toString(dropped - reportedDrops) + " messages where dropped because the log queue was full.";
+    msg.threadId = std::this_thread::get_id();
+    const auto now = std::chrono::system_clock::now();
+    msg.timepoint = std::chrono::system_clock::to_time_t(now);
+    msg.timestamp = now.time_since_epoch();
+    reportedDrops = dropped;
+
+    for(auto &&function : printFunctions)
+        function(msg);
+}
+
 void Log::loggerMainfunc()
 {
-    std::unique_lock<std::mutex> lck(loggerMtx);
-    do
+    std::vector<LogMessage*> batch;
+    batch.reserve(logBatchSize);
+    while(true)
     {
-        loggerCv.wait(lck);
+        LogMessage* msg;
+        while(batch.size() < logBatchSize && messageQueue.pop(msg))
+            batch.push_back(msg);
 
-        std::unique_lock<std::mutex> queueLck(queueMtx);
-        while(!messageQueue.empty())
+        if(!batch.empty())
         {
-            auto msg= messageQueue.front();
-            messageQueue.pop();
-            queueLck.unlock();
-
             // print to all sinks
-            for(auto &&function : printFunctions)
+            std::lock_guard<std::mutex> lck(loggerMtx);
+            reportDrops();
+            for(auto &&message : batch)
             {
-                function(*msg);
+                for(auto &&function : printFunctions)
+                    function(*message);
+                releaseMessage(message);
             }
+            batch.clear();
+            continue;
+        }
 
-            delete(msg);
+        // the queue is empty, stop or wait for new messages
+        if(!bShouldLoggerRun)
+            break;
 
-            queueLck.lock();
-        }
+        std::unique_lock<std::mutex> lck(wakeMtx);
+        bLoggerSleeping = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(messageQueue.empty() && bShouldLoggerRun)
+            loggerCv.wait_for(lck, std::chrono::milliseconds(100));
+        bLoggerSleeping = false;
     }
-    while(bShouldLoggerRun);
+
+    std::lock_guard<std::mutex> lck(loggerMtx);
+    reportDrops();
 }
 
 // static variables
@@ -25,42 +25,77 @@
 #include <atomic>
 #include <iostream>
 #include <functional>
+#include <vector>
+#include <string_view>
+#include <chrono>
 #include "../mpUtils.h"
+#include "LogQueue.h"
+#include "LogLimiter.h"
 
 //--------------------
 
 // defines
 //--------------------
 
+// number of messages that can wait for the logger thread, define before including to change it
+#ifndef MPU_LOG_QUEUE_CAPACITY
+    #define MPU_LOG_QUEUE_CAPACITY 4096
+#endif
+
 // macro to print file position
 #define _folders 2
 #define _mpu_mystr(x) _mpu_mystr2(x) //convert to string
 #define _mpu_mystr2(x) #x
-#define MPU_FILEPOS  std::string(mpu::shortenPath( __FILE__ , _folders)) + " Line: "  _mpu_mystr(__LINE__)  " Function " + std::string(__PRETTY_FUNCTION__) // output file, line and function
+#define MPU_FILEPOS  mpu::LogPosition{mpu::shortenPath( __FILE__ , _folders), __LINE__, __PRETTY_FUNCTION__} // output file, line and function
+
+// messages less important than this level are removed at compile time, define before including to change it
+// (e.g. -DMPU_LOG_MIN_LEVEL=mpu::LogLvl::WARNING), by default debug messages are removed in release builds
+#ifndef MPU_LOG_MIN_LEVEL
+    #ifdef NDEBUG
+        #define MPU_LOG_MIN_LEVEL mpu::LogLvl::INFO
+    #else
+        #define MPU_LOG_MIN_LEVEL mpu::LogLvl::ALL
+    #endif
+#endif
 
-// macros for simplified global logging
+// true if a message of level LVL would be written to the global log, constant false if LVL is disabled at compile time
+#define MPU_LOG_ENABLED(LVL) (mpu::LogLvl::LVL <= MPU_LOG_MIN_LEVEL && !mpu::Log::noGlobal() && mpu::Log::getGlobal().getLogLevel() >= mpu::LogLvl::LVL)
+
+// a static object that is unique for each place the macro is used
+#define MPU_LOG_SITE(TYPE) ([]() -> TYPE& {static TYPE site; return site;}())
 
-#define logFATAL_ERROR(MODULE) if(mpu::Log::noGlobal() || mpu::Log::getGlobal().getLogLevel() < mpu::LogLvl::FATAL_ERROR) ; \
+// macros for simplified global logging
+#define logFATAL_ERROR(MODULE) if(!MPU_LOG_ENABLED(FATAL_ERROR)) ; \
                     else mpu::Log::getGlobal()(mpu::LogLvl::FATAL_ERROR, MPU_FILEPOS, MODULE)
-#define logERROR(MODULE) if(mpu::Log::noGlobal() || mpu::Log::getGlobal().getLogLevel() < mpu::LogLvl::ERROR) ; \
+#define logERROR(MODULE) if(!MPU_LOG_ENABLED(ERROR)) ; \
                     else mpu::Log::getGlobal()(mpu::LogLvl::ERROR, MPU_FILEPOS, MODULE)
-#define logWARNING(MODULE) if(mpu::Log::noGlobal() || mpu::Log::getGlobal().getLogLevel() < mpu::LogLvl::WARNING) ; \
+#define logWARNING(MODULE) if(!MPU_LOG_ENABLED(WARNING)) ; \
                     else mpu::Log::getGlobal()(mpu::LogLvl::WARNING, MPU_FILEPOS, MODULE)
-#define logINFO(MODULE) if(mpu::Log::noGlobal() || mpu::Log::getGlobal().getLogLevel() < mpu::LogLvl::INFO) ; \
+#define logINFO(MODULE) if(!MPU_LOG_ENABLED(INFO)) ; \
                     else mpu::Log::getGlobal()(mpu::LogLvl::INFO, MPU_FILEPOS, MODULE)
+#define logDEBUG(MODULE) if(!MPU_LOG_ENABLED(DEBUG)) ; \
+                    else mpu::Log::getGlobal()(mpu::LogLvl::DEBUG, MPU_FILEPOS, MODULE)
+#define logDEBUG2(MODULE) if(!MPU_LOG_ENABLED(DEBUG2)) ; \
+                    else mpu::Log::getGlobal()(mpu::LogLvl::DEBUG2, MPU_FILEPOS, MODULE)
+
+// log only the first and then every N-th message from this line, eg: logEVERY_N(WARNING, 100, "Sim") << "..."
+// the number of skipped messages is prepended to the message
+#define logEVERY_N(LVL, N, MODULE) if(!MPU_LOG_ENABLED(LVL)) ; \
+                    else if(uint64_t _mpu_suppressed = 0; !MPU_LOG_SITE(mpu::LogEveryN).shouldLog(N, _mpu_suppressed)) ; \
+                    else mpu::Log::getGlobal()(mpu::LogLvl::LVL, MPU_FILEPOS, MODULE) << mpu::LogSuppressed{_mpu_suppressed}
+
+// log at most PER_SECOND messages per second from this line, eg: logRATE_LIMITED(DEBUG, 10, "Sim") << "..."
+// the number of skipped messages is prepended to the message
+#define logRATE_LIMITED(LVL, PER_SECOND, MODULE) if(!MPU_LOG_ENABLED(LVL)) ; \
+                    else if(uint64_t _mpu_suppressed = 0; !MPU_LOG_SITE(mpu::LogRateLimiter).shouldLog(PER_SECOND, _mpu_suppressed)) ; \
+                    else mpu::Log::getGlobal()(mpu::LogLvl::LVL, MPU_FILEPOS, MODULE) << mpu::LogSuppressed{_mpu_suppressed}
+
 #define assert_critical(TEST,MODULE,MESSAGE) if(!( TEST )){ logFATAL_ERROR(MODULE) << "Assert failed: " << (MESSAGE) ; throw std::runtime_error(MESSAGE);}
 
-// debug is disabled on release build
+// debug asserts are disabled on release build
 #ifdef NDEBUG
-    #define logDEBUG(MODULE) if(false) mpu::Log::getGlobal()(mpu::LogLvl::DEBUG, MPU_FILEPOS, MODULE)
-    #define logDEBUG2(MODULE) if(false) mpu::Log::getGlobal()(mpu::LogLvl::DEBUG2, MPU_FILEPOS, MODULE)
     #define assert_true(TEST,MODULE,MESSAGE)
 #else
-
-    #define logDEBUG(MODULE) if(mpu::Log::noGlobal() || mpu::Log::getGlobal().getLogLevel() < mpu::LogLvl::DEBUG) ; \
-                        else mpu::Log::getGlobal()(mpu::LogLvl::DEBUG, MPU_FILEPOS, MODULE)
-    #define logDEBUG2(MODULE) if(mpu::Log::noGlobal() || mpu::Log::getGlobal().getLogLevel() < mpu::LogLvl::DEBUG2) ; \
-                        else mpu::Log::getGlobal()(mpu::LogLvl::DEBUG2, MPU_FILEPOS, MODULE)
     #define assert_true(TEST,MODULE,MESSAGE) if(!( TEST )){ logERROR(MODULE) << "Assert failed: " << (MESSAGE) ; throw std::runtime_error(MESSAGE);}
 #endif
 //--------------------
@@ -95,18 +130,48 @@ enum LogLvl // enum to specify log level
 extern const std::string LogLvlToString[]; // lookup to transform Loglvl to string
 extern const std::string LogLvlStringInvalid; // lookup to transform Loglvl to string
 
+//-------------------------------------------------------------------
+/**
+ * enum LogOverflowPolicy
+ * specifies what happens when a message is logged while the queue to the logger thread is full
+ */
+enum class LogOverflowPolicy
+{
+    BLOCK, // wait until the logger thread made room, no message is lost
+    DROP_OLDEST, // discard the oldest message in the queue and count it as dropped
+    DROP_NEWEST // discard the new message and count it as dropped
+};
+
+//-------------------------------------------------------------------
+/**
+ * struct LogPosition
+ * position in the source code a message was logged from, all strings are compile time constants
+ */
+struct LogPosition
+{
+    const char* file{nullptr};
+    int line{0};
+    const char* function{nullptr};
+
+    bool empty() const {return file == nullptr;} // true if no position was given
+};
+std::ostream& operator<<(std::ostream& os, const LogPosition& pos); // prints "file Line: line Function function"
+
 //-------------------------------------------------------------------
 /**
  * struct LogMessage
  * struct to specify all elements of a log message
+ * Messages are pooled, the capacity of sMessage is kept when a message is reused. sModue always refers to a
+ * string with static storage duration (a literal or a string interned by the log).
  */
 struct LogMessage
 {
     std::string sMessage;
-    std::string sFilePosition;
-    std::string sModue;
+    LogPosition sFilePosition;
+    std::string_view sModue;
     LogLvl lvl;
     time_t timepoint;
+    std::chrono::nanoseconds timestamp; // time since epoch in full precision, same point in time as timepoint
     std::thread::id threadId;
 };
 
@@ -128,6 +193,9 @@ struct LogMessage
  * be logged. To log a message you can use the "( ... )" function call operator and provide additional
  * parameters like the LogLevel of the mesage and then input text to the message using the "<<" operator.
  * The message is formatted and written to the Log automatically in a different thread.
+ * Logging does not allocate memory in the common case: LogMessages are taken from a pool, the text is written
+ * directly into the pooled message using a thread local stream (see LogStream) and module names are either
+ * string literals or interned once.
  *
  * the Global log:
  * There is one additional feature called the global log. you can make a log global using makeGlobal().
@@ -140,6 +208,10 @@ struct LogMessage
  * The class was developed with the goal to allow logging from all threads at the same time, as a
  * result the class is totally thread save. Messages from different threads are printed line after line.
  * Also all parameters can safely be changed from different threads.
+ * Messages are passed to the logger thread through a bounded lock free queue (see LogQueue) with
+ * MPU_LOG_QUEUE_CAPACITY entries. The logger thread drains it in batches and is only woken up if it is sleeping.
+ * Use setOverflowPolicy() to decide what happens when the queue is full. Dropped messages are counted, the count
+ * is written to the sinks as a warning and can be read using getDroppedMessages().
  *
  */
 class Log
@@ -162,12 +234,21 @@ public:
     // getter and setter
     void setLogLevel(LogLvl lvl) {logLvl = lvl;} // set the current log level
     LogLvl getLogLevel() const {return logLvl;} // get the current log level
+    void setOverflowPolicy(LogOverflowPolicy policy) {overflowPolicy = policy;} // set what happens if the message queue is full
+    LogOverflowPolicy getOverflowPolicy() const {return overflowPolicy;} // get what happens if the message queue is full
+    uint64_t getDroppedMessages() const {return droppedMessages;} // number of messages dropped because the queue was full
+    size_t getQueueCapacity() const {return messageQueue.capacity();} // number of messages that fit into the queue
     void makeGlobal() {globalLog = this;}   // makes the current log global
     static Log &getGlobal() {return *globalLog;} // gets the global log
     static bool noGlobal() {return (globalLog == nullptr);} // checks if there is no global log set
 
     // operators
-    LogStream operator()(LogLvl lvl, std::string&& sFilepos ="", std::string&& sModule="");
+    LogStream operator()(LogLvl lvl, LogPosition pos = LogPosition(), const char* sModule=""); // sModule needs static storage duration (eg a literal)
+    LogStream operator()(LogLvl lvl, LogPosition pos, const std::string& sModule); // sModule is interned, use for module names created at runtime
+
+    static LogMessage* allocateMessage(); // take a message from the pool
+    static void releaseMessage(LogMessage* lm); // return a message to the pool
+    static const char* internString(const std::string& s); // returns a pointer to a copy of s that lives until the program ends
 
     // make noncopyable and nonmoveable
     Log(const Log& that) = delete;
@@ -180,16 +261,24 @@ private:
 
     static Log* globalLog; // point this to the global log
 
-    std::queue< LogMessage*> messageQueue; // queue to collect messages from all threads
+    static constexpr size_t logBatchSize = 64; // maximum number of messages the logger takes from the queue at once
+
+    LogQueue<LogMessage*> messageQueue{MPU_LOG_QUEUE_CAPACITY}; // queue to collect messages from all threads
+    std::atomic<LogOverflowPolicy> overflowPolicy{LogOverflowPolicy::BLOCK}; // what to do if the queue is full
+    std::atomic<uint64_t> droppedMessages{0}; // number of messages that where dropped
+    uint64_t reportedDrops{0}; // number of dropped messages already reported to the sinks (logger thread only)
 
     // thread management
-    std::mutex queueMtx;  // mutex to protect the queue
     std::mutex loggerMtx; // protect the logging operation
+    std::mutex wakeMtx; // used with the cv to wake up the logger
     std::condition_variable loggerCv; // cv to notify the logger when new messages arrive
-    bool bShouldLoggerRun; // controle if the logger thread is running
+    std::atomic_bool bLoggerSleeping{false}; // set while the logger thread waits for messages
+    std::atomic_bool bShouldLoggerRun; // controle if the logger thread is running
 
     std::thread loggerMainThread; // the logger main thread
     void loggerMainfunc(); // the mainfunc of the second thread
+    void wakeLogger(); // wake up the logger thread
+    void reportDrops(); // write the number of dropped messages to the sinks (logger thread only)
 
     std::vector<std::function<void(const LogMessage& msg)>> printFunctions; // the funtion used to print a message to the log
 };
@@ -0,0 +1,107 @@
+/*
+ * mpUtils
+ * LogLimiter.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the LogEveryN and LogRateLimiter classes, which keep messages of a single call site from flooding the log
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_LOGLIMITER_H
+#define MPUTILS_LOGLIMITER_H
+
+// includes
+//--------------------
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <ostream>
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class LogEveryN
+ * lets through the first and then every n-th message of a call site, use via the logEVERY_N macro
+ */
+class LogEveryN
+{
+public:
+    bool shouldLog(uint64_t n, uint64_t& suppressed) //!< true if the message should be logged, suppressed is set to the number of messages skipped since the last one
+    {
+        n = std::max<uint64_t>(n,1);
+        const uint64_t c = m_count.fetch_add(1, std::memory_order_relaxed);
+        if(c % n != 0)
+            return false;
+        suppressed = (c == 0) ? 0 : n-1;
+        return true;
+    }
+
+private:
+    std::atomic<uint64_t> m_count{0};
+};
+
+//-------------------------------------------------------------------
+/**
+ * class LogRateLimiter
+ * token bucket that lets through at most messagesPerSecond messages per second from one call site,
+ * bursts of up to one second worth of messages are allowed. Use via the logRATE_LIMITED macro.
+ */
+class LogRateLimiter
+{
+public:
+    bool shouldLog(double messagesPerSecond, uint64_t& suppressed) //!< true if the message should be logged, suppressed is set to the number of messages skipped since the last one
+    {
+        using namespace std::chrono;
+        const int64_t interval = static_cast<int64_t>(1e9 / std::max(messagesPerSecond, 1e-9));
+        const int64_t burst = interval * std::max<int64_t>(static_cast<int64_t>(messagesPerSecond)-1, 0);
+        const int64_t now = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+
+        // the bucket is stored as the time at which it will be full again
+        int64_t fullAt = m_fullAt.load(std::memory_order_relaxed);
+        do
+        {
+            if(fullAt - now > burst)
+            {
+                m_suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } while(!m_fullAt.compare_exchange_weak(fullAt, std::max(fullAt,now) + interval, std::memory_order_relaxed));
+
+        suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    std::atomic<int64_t> m_fullAt{0};
+    std::atomic<uint64_t> m_suppressed{0};
+};
+
+//-------------------------------------------------------------------
+/**
+ * struct LogSuppressed
+ * writes "[n suppressed] " to a stream, or nothing if no message was suppressed
+ */
+struct LogSuppressed
+{
+    uint64_t count;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const LogSuppressed& s)
+{
+    if(s.count > 0)
+        os << "[" << s.count << " suppressed] ";
+    return os;
+}
+
+}
+#endif //MPUTILS_LOGLIMITER_H
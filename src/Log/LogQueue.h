@@ -0,0 +1,150 @@
+/*
+ * mpUtils
+ * LogQueue.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the LogQueue class, a bounded lock free queue used to pass messages to the logger thread
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_LOGQUEUE_H
+#define MPUTILS_LOGQUEUE_H
+
+// includes
+//--------------------
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class LogQueue
+ *
+ * usage:
+ * A bounded lock free queue (see D. Vyukov, "bounded MPMC queue"). Every cell carries a sequence number which tells
+ * producers and consumers if the cell is ready for them, so a push or pop is one compare and swap on the position
+ * counter plus one store. Any number of threads can push() and pop() at the same time. The Log uses one consumer,
+ * producers only pop to discard the oldest message when the queue is full.
+ * The capacity is rounded up to the next power of two.
+ * push() and pop() return false if the queue is full / empty, they never block.
+ *
+ */
+template <typename T>
+class LogQueue
+{
+public:
+    explicit LogQueue(size_t capacity);
+
+    bool push(T value); //!< add a value, returns false if the queue is full
+    bool pop(T& value); //!< remove the oldest value, returns false if the queue is empty
+    bool empty() const; //!< check if the queue is empty, only a hint if other threads are using the queue
+    size_t capacity() const {return m_mask+1;} //!< the number of values that fit into the queue
+
+private:
+    struct alignas(64) Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t roundUp(size_t v); //!< next power of two
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    alignas(64) std::atomic<size_t> m_dequeuePos{0};
+};
+
+// template function definitions of the LogQueue class
+//-------------------------------------------------------------------
+template <typename T>
+LogQueue<T>::LogQueue(size_t capacity) : m_cells(new Cell[roundUp(std::max<size_t>(capacity,2))]), m_mask(roundUp(std::max<size_t>(capacity,2))-1)
+{
+    for(size_t i = 0; i <= m_mask; i++)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+bool LogQueue<T>::push(T value)
+{
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while(true)
+    {
+        cell = &m_cells[pos & m_mask];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if(diff == 0)
+        {
+            if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(diff < 0)
+            return false; // full
+        else
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+    }
+
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool LogQueue<T>::pop(T& value)
+{
+    size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while(true)
+    {
+        cell = &m_cells[pos & m_mask];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if(diff == 0)
+        {
+            if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(diff < 0)
+            return false; // empty
+        else
+            pos = m_dequeuePos.load(std::memory_order_relaxed);
+    }
+
+    value = std::move(cell->value);
+    cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool LogQueue<T>::empty() const
+{
+    const size_t pos = m_dequeuePos.load(std::memory_order_acquire);
+    return m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) != pos + 1;
+}
+
+template <typename T>
+size_t LogQueue<T>::roundUp(size_t v)
+{
+    size_t p = 1;
+    while(p < v)
+        p <<= 1;
+    return p;
+}
+
+}
+#endif //MPUTILS_LOGQUEUE_H
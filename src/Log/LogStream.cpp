@@ -15,6 +15,8 @@
 // includes
 //--------------------
 #include "LogStream.h"
+#include <vector>
+#include <memory>
 //--------------------
 
 // namespace
@@ -22,24 +24,82 @@
 namespace mpu {
 //--------------------
 
-// function definitions of the LogStream
-//-------------------------------------------------------------------
+namespace {
+    // a stream buffer that appends to the string of a LogMessage
+    class MessageBuffer : public std::streambuf
+    {
+    public:
+        void setTarget(std::string* t) {target = t;}
 
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if(!traits_type::eq_int_type(c, traits_type::eof()))
+                target->push_back(traits_type::to_char_type(c));
+            return traits_type::not_eof(c);
+        }
 
-LogStream::LogStream(LogStream&& other)  : logger(logger), lm(other.lm), std::ostringstream(std::move(other))
-{
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            target->append(s, static_cast<size_t>(n));
+            return n;
+        }
+
+    private:
+        std::string* target{nullptr};
+    };
+
+    struct ThreadStream
+    {
+        MessageBuffer buffer;
+        std::ostream stream{&buffer};
+    };
+
+    // one stream per nesting level, reused for all messages of a thread
+    struct ThreadStreams
+    {
+        std::vector<std::unique_ptr<ThreadStream>> streams;
+        size_t depth{0};
+    };
+
+    thread_local ThreadStreams threadStreams;
 
+    std::ostream* acquireStream(std::string* target)
+    {
+        if(threadStreams.depth == threadStreams.streams.size())
+            threadStreams.streams.push_back(std::make_unique<ThreadStream>());
+
+        ThreadStream& ts = *threadStreams.streams[threadStreams.depth++];
+        ts.buffer.setTarget(target);
+
+        // every message starts with the default format
+        ts.stream.clear();
+        ts.stream.flags(std::ios_base::skipws | std::ios_base::dec);
+        ts.stream.precision(6);
+        ts.stream.width(0);
+        ts.stream.fill(' ');
+        return &ts.stream;
+    }
 }
 
-LogStream::LogStream(Log &logger, LogMessage* lm) : logger(logger), lm(lm)
+// function definitions of the LogStream
+//-------------------------------------------------------------------
+LogStream::LogStream(LogStream&& other)  : lm(other.lm), logger(other.logger), stream(other.stream)
 {
+    other.lm = nullptr;
+    other.stream = nullptr;
+}
 
+LogStream::LogStream(Log &logger, LogMessage* lm) : lm(lm), logger(logger), stream(acquireStream(&lm->sMessage))
+{
 }
 
 LogStream::~LogStream()
 {
-    lm->sMessage = std::move(str());
+    if(!lm)
+        return;
+    threadStreams.depth--;
     logger.logMessage(lm);
 }
 
-}
\ No newline at end of file
+}
@@ -34,9 +34,12 @@ namespace mpu {
  * usage:
  * The constructor is usually called from the "Log" class. Then you can log using <<. After the ";" the Logstream is
  * destroyed. It writes its message to the log in its destructor.
+ * Text is written directly into the LogMessage using a thread local std::ostream, so no stream or string is created
+ * per message. Formatting flags are reset for every message. LogStreams can be nested (eg a function called
+ * while building a message logs something itself), every nesting level uses its own thread local stream.
  *
  */
-class LogStream : public std::ostringstream
+class LogStream
 {
 public:
 
@@ -45,9 +48,15 @@ public:
     LogStream(Log &logger, LogMessage* lm);
     ~LogStream();
 
+    template <typename T>
+    LogStream& operator<<(T&& value) {*stream << std::forward<T>(value); return *this;} // append anything that can be written to a std::ostream
+    LogStream& operator<<(std::ostream& (*manipulator)(std::ostream&)) {manipulator(*stream); return *this;} // for manipulators like std::endl
+    LogStream& operator<<(std::ios_base& (*manipulator)(std::ios_base&)) {manipulator(*stream); return *this;} // for manipulators like std::hex
+
 private:
     LogMessage* lm;
     Log &logger;
+    std::ostream* stream; // thread local stream writing into lm
 };
 
 }
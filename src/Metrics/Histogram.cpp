@@ -0,0 +1,103 @@
+/*
+ * mpUtils
+ * Histogram.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the Histogram class, a lock free histogram with logarithmic buckets in the style of HdrHistogram
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "Histogram.h"
+#include <algorithm>
+#include <cmath>
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+// function definitions of the Histogram class
+//-------------------------------------------------------------------
+Histogram::Histogram(double scale) : m_buckets(new std::atomic<uint64_t>[numBuckets]), m_scale(scale)
+{
+    for(int i = 0; i < numBuckets; i++)
+        m_buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void Histogram::record(uint64_t value)
+{
+    m_buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current = m_min.load(std::memory_order_relaxed);
+    while(value < current && !m_min.compare_exchange_weak(current, value, std::memory_order_relaxed));
+    current = m_max.load(std::memory_order_relaxed);
+    while(value > current && !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+double Histogram::min() const
+{
+    const uint64_t v = m_min.load(std::memory_order_relaxed);
+    return (v == UINT64_MAX) ? 0.0 : double(v) * m_scale;
+}
+
+double Histogram::mean() const
+{
+    const uint64_t c = count();
+    return (c == 0) ? 0.0 : sum() / double(c);
+}
+
+double Histogram::quantile(double q) const
+{
+    // other threads might record while we count, so the total is taken from the buckets themselves
+    uint64_t total = 0;
+    for(int i = 0; i < numBuckets; i++)
+        total += m_buckets[i].load(std::memory_order_relaxed);
+    if(total == 0)
+        return 0.0;
+
+    const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(q,0.0,1.0) * double(total))));
+    uint64_t seen = 0;
+    for(int i = 0; i < numBuckets; i++)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if(seen >= target)
+        {
+            // the middle of the bucket might be outside of the range of recorded values
+            const uint64_t v = std::clamp(bucketValue(i), m_min.load(std::memory_order_relaxed), m_max.load(std::memory_order_relaxed));
+            return double(v) * m_scale;
+        }
+    }
+    return max();
+}
+
+int Histogram::bucketIndex(uint64_t value)
+{
+    // values below 2*subBucketCount are counted exactly,
+    // above that every power of two is split into subBucketCount buckets
+    if(value < 2*subBucketCount)
+        return static_cast<int>(value);
+
+    const int shift = (63 - __builtin_clzll(value)) - subBucketBits;
+    return static_cast<int>((shift+1) * subBucketCount + ((value >> shift) - subBucketCount));
+}
+
+uint64_t Histogram::bucketValue(int index)
+{
+    if(index < static_cast<int>(2*subBucketCount))
+        return static_cast<uint64_t>(index);
+
+    const int shift = index / static_cast<int>(subBucketCount) - 1;
+    const uint64_t lower = (subBucketCount + index % subBucketCount) << shift;
+    return lower + ((uint64_t(1) << shift) >> 1);
+}
+
+}
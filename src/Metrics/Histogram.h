@@ -0,0 +1,85 @@
+/*
+ * mpUtils
+ * Histogram.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the Histogram class, a lock free histogram with logarithmic buckets in the style of HdrHistogram
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_HISTOGRAM_H
+#define MPUTILS_HISTOGRAM_H
+
+// includes
+//--------------------
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class Histogram
+ *
+ * usage:
+ * Records the distribution of integer values, eg durations in nanoseconds, and answers quantile queries.
+ * Every power of two is split into 128 linear sub buckets, so every value is stored with a relative error
+ * below 1% while the whole 64 bit range is covered. Recording is lock free and can be done from any thread.
+ *
+ * All queries return values multiplied by scale, eg create the histogram with a scale of 1e-9 and use
+ * recordDuration() to record durations in nanoseconds and query them in seconds.
+ *
+ */
+class Histogram
+{
+public:
+    explicit Histogram(double scale = 1.0); //!< values returned by queries are multiplied by scale
+
+    void record(uint64_t value); //!< add one value
+    template <typename rep, typename period>
+    void recordDuration(std::chrono::duration<rep,period> d); //!< add a duration in nanoseconds
+
+    uint64_t count() const {return m_count.load(std::memory_order_relaxed);} //!< number of recorded values
+    double sum() const {return double(m_sum.load(std::memory_order_relaxed)) * m_scale;} //!< sum of all values
+    double min() const; //!< smallest value, 0 if empty
+    double max() const {return double(m_max.load(std::memory_order_relaxed)) * m_scale;} //!< largest value
+    double mean() const; //!< average value, 0 if empty
+    double quantile(double q) const; //!< value below which a fraction of q of all values lie, 0 if empty
+
+private:
+    static constexpr int subBucketBits = 7; //!< 128 sub buckets per power of two
+    static constexpr uint64_t subBucketCount = uint64_t(1) << subBucketBits;
+    static constexpr int numBuckets = (64 - subBucketBits + 1) * subBucketCount;
+
+    static int bucketIndex(uint64_t value); //!< bucket a value is counted in
+    static uint64_t bucketValue(int index); //!< value in the middle of a bucket
+
+    std::unique_ptr<std::atomic<uint64_t>[]> m_buckets;
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_min{UINT64_MAX};
+    std::atomic<uint64_t> m_max{0};
+    double m_scale;
+};
+
+// template function definitions of the Histogram class
+//-------------------------------------------------------------------
+template <typename rep, typename period>
+void Histogram::recordDuration(std::chrono::duration<rep, period> d)
+{
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    record( ns > 0 ? static_cast<uint64_t>(ns) : 0);
+}
+
+}
+#endif //MPUTILS_HISTOGRAM_H
@@ -0,0 +1,73 @@
+/*
+ * mpUtils
+ * Metric.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the Counter and Gauge classes, lock free metrics that can be updated from any thread
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_METRIC_H
+#define MPUTILS_METRIC_H
+
+// includes
+//--------------------
+#include <atomic>
+#include <cstdint>
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class Counter
+ *
+ * usage:
+ * A value that only ever increases, like the number of simulation steps. Get one from the MetricsRegistry
+ * and call inc() or add() from any thread.
+ *
+ */
+class Counter
+{
+public:
+    void inc() {m_value.fetch_add(1, std::memory_order_relaxed);} //!< add one
+    void add(uint64_t n) {m_value.fetch_add(n, std::memory_order_relaxed);} //!< add n
+    uint64_t value() const {return m_value.load(std::memory_order_relaxed);} //!< the current value
+
+private:
+    std::atomic<uint64_t> m_value{0};
+};
+
+//-------------------------------------------------------------------
+/**
+ * class Gauge
+ *
+ * usage:
+ * A value that can go up and down, like the current timestep or memory usage. Get one from the MetricsRegistry
+ * and call set() or add() from any thread.
+ *
+ */
+class Gauge
+{
+public:
+    void set(double v) {m_value.store(v, std::memory_order_relaxed);} //!< set the value to v
+    void add(double v) //!< add v to the current value (v can be negative)
+    {
+        double current = m_value.load(std::memory_order_relaxed);
+        while(!m_value.compare_exchange_weak(current, current + v, std::memory_order_relaxed));
+    }
+    double value() const {return m_value.load(std::memory_order_relaxed);} //!< the current value
+
+private:
+    std::atomic<double> m_value{0};
+};
+
+}
+#endif //MPUTILS_METRIC_H
@@ -0,0 +1,94 @@
+/*
+ * mpUtils
+ * MetricsExporter.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the MetricsExporter class, which periodically writes all metrics of a registry to files
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "MetricsExporter.h"
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include "../Log/Log.h"
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+// function definitions of the MetricsExporter class
+//-------------------------------------------------------------------
+MetricsExporter::MetricsExporter(MetricsRegistry& registry, std::string prometheusFile, std::string jsonFile,
+                                 std::chrono::milliseconds interval, bool collectProcessMetrics)
+    : m_registry(registry), m_prometheusFile(std::move(prometheusFile)), m_jsonFile(std::move(jsonFile)),
+      m_collectProcessMetrics(collectProcessMetrics),
+      m_timer(interval, true, [this](){exportNow();})
+{
+    // writing files might take a while, so the export should not block the dispatch thread
+    m_timer.setRunOnWorker(true);
+    m_timer.start();
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    m_timer.stop(); // waits for a running export
+    exportNow();
+}
+
+void MetricsExporter::exportNow()
+{
+    std::lock_guard<std::mutex> lck(m_exportMtx);
+
+    if(m_collectProcessMetrics)
+        updateProcessMetrics();
+
+    if(!m_prometheusFile.empty())
+    {
+        // write to a temporary file and rename it, so readers never see a partial file
+        const std::string tmpFile = m_prometheusFile + ".tmp";
+        std::ofstream file(tmpFile, std::ofstream::out | std::ofstream::trunc);
+        file << m_registry.prometheusText();
+        file.close();
+        if(!file || std::rename(tmpFile.c_str(), m_prometheusFile.c_str()) != 0)
+        {
+            logWARNING("Metrics") << "Could not write metrics to " << m_prometheusFile;
+        }
+    }
+
+    if(!m_jsonFile.empty())
+    {
+        std::ofstream file(m_jsonFile, std::ofstream::out | std::ofstream::app);
+        file << m_registry.jsonLine() << "\n";
+        if(!file)
+        {
+            logWARNING("Metrics") << "Could not write metrics to " << m_jsonFile;
+        }
+    }
+}
+
+void MetricsExporter::updateProcessMetrics()
+{
+#ifdef __linux__
+    // statm contains the virtual and resident size in pages
+    std::ifstream statm("/proc/self/statm");
+    double virtualPages = 0;
+    double residentPages = 0;
+    if(statm >> virtualPages >> residentPages)
+    {
+        const double pageSize = sysconf(_SC_PAGESIZE);
+        m_registry.gauge("process_virtual_memory_bytes", "Virtual memory size in bytes.").set(virtualPages * pageSize);
+        m_registry.gauge("process_resident_memory_bytes", "Resident memory size in bytes.").set(residentPages * pageSize);
+    }
+#endif
+}
+
+}
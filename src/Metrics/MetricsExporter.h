@@ -0,0 +1,71 @@
+/*
+ * mpUtils
+ * MetricsExporter.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the MetricsExporter class, which periodically writes all metrics of a registry to files
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_METRICSEXPORTER_H
+#define MPUTILS_METRICSEXPORTER_H
+
+// includes
+//--------------------
+#include <chrono>
+#include <mutex>
+#include <string>
+#include "MetricsRegistry.h"
+#include "../Timer/AsyncTimer.h"
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class MetricsExporter
+ *
+ * usage:
+ * Writes all metrics of a registry every interval, and once more when it is destroyed. The export is scheduled with
+ * an AsyncTimer and runs on the worker threads of the global TimerService, so no thread is started for it.
+ * The prometheus file is replaced atomically, so it can be scraped at any time (eg by the node exporter textfile
+ * collector). One line of json is appended to the json file on every export. Pass an empty filename to disable
+ * one of the outputs.
+ *
+ * If collectProcessMetrics is set, the resident and virtual memory of the process are added to the registry
+ * as process_resident_memory_bytes and process_virtual_memory_bytes before every export.
+ *
+ */
+class MetricsExporter
+{
+public:
+    MetricsExporter(MetricsRegistry& registry, std::string prometheusFile, std::string jsonFile,
+                    std::chrono::milliseconds interval, bool collectProcessMetrics = true);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter& other) = delete;
+    MetricsExporter& operator=(const MetricsExporter& other) = delete;
+
+    void exportNow(); //!< write all metrics right away
+
+private:
+    void updateProcessMetrics(); //!< reads memory usage of the process
+
+    MetricsRegistry& m_registry;
+    const std::string m_prometheusFile;
+    const std::string m_jsonFile;
+    const bool m_collectProcessMetrics;
+
+    std::mutex m_exportMtx; //!< only one export at a time
+    SimpleAsyncTimer m_timer; //!< calls exportNow() every interval
+};
+
+}
+#endif //MPUTILS_METRICSEXPORTER_H
@@ -0,0 +1,262 @@
+/*
+ * mpUtils
+ * MetricsRegistry.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the MetricsRegistry class, which owns named metrics and formats them for export
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "MetricsRegistry.h"
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include "../Log/Log.h"
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+namespace {
+    constexpr double exportedQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+    const char* const exportedQuantileNames[] = {"0.5", "0.9", "0.99", "0.999"};
+
+    bool isValidName(const std::string& name)
+    {
+        if(name.empty() || std::isdigit(static_cast<unsigned char>(name[0])))
+            return false;
+        for(char c : name)
+            if(!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != ':')
+                return false;
+        return true;
+    }
+
+    // label values are escaped as required by the prometheus format
+    std::string formatLabels(const MetricsRegistry::Labels& labels)
+    {
+        if(labels.empty())
+            return "";
+
+        std::string s = "{";
+        for(const auto& label : labels)
+        {
+            if(s.size() > 1)
+                s += ',';
+            s += label.first + "=\"";
+            for(char c : label.second)
+            {
+                if(c == '\\' || c == '"')
+                    s += '\\';
+                if(c == '\n')
+                    s += "\\n";
+                else
+                    s += c;
+            }
+            s += '"';
+        }
+        return s + "}";
+    }
+
+    // adds one more label to a formatted label set
+    std::string addLabel(const std::string& labels, const std::string& label)
+    {
+        if(labels.empty())
+            return "{" + label + "}";
+        return labels.substr(0, labels.size()-1) + "," + label + "}";
+    }
+
+    void writeNumber(std::ostream& os, double v)
+    {
+        if(std::isnan(v))
+            os << "NaN";
+        else if(std::isinf(v))
+            os << (v > 0 ? "+Inf" : "-Inf");
+        else
+            os << v;
+    }
+
+    void writeJsonNumber(std::ostream& os, double v)
+    {
+        if(std::isfinite(v))
+            os << v;
+        else
+            os << "null";
+    }
+
+    void writeJsonString(std::ostream& os, const std::string& s)
+    {
+        os << '"';
+        for(char c : s)
+        {
+            if(c == '"' || c == '\\')
+                os << '\\' << c;
+            else if(c == '\n')
+                os << "\\n";
+            else
+                os << c;
+        }
+        os << '"';
+    }
+}
+
+// function definitions of the MetricsRegistry class
+//-------------------------------------------------------------------
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const Labels& labels)
+{
+    std::lock_guard<std::mutex> lck(m_mtx);
+    auto& metric = family(name, help, MetricType::COUNTER).counters[formatLabels(labels)];
+    if(!metric)
+        metric = std::make_unique<Counter>();
+    return *metric;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const Labels& labels)
+{
+    std::lock_guard<std::mutex> lck(m_mtx);
+    auto& metric = family(name, help, MetricType::GAUGE).gauges[formatLabels(labels)];
+    if(!metric)
+        metric = std::make_unique<Gauge>();
+    return *metric;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const Labels& labels, double scale)
+{
+    std::lock_guard<std::mutex> lck(m_mtx);
+    auto& metric = family(name, help, MetricType::HISTOGRAM).histograms[formatLabels(labels)];
+    if(!metric)
+        metric = std::make_unique<Histogram>(scale);
+    return *metric;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, const std::string& help, MetricType type)
+{
+    if(!isValidName(name))
+    {
+        logERROR("Metrics") << "\"" << name << "\" is not a valid metric name.";
+        throw std::runtime_error("Invalid metric name " + name);
+    }
+
+    auto it = m_families.find(name);
+    if(it == m_families.end())
+    {
+        it = m_families.emplace(name, Family()).first;
+        it->second.help = help;
+        it->second.type = type;
+    }
+    else if(it->second.type != type)
+    {
+        logERROR("Metrics") << "Metric \"" << name << "\" was already registered with a different type.";
+        throw std::runtime_error("Metric type mismatch for " + name);
+    }
+    return it->second;
+}
+
+std::string MetricsRegistry::prometheusText() const
+{
+    std::ostringstream os;
+    os << std::setprecision(12);
+
+    std::lock_guard<std::mutex> lck(m_mtx);
+    for(const auto& [name, f] : m_families)
+    {
+        os << "# HELP " << name << " " << f.help << "\n";
+        switch(f.type)
+        {
+            case MetricType::COUNTER:
+                os << "# TYPE " << name << " counter\n";
+                for(const auto& [labels, c] : f.counters)
+                    os << name << labels << " " << c->value() << "\n";
+                break;
+            case MetricType::GAUGE:
+                os << "# TYPE " << name << " gauge\n";
+                for(const auto& [labels, g] : f.gauges)
+                {
+                    os << name << labels << " ";
+                    writeNumber(os, g->value());
+                    os << "\n";
+                }
+                break;
+            case MetricType::HISTOGRAM:
+                os << "# TYPE " << name << " summary\n";
+                for(const auto& [labels, h] : f.histograms)
+                {
+                    for(int i = 0; i < 4; i++)
+                    {
+                        os << name << addLabel(labels, std::string("quantile=\"") + exportedQuantileNames[i] + "\"") << " ";
+                        writeNumber(os, h->quantile(exportedQuantiles[i]));
+                        os << "\n";
+                    }
+                    os << name << "_sum" << labels << " ";
+                    writeNumber(os, h->sum());
+                    os << "\n" << name << "_count" << labels << " " << h->count() << "\n";
+                }
+                break;
+        }
+    }
+    return os.str();
+}
+
+std::string MetricsRegistry::jsonLine() const
+{
+    std::ostringstream os;
+    os << std::setprecision(12);
+
+    const double timestamp = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    os << "{\"timestamp\":" << std::fixed << std::setprecision(3) << timestamp << std::defaultfloat << std::setprecision(12)
+       << ",\"metrics\":{";
+
+    bool first = true;
+    auto key = [&](const std::string& name, const std::string& labels)
+    {
+        if(!first)
+            os << ",";
+        first = false;
+        writeJsonString(os, name + labels);
+        os << ":";
+    };
+
+    std::lock_guard<std::mutex> lck(m_mtx);
+    for(const auto& [name, f] : m_families)
+    {
+        for(const auto& [labels, c] : f.counters)
+        {
+            key(name, labels);
+            os << c->value();
+        }
+        for(const auto& [labels, g] : f.gauges)
+        {
+            key(name, labels);
+            writeJsonNumber(os, g->value());
+        }
+        for(const auto& [labels, h] : f.histograms)
+        {
+            key(name, labels);
+            os << "{\"count\":" << h->count() << ",\"sum\":";
+            writeJsonNumber(os, h->sum());
+            os << ",\"min\":";
+            writeJsonNumber(os, h->min());
+            os << ",\"max\":";
+            writeJsonNumber(os, h->max());
+            for(int i = 0; i < 4; i++)
+            {
+                os << ",\"p" << exportedQuantileNames[i] << "\":";
+                writeJsonNumber(os, h->quantile(exportedQuantiles[i]));
+            }
+            os << "}";
+        }
+    }
+    os << "}}";
+    return os.str();
+}
+
+}
@@ -0,0 +1,87 @@
+/*
+ * mpUtils
+ * MetricsRegistry.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the MetricsRegistry class, which owns named metrics and formats them for export
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_METRICSREGISTRY_H
+#define MPUTILS_METRICSREGISTRY_H
+
+// includes
+//--------------------
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Metric.h"
+#include "Histogram.h"
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class MetricsRegistry
+ *
+ * usage:
+ * Create metrics using counter(), gauge() and histogram(). Metrics are identified by their name and labels, asking
+ * for the same name and labels twice returns the same metric. References stay valid as long as the registry exists,
+ * so get them once and then update them from the hot path without any lookup.
+ * Names need to be valid prometheus metric names and the same name can not be used for different types of metrics.
+ *
+ * prometheusText() and jsonLine() format all metrics for export, see MetricsExporter to write them to files
+ * periodically. Histograms are exported as prometheus summaries with the quantiles 0.5, 0.9, 0.99 and 0.999.
+ *
+ * thread safety:
+ * All functions can be called from any thread.
+ *
+ */
+class MetricsRegistry
+{
+public:
+    using Labels = std::vector<std::pair<std::string,std::string>>; //!< list of label names and values
+
+    Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {}); //!< get or create a counter
+    Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels = {}); //!< get or create a gauge
+    Histogram& histogram(const std::string& name, const std::string& help, const Labels& labels = {}, double scale = 1.0); //!< get or create a histogram, see Histogram for scale
+
+    std::string prometheusText() const; //!< all metrics in the prometheus text exposition format
+    std::string jsonLine() const; //!< all metrics as one line of json, including a timestamp
+
+private:
+    enum class MetricType
+    {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    struct Family //!< all metrics with the same name
+    {
+        std::string help;
+        MetricType type;
+        std::map<std::string, std::unique_ptr<Counter>> counters; //!< keyed by the formatted label set
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    };
+
+    Family& family(const std::string& name, const std::string& help, MetricType type); //!< mtx needs to be locked
+
+    mutable std::mutex m_mtx;
+    std::map<std::string, Family> m_families;
+};
+
+}
+#endif //MPUTILS_METRICSREGISTRY_H
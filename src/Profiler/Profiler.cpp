@@ -0,0 +1,337 @@
+/*
+ * mpUtils
+ * Profiler.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the Profiler class and profiling zones, which measure where time is spent in the program
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "Profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include "../mpUtils.h"
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+namespace {
+    struct ProfilerData
+    {
+        const Profiler::clock_type::time_point epoch{Profiler::clock_type::now()};
+        std::atomic<int64_t> clearedBefore{std::numeric_limits<int64_t>::min()}; // zones that ended before this are ignored
+        std::atomic<int> nextThreadNumber{0};
+        std::mutex mtx; // protects tracks
+        std::vector<std::shared_ptr<ProfileTrack>> tracks;
+    };
+
+    ProfilerData& profilerData()
+    {
+        static ProfilerData data;
+        return data;
+    }
+
+    // the epoch is set as early as possible, so all times are positive
+    [[maybe_unused]] const bool profilerInitialized = (profilerData(), true);
+
+    thread_local std::shared_ptr<ProfileTrack> t_track;
+    thread_local uint32_t t_depth = 0;
+
+    // node of the call tree while it is created, children are referenced by index so the storage can grow
+    struct TreeBuilderNode
+    {
+        std::string name;
+        uint64_t calls{0};
+        int64_t inclusive{0};
+        int64_t childTime{0};
+        std::map<std::string, std::size_t> children;
+    };
+
+    ProfileNode convertNode(const std::vector<TreeBuilderNode>& nodes, std::size_t index)
+    {
+        const TreeBuilderNode& n = nodes[index];
+        ProfileNode result;
+        result.name = n.name;
+        result.calls = n.calls;
+        result.inclusive = double(n.inclusive) * 1.0e-9;
+        result.exclusive = double(std::max<int64_t>(n.inclusive - n.childTime, 0)) * 1.0e-9;
+        for(const auto& child : n.children)
+            result.children.push_back(convertNode(nodes, child.second));
+
+        std::sort(result.children.begin(), result.children.end(),
+                  [](const ProfileNode& a, const ProfileNode& b){return a.inclusive > b.inclusive;});
+        return result;
+    }
+
+    void printNode(std::ostream& os, const ProfileNode& node, int indent, double total)
+    {
+        os << std::string(2*indent, ' ') << std::left << std::setw(std::max(40-2*indent, 1)) << node.name << std::right
+           << std::setw(12) << node.inclusive*1000.0 << " ms"
+           << std::setw(12) << node.exclusive*1000.0 << " ms excl"
+           << std::setw(10) << node.calls << " calls"
+           << std::setw(8) << ((total > 0) ? 100.0*node.inclusive/total : 0.0) << " %\n";
+        for(const auto& child : node.children)
+            printNode(os, child, indent+1, total);
+    }
+
+    void writeJsonString(std::ostream& os, const std::string& s)
+    {
+        os << '"';
+        for(char c : s)
+        {
+            if(c == '"' || c == '\\')
+                os << '\\' << c;
+            else if(c == '\n')
+                os << "\\n";
+            else
+                os << c;
+        }
+        os << '"';
+    }
+}
+
+// function definitions of the ProfileTrack class
+//-------------------------------------------------------------------
+ProfileTrack::ProfileTrack(std::string name, std::size_t capacity)
+    : m_slots(new Slot[std::max<std::size_t>(capacity,1)]), m_capacity(std::max<std::size_t>(capacity,1)), m_name(std::move(name))
+{
+}
+
+void ProfileTrack::record(const ProfileEvent& event)
+{
+    const uint64_t index = m_written.load(std::memory_order_relaxed);
+    Slot& slot = m_slots[index % m_capacity];
+    slot.name.store(event.name, std::memory_order_relaxed);
+    slot.start.store(event.start, std::memory_order_relaxed);
+    slot.end.store(event.end, std::memory_order_relaxed);
+    slot.depth.store(event.depth, std::memory_order_relaxed);
+    m_written.store(index+1, std::memory_order_release);
+}
+
+std::vector<ProfileEvent> ProfileTrack::events() const
+{
+    const uint64_t written = m_written.load(std::memory_order_acquire);
+    const uint64_t first = (written > m_capacity) ? written - m_capacity : 0;
+
+    std::vector<ProfileEvent> result;
+    result.reserve(written - first);
+    for(uint64_t i = first; i < written; i++)
+    {
+        const Slot& slot = m_slots[i % m_capacity];
+        result.push_back({slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                          slot.end.load(std::memory_order_relaxed), slot.depth.load(std::memory_order_relaxed)});
+    }
+
+    // events that were overwritten while we copied them are dropped, including the slot that might be written right now
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t writtenAfter = m_written.load(std::memory_order_relaxed);
+    const uint64_t firstValid = (writtenAfter + 1 > m_capacity) ? writtenAfter + 1 - m_capacity : 0;
+    if(firstValid > first)
+        result.erase(result.begin(), result.begin() + std::min<uint64_t>(firstValid - first, result.size()));
+
+    return result;
+}
+
+void ProfileTrack::setName(std::string name)
+{
+    std::lock_guard<std::mutex> lck(m_nameMtx);
+    m_name = std::move(name);
+}
+
+std::string ProfileTrack::name() const
+{
+    std::lock_guard<std::mutex> lck(m_nameMtx);
+    return m_name;
+}
+
+// function definitions of the Profiler class
+//-------------------------------------------------------------------
+std::atomic<bool> Profiler::s_enabled{false};
+
+void Profiler::setEnabled(bool enable)
+{
+    s_enabled.store(enable, std::memory_order_relaxed);
+}
+
+int64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - profilerData().epoch).count();
+}
+
+void Profiler::setThreadName(std::string name)
+{
+    threadTrack().setName(std::move(name));
+}
+
+std::shared_ptr<ProfileTrack> Profiler::createTrack(std::string name)
+{
+    auto track = std::make_shared<ProfileTrack>(std::move(name), MPU_PROFILE_TRACK_CAPACITY);
+    ProfilerData& data = profilerData();
+    std::lock_guard<std::mutex> lck(data.mtx);
+    data.tracks.push_back(track);
+    return track;
+}
+
+void Profiler::clear()
+{
+    ProfilerData& data = profilerData();
+    data.clearedBefore.store(now(), std::memory_order_relaxed);
+
+    // only the list holds tracks of threads that ended
+    std::lock_guard<std::mutex> lck(data.mtx);
+    data.tracks.erase(std::remove_if(data.tracks.begin(), data.tracks.end(),
+                                     [](const std::shared_ptr<ProfileTrack>& t){return t.use_count() == 1;}),
+                      data.tracks.end());
+}
+
+std::vector<ProfileNode> Profiler::aggregate(int64_t from, int64_t to)
+{
+    from = std::max(from, profilerData().clearedBefore.load(std::memory_order_relaxed));
+
+    std::vector<ProfileNode> result;
+    for(const auto& track : tracks())
+    {
+        std::vector<ProfileEvent> events = track->events();
+
+        // clip to the time window
+        events.erase(std::remove_if(events.begin(), events.end(),
+                                    [from,to](const ProfileEvent& e){return e.end <= from || e.start >= to;}),
+                     events.end());
+        for(auto& e : events)
+        {
+            e.start = std::max(e.start, from);
+            e.end = std::min(e.end, to);
+        }
+
+        // zones are recorded when they end, sorting by start time puts parents in front of their children
+        std::sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b)
+        {
+            return (a.start != b.start) ? a.start < b.start : a.depth < b.depth;
+        });
+
+        std::vector<TreeBuilderNode> nodes(1);
+        nodes[0].name = track->name();
+
+        struct OpenZone {int64_t end; uint32_t depth; std::size_t node;};
+        std::vector<OpenZone> stack;
+        for(const auto& e : events)
+        {
+            while(!stack.empty() && (stack.back().depth >= e.depth || stack.back().end <= e.start))
+                stack.pop_back();
+
+            // if the parent was already overwritten in the ring buffer the zone is added at the top level
+            const std::size_t parent = stack.empty() ? 0 : stack.back().node;
+            auto it = nodes[parent].children.find(e.name);
+            std::size_t node;
+            if(it == nodes[parent].children.end())
+            {
+                node = nodes.size();
+                nodes[parent].children.emplace(e.name, node);
+                nodes.emplace_back();
+                nodes[node].name = e.name;
+            }
+            else
+                node = it->second;
+
+            const int64_t duration = e.end - e.start;
+            nodes[node].calls++;
+            nodes[node].inclusive += duration;
+            nodes[parent].childTime += duration;
+            stack.push_back({e.end, e.depth, node});
+        }
+
+        nodes[0].inclusive = nodes[0].childTime;
+        result.push_back(convertNode(nodes, 0));
+    }
+    return result;
+}
+
+std::string Profiler::report(int64_t from, int64_t to)
+{
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    for(const auto& tree : aggregate(from, to))
+    {
+        os << tree.name << ":\n";
+        for(const auto& node : tree.children)
+            printNode(os, node, 1, tree.inclusive);
+    }
+    return os.str();
+}
+
+bool Profiler::writeChromeTrace(const std::string& filename)
+{
+    std::ofstream file(filename, std::ofstream::out | std::ofstream::trunc);
+    if(!file.is_open())
+        return false;
+
+    const int64_t clearedBefore = profilerData().clearedBefore.load(std::memory_order_relaxed);
+
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    const auto allTracks = tracks();
+    for(std::size_t tid = 0; tid < allTracks.size(); tid++)
+    {
+        if(!first)
+            file << ",";
+        first = false;
+        file << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+        writeJsonString(file, allTracks[tid]->name());
+        file << "}}";
+
+        for(const auto& e : allTracks[tid]->events())
+        {
+            if(e.end <= clearedBefore)
+                continue;
+            file << ",\n{\"name\":";
+            writeJsonString(file, e.name);
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                 << ",\"ts\":" << double(e.start) * 1.0e-3 << ",\"dur\":" << double(e.end - e.start) * 1.0e-3 << "}";
+        }
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+uint32_t Profiler::enterZone()
+{
+    return t_depth++;
+}
+
+void Profiler::leaveZone(const char* name, int64_t start, uint32_t depth)
+{
+    const int64_t end = now();
+    t_depth = depth;
+    threadTrack().record({name, start, end, depth});
+}
+
+ProfileTrack& Profiler::threadTrack()
+{
+    if(!t_track)
+    {
+        ProfilerData& data = profilerData();
+        t_track = createTrack("Thread " + toString(data.nextThreadNumber++));
+    }
+    return *t_track;
+}
+
+std::vector<std::shared_ptr<ProfileTrack>> Profiler::tracks()
+{
+    ProfilerData& data = profilerData();
+    std::lock_guard<std::mutex> lck(data.mtx);
+    return data.tracks;
+}
+
+}
@@ -0,0 +1,202 @@
+/*
+ * mpUtils
+ * Profiler.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the Profiler class and profiling zones, which measure where time is spent in the program
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_PROFILER_H
+#define MPUTILS_PROFILER_H
+
+// includes
+//--------------------
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../Timer/Stopwatch.h"
+//--------------------
+
+// defines
+//--------------------
+
+// number of zones each thread keeps, older zones are overwritten, define before including to change it
+#ifndef MPU_PROFILE_TRACK_CAPACITY
+    #define MPU_PROFILE_TRACK_CAPACITY 65536
+#endif
+
+// measure the time until the end of the current scope, NAME needs to be a string literal
+#ifdef MPU_NO_PROFILING
+    #define PROFILE_SCOPE(NAME)
+#else
+    #define PROFILE_SCOPE(NAME) mpu::ProfileZone _MPU_PROFILE_CONCAT(_mpu_profile_zone_,__LINE__)(NAME)
+#endif
+#define _MPU_PROFILE_CONCAT(a,b) _MPU_PROFILE_CONCAT2(a,b)
+#define _MPU_PROFILE_CONCAT2(a,b) a##b
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * struct ProfileEvent
+ * one measured zone, times are in nanoseconds since the profiler was started
+ */
+struct ProfileEvent
+{
+    const char* name; //!< name of the zone, a string with static storage duration
+    int64_t start;
+    int64_t end;
+    uint32_t depth; //!< number of zones this zone is nested in
+};
+
+//-------------------------------------------------------------------
+/**
+ * class ProfileTrack
+ *
+ * usage:
+ * A ring buffer of profile events that belong to one timeline, eg one thread or one gpu context.
+ * Only one thread may record() into a track, but events() can be called from any thread at any time.
+ * Tracks for threads are created automatically, use Profiler::createTrack() for other timelines.
+ *
+ */
+class ProfileTrack
+{
+public:
+    ProfileTrack(std::string name, std::size_t capacity);
+
+    void record(const ProfileEvent& event); //!< add an event, overwriting the oldest one if the track is full
+    std::vector<ProfileEvent> events() const; //!< copy of all events currently stored
+
+    void setName(std::string name); //!< change the name shown for this track
+    std::string name() const; //!< the name shown for this track
+
+private:
+    struct Slot //!< relaxed atomics, so events can be read while they are overwritten
+    {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<int64_t> start{0};
+        std::atomic<int64_t> end{0};
+        std::atomic<uint32_t> depth{0};
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    const std::size_t m_capacity;
+    std::atomic<uint64_t> m_written{0}; //!< number of events recorded so far
+
+    mutable std::mutex m_nameMtx;
+    std::string m_name;
+};
+
+//-------------------------------------------------------------------
+/**
+ * struct ProfileNode
+ * a node in the call tree created by Profiler::aggregate(), times are in seconds
+ */
+struct ProfileNode
+{
+    std::string name;
+    uint64_t calls{0}; //!< number of times the zone was entered
+    double inclusive{0}; //!< total time spent in the zone
+    double exclusive{0}; //!< time spent in the zone, but not in any zone nested inside
+    std::vector<ProfileNode> children;
+};
+
+//-------------------------------------------------------------------
+/**
+ * class Profiler
+ *
+ * usage:
+ * Put PROFILE_SCOPE("name") at the beginning of a scope to measure the time until the end of the scope.
+ * Zones are only recorded while the profiler is enabled, use Profiler::setEnabled(). While it is disabled a zone
+ * costs one relaxed atomic load. Define MPU_NO_PROFILING to remove all zones at compile time.
+ *
+ * Every thread records its zones into its own ProfileTrack, so recording does not need any locks. Name the track
+ * of a thread with setThreadName(). The last MPU_PROFILE_TRACK_CAPACITY zones of each track are kept.
+ *
+ * aggregate() merges all zones into one call tree per track, with inclusive and exclusive times. report()
+ * formats the trees as text. writeChromeTrace() writes all zones in the trace event format, which can be
+ * viewed with chrome://tracing or https://ui.perfetto.dev. Gpu times can be added to the same timeline
+ * using the GpuProfiler.
+ *
+ * Times are measured with the clock of the SimpleStopwatch (steady_clock), relative to the start of the program.
+ *
+ */
+class Profiler
+{
+public:
+    using clock_type = SimpleStopwatch::clock_type;
+
+    static void setEnabled(bool enable); //!< start or stop recording zones
+    static bool isEnabled() {return s_enabled.load(std::memory_order_relaxed);} //!< true if zones are recorded
+    static int64_t now(); //!< current time in nanoseconds since the profiler was started
+
+    static void setThreadName(std::string name); //!< name of the track of the calling thread
+    static std::shared_ptr<ProfileTrack> createTrack(std::string name); //!< create a track for a timeline that is not a cpu thread
+    static void clear(); //!< remove the tracks of all threads that ended and forget all recorded zones
+
+    static std::vector<ProfileNode> aggregate(int64_t from = std::numeric_limits<int64_t>::min(),
+                                              int64_t to = std::numeric_limits<int64_t>::max()); //!< one call tree per track, zones are clipped to [from,to]
+    static std::string report(int64_t from = std::numeric_limits<int64_t>::min(),
+                              int64_t to = std::numeric_limits<int64_t>::max()); //!< call trees formatted as text
+    static bool writeChromeTrace(const std::string& filename); //!< write all zones in the chrome trace event format
+
+    // used by ProfileZone
+    static uint32_t enterZone(); //!< returns the depth of the new zone
+    static void leaveZone(const char* name, int64_t start, uint32_t depth);
+
+private:
+    static ProfileTrack& threadTrack(); //!< the track of the calling thread, created on first use
+    static std::vector<std::shared_ptr<ProfileTrack>> tracks(); //!< copy of the list of all tracks
+
+    static std::atomic<bool> s_enabled;
+};
+
+//-------------------------------------------------------------------
+/**
+ * class ProfileZone
+ * measures the time from its construction to its destruction, use via the PROFILE_SCOPE macro
+ */
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* name)
+    {
+        if(Profiler::isEnabled())
+        {
+            m_name = name;
+            m_depth = Profiler::enterZone();
+            m_start = Profiler::now();
+        }
+    }
+
+    ~ProfileZone()
+    {
+        if(m_name)
+            Profiler::leaveZone(m_name, m_start, m_depth);
+    }
+
+    ProfileZone(const ProfileZone& other) = delete;
+    ProfileZone& operator=(const ProfileZone& other) = delete;
+
+private:
+    const char* m_name{nullptr};
+    int64_t m_start{0};
+    uint32_t m_depth{0};
+};
+
+}
+#endif //MPUTILS_PROFILER_H
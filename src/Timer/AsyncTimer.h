@@ -21,8 +21,10 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <memory>
 #include "Stopwatch.h"
 #include "Cpu_Clock.h"
+#include "TimerService.h"
 #include "../Log/Log.h"
 //--------------------
 
@@ -43,19 +45,29 @@ namespace mpu {
  * For easy use there are typedefs in mpUtils.h eg setDuration(seconds(1)).
  * If you want you can register a function to be called when the timer finishes or set the timer to looping which will make it
  * restart automatically.
- * Start the timer with start(). The timer checks if it is finished in a new thread it manages itself and therefore works
- * asynchronously. You can also stop the timer manually which prevents the registered function from being called.
+ * Start the timer with start(). The timer works asynchronously, it is registered with the global TimerService
+ * which waits for the deadlines of all timers in a single thread. You can also stop the timer manually which
+ * prevents the registered function from being called.
  * pause(), resume() and togglePause() can be used to pause the timer.
  *
  * Keep in mind that the registered function is also called in the other thread so make sure that all memory operations
- * this function does are thread safe.
+ * this function does are thread safe. By default the function is called from the dispatch thread of the timer service,
+ * so it should return quickly. Use setRunOnWorker() to run functions that take longer on the worker threads of the
+ * service instead. Calls of the same timer never overlap.
  *
  * thread safety:
  * This class is totally thread safe and the same object can be modified from different threads
- * without causing data races.
+ * without causing data races. stop(), start() and the destructor wait until a running call of the registered
+ * function returned (unless they are called from the registered function itself). setFunction() waits as well,
+ * when it is called from the registered function itself the new function is used starting with the next call.
+ *
+ * copy and move:
+ * The timer can not be copied. It can be moved, the moved from timer can only be destroyed or assigned to.
+ * Assigning to a timer stops it before it takes over the other timer.
  *
  * exceptions:
- * No Exceptions are thrown. If your registered function throws a exception it is caught and ignored.
+ * No Exceptions are thrown. If your registered function throws a exception it is logged and ignored, the function
+ * runs on a thread shared by all timers, so there is no one to rethrow it to. A looping timer keeps running.
  * Note that throwing exceptions from the registered function is not recommended.
  *
  */
@@ -76,10 +88,17 @@ public:
     // destructor
     ~basic_AsyncTimer();
 
+    // the state is shared with the timer service, a copy would stop the original when it is destroyed
+    basic_AsyncTimer(const basic_AsyncTimer& other) = delete;
+    basic_AsyncTimer& operator=(const basic_AsyncTimer& other) = delete;
+    basic_AsyncTimer(basic_AsyncTimer&& other) noexcept = default;
+    basic_AsyncTimer& operator=(basic_AsyncTimer&& other);
+
     template<typename rep, typename periode>
     void setDuration(std::chrono::duration<rep, periode> newDuration); // sets the time after which the timer finishes
     void setFunction(std::function<void()> func); // sets the function to be called when the timer finishes
     void setLooping(bool shouldLoop); // sets if the timer should be looped
+    void setRunOnWorker(bool runOnWorker); // call the function on a worker thread instead of the dispatch thread
 
     inline void start(); // start (restart if already running) the timer
     inline void stop(); // stop the timer
@@ -92,59 +111,69 @@ public:
 private:
     typedef basic_Stopwatch<clock> stopwatch_type;
     typedef typename stopwatch_type::duration_type duration_type;
-    stopwatch_type sw;
-
-    bool bLooping;  // should the timer be looped
-    bool bRunning;  // is the timer currently running?
-    std::function<void()> finishFunction; // function to call when timer finishes
-    duration_type timerDuration; // the duration the timer is going to run
-
-    void update(); // the main function of the update thread
-    std::thread timerThread;
-    std::condition_variable cv;
-    std::mutex mtx;
-    std::mutex funcMtx;
+
+    // everything the timer service needs to access, lives as long as there are deadlines or calls pending
+    struct State : public TimerTask, public std::enable_shared_from_this<State>
+    {
+        void onDeadline(uint64_t deadlineGeneration) override;
+        void schedule(); // schedule the next deadline (mtx needs to be locked)
+        void runFunction(uint64_t callGeneration); // call the finish function
+        void invalidate(std::unique_lock<std::mutex>& lck); // cancel all deadlines and wait for running calls
+
+        stopwatch_type sw;
+        bool bLooping{false};  // should the timer be looped
+        bool bRunning{false};  // is the timer currently running?
+        bool bPaused{false}; // is the timer paused?
+        bool bRunOnWorker{false}; // call the function on a worker thread
+        std::function<void()> finishFunction; // function to call when timer finishes
+        std::function<void()> nextFunction; // set by the finish function itself, replaces it after the call
+        bool bNextFunction{false}; // nextFunction needs to be used
+        duration_type timerDuration{0}; // the duration the timer is going to run
+
+        uint64_t generation{0}; // incremented to cancel scheduled deadlines and calls
+        int pendingCalls{0}; // calls of the finish function that are queued or running
+        std::thread::id callingThread; // thread that is currently calling the finish function
+        std::condition_variable callCv; // signaled when a call finished
+        std::mutex mtx;
+        std::mutex funcMtx;
+    };
+
+    std::shared_ptr<State> m_state;
 };
 
 // define all the of the basic_AsyncTimer class
 //--------------------
 
 template <typename clock>
-basic_AsyncTimer<clock>::basic_AsyncTimer()
+basic_AsyncTimer<clock>::basic_AsyncTimer() : m_state(std::make_shared<State>())
 {
-    bLooping = false;
-    bRunning = false;
-    timerDuration = duration_type(0);
 }
 
 template <typename clock>
 template <typename rep, typename periode>
-basic_AsyncTimer<clock>::basic_AsyncTimer(std::chrono::duration<rep, periode> newDuration)
+basic_AsyncTimer<clock>::basic_AsyncTimer(std::chrono::duration<rep, periode> newDuration) : basic_AsyncTimer()
 {
-    bLooping = false;
-    bRunning = false;
-    timerDuration = std::chrono::duration_cast<duration_type>(newDuration);
+    m_state->timerDuration = std::chrono::duration_cast<duration_type>(newDuration);
 }
 
 template <typename clock>
 template <typename rep, typename periode>
 basic_AsyncTimer<clock>::basic_AsyncTimer(std::chrono::duration<rep, periode> newDuration, std::function<void()> func)
+    : basic_AsyncTimer()
 {
-    bLooping = false;
-    bRunning = false;
-    timerDuration = std::chrono::duration_cast<duration_type>(newDuration);
-    finishFunction = func;
+    m_state->timerDuration = std::chrono::duration_cast<duration_type>(newDuration);
+    m_state->finishFunction = func;
 }
 
 template <typename clock>
 template <typename rep, typename periode>
 basic_AsyncTimer<clock>::basic_AsyncTimer(std::chrono::duration<rep, periode> newDuration, bool shouldLoop,
                                 std::function<void()> func)
+    : basic_AsyncTimer()
 {
-    bLooping = shouldLoop;
-    bRunning = false;
-    timerDuration = std::chrono::duration_cast<duration_type>(newDuration);
-    finishFunction = func;
+    m_state->bLooping = shouldLoop;
+    m_state->timerDuration = std::chrono::duration_cast<duration_type>(newDuration);
+    m_state->finishFunction = func;
 }
 
 template <typename clock>
@@ -153,127 +182,222 @@ basic_AsyncTimer<clock>::~basic_AsyncTimer()
     stop();
 }
 
+template <typename clock>
+basic_AsyncTimer<clock>& basic_AsyncTimer<clock>::operator=(basic_AsyncTimer&& other)
+{
+    if(this != &other)
+    {
+        stop();
+        m_state = std::move(other.m_state);
+    }
+    return *this;
+}
+
 template <typename clock>
 void basic_AsyncTimer<clock>::setFunction(std::function<void()> func)
 {
-    std::lock_guard<std::mutex> funcLck(funcMtx);
-    finishFunction = func;
+    {
+        // the finish function can not be replaced while it is running, so it is replaced after the call returned
+        std::lock_guard<std::mutex> lck(m_state->mtx);
+        if(m_state->callingThread == std::this_thread::get_id())
+        {
+            m_state->nextFunction = std::move(func);
+            m_state->bNextFunction = true;
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> funcLck(m_state->funcMtx);
+    std::lock_guard<std::mutex> lck(m_state->mtx);
+    m_state->finishFunction = std::move(func);
+    m_state->bNextFunction = false;
 }
 
 template <typename clock>
 template <typename rep, typename periode>
 void basic_AsyncTimer<clock>::setDuration(std::chrono::duration<rep, periode> newDuration)
 {
-    std::unique_lock<std::mutex> lck(mtx);
-    timerDuration = std::chrono::duration_cast<duration_type>(newDuration);
+    std::lock_guard<std::mutex> lck(m_state->mtx);
+    m_state->timerDuration = std::chrono::duration_cast<duration_type>(newDuration);
+
+    // the deadline changes if the timer is running
+    if(m_state->bRunning && !m_state->bPaused)
+    {
+        m_state->generation++;
+        m_state->schedule();
+    }
 }
 
 template <typename clock>
 void basic_AsyncTimer<clock>::setLooping(bool shouldLoop)
 {
-    std::unique_lock<std::mutex> lck(mtx);
-    bLooping = shouldLoop;
+    std::lock_guard<std::mutex> lck(m_state->mtx);
+    m_state->bLooping = shouldLoop;
+}
+
+template <typename clock>
+void basic_AsyncTimer<clock>::setRunOnWorker(bool runOnWorker)
+{
+    std::lock_guard<std::mutex> lck(m_state->mtx);
+    m_state->bRunOnWorker = runOnWorker;
 }
 
 template <typename clock>
 void basic_AsyncTimer<clock>::start()
 {
-    std::unique_lock<std::mutex> lck(mtx);
-    if(bRunning)
-    {
-        bRunning = false;
-        cv.notify_one();
-    }
-    lck.unlock();
-    if(timerThread.joinable())
-        timerThread.join();
-    lck.lock();
+    std::unique_lock<std::mutex> lck(m_state->mtx);
+    m_state->invalidate(lck);
 
     // now start the timer again
-    bRunning = true;
-    sw.reset();
-    timerThread = std::thread( &basic_AsyncTimer<clock>::update, this);
+    m_state->bRunning = true;
+    m_state->bPaused = false;
+    m_state->sw.reset();
+    m_state->schedule();
 }
 
 template <typename clock>
 void basic_AsyncTimer<clock>::stop()
 {
-    std::unique_lock<std::mutex> lck(mtx);
-    if(bRunning)
-    {
-        bRunning = false;
-        cv.notify_one();
-    }
-    lck.unlock(); // not sure if needed
-    if(timerThread.joinable())
-        timerThread.join();
+    if(!m_state)
+        return; // the timer was moved from
+
+    std::unique_lock<std::mutex> lck(m_state->mtx);
+    m_state->bRunning = false;
+    m_state->invalidate(lck);
 }
 
 template <typename clock>
 void basic_AsyncTimer<clock>::pause()
 {
-    std::lock_guard<std::mutex> lck(mtx);
-    sw.pause();
+    std::lock_guard<std::mutex> lck(m_state->mtx);
+    if(m_state->bPaused)
+        return;
+    m_state->sw.pause();
+    m_state->bPaused = true;
+    m_state->generation++;
 }
 
 template <typename clock>
 void basic_AsyncTimer<clock>::resume()
 {
-    std::lock_guard<std::mutex> lck(mtx);
-    sw.resume();
+    std::lock_guard<std::mutex> lck(m_state->mtx);
+    if(!m_state->bPaused)
+        return;
+    m_state->sw.resume();
+    m_state->bPaused = false;
+    if(m_state->bRunning)
+        m_state->schedule();
 }
 
 template <typename clock>
 void basic_AsyncTimer<clock>::togglePause()
 {
-    std::lock_guard<std::mutex> lck(mtx);
-    sw.togglePause();
+    bool paused;
+    {
+        std::lock_guard<std::mutex> lck(m_state->mtx);
+        paused = m_state->bPaused;
+    }
+
+    if(paused)
+        resume();
+    else
+        pause();
 }
 
 template <typename clock>
 bool basic_AsyncTimer<clock>::isRunning()
 {
-    std::unique_lock<std::mutex> lck(mtx);
-    return bRunning;
+    std::lock_guard<std::mutex> lck(m_state->mtx);
+    return m_state->bRunning;
+}
+
+template <typename clock>
+void basic_AsyncTimer<clock>::State::schedule()
+{
+    // the service waits using the steady clock, if the timer uses a different clock the deadline is checked again in onDeadline
+    const auto remaining = std::max(timerDuration - sw.getDuration(), duration_type(0));
+    const auto deadline = TimerService::clock_type::now()
+                          + std::chrono::duration_cast<TimerService::clock_type::duration>(remaining);
+    TimerService::global().schedule(this->shared_from_this(), deadline, generation);
 }
 
 template <typename clock>
-void basic_AsyncTimer<clock>::update()
+void basic_AsyncTimer<clock>::State::invalidate(std::unique_lock<std::mutex>& lck)
+{
+    generation++;
+
+    // calling start or stop from the finish function itself must not wait for the function to return
+    callCv.wait(lck, [this]{return pendingCalls == 0 || callingThread == std::this_thread::get_id();});
+}
+
+template <typename clock>
+void basic_AsyncTimer<clock>::State::onDeadline(uint64_t deadlineGeneration)
 {
     std::unique_lock<std::mutex> lck(mtx);
+    if(deadlineGeneration != generation || !bRunning || bPaused)
+        return;
 
-    while(bRunning) // if timer stops leave
+    if(sw.getDuration() < timerDuration)
     {
-        cv.wait_for(lck, timerDuration-sw.getDuration()-microseconds(40)); // -40 us because timer seems more accurate this way
+        schedule();
+        return;
+    }
 
-        if( !bRunning) // check if we were waken to stop the timer
-            return;
+    if(bLooping)
+    {
+        sw.reset();
+        schedule();
+    }
+    else
+        bRunning = false;
 
-        if(sw.getDuration() >= timerDuration) // check if the the wait is over
-        {
-            if(bLooping)
-                sw.reset();
-            else
-                bRunning = false;
-
-            lck.unlock(); // dont block while callback is running
-            std::unique_lock<std::mutex> funcLck(funcMtx);
-            try
-            {
-                if (finishFunction)
-                    finishFunction();
-            }
-            catch (std::exception &e)
-            {
-                // log and rethrow
-                logFATAL_ERROR("AsyncTimer") << "Exception in the timer function: "<<e.what();
-                throw;
-            }
-            funcLck.unlock();
-            lck.lock();
-        }
+    pendingCalls++;
+    const uint64_t callGeneration = generation;
+    const bool runOnWorker = bRunOnWorker;
+    lck.unlock();
+
+    if(runOnWorker)
+        TimerService::global().post([self = this->shared_from_this(), callGeneration](){self->runFunction(callGeneration);});
+    else
+        runFunction(callGeneration);
+}
+
+template <typename clock>
+void basic_AsyncTimer<clock>::State::runFunction(uint64_t callGeneration)
+{
+    std::unique_lock<std::mutex> funcLck(funcMtx); // calls of the same timer never overlap
+    std::unique_lock<std::mutex> lck(mtx);
+
+    // the timer might have been stopped while the call was waiting
+    const bool shouldCall = (callGeneration == generation);
+    callingThread = std::this_thread::get_id();
+    lck.unlock();
+
+    try
+    {
+        if (shouldCall && finishFunction)
+            finishFunction();
+    }
+    catch (std::exception &e)
+    {
+        // rethrowing would terminate the timer service thread
+        logERROR("AsyncTimer") << "Exception in the timer function, it is ignored: "<<e.what();
+    }
+    catch (...)
+    {
+        logERROR("AsyncTimer") << "Unknown exception in the timer function, it is ignored.";
+    }
+
+    lck.lock();
+    if(bNextFunction)
+    {
+        finishFunction = std::move(nextFunction);
+        nextFunction = nullptr;
+        bNextFunction = false;
     }
-    return;
+    callingThread = std::thread::id();
+    pendingCalls--;
+    callCv.notify_all();
 }
 //--------------------
 
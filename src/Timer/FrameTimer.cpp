@@ -0,0 +1,205 @@
+/*
+ * mpUtils
+ * FrameTimer.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the FrameTimer class, which measures frame times and keeps percentiles over a rolling window
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "FrameTimer.h"
+#include "../Profiler/Profiler.h"
+#include <algorithm>
+#include <cmath>
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+namespace {
+    constexpr int64_t linearBuckets = 64; // frame times below this many ns get their own bucket
+    constexpr std::size_t numBuckets = linearBuckets + (40-6) * 32;
+}
+
+// function definitions of the FrameTimer class
+//-------------------------------------------------------------------
+FrameTimer::FrameTimer(std::size_t windowSize, double spikeThreshold, std::size_t maxSpikes)
+    : m_lastFrame(Profiler::now()), m_frames(std::max<std::size_t>(windowSize,1), 0), m_histogram(numBuckets, 0),
+      m_maxQueue(m_frames.size(), 0), m_maxSpikes(maxSpikes)
+{
+    setSpikeThreshold(spikeThreshold);
+}
+
+double FrameTimer::getDeltaTime()
+{
+    const int64_t start = m_lastFrame;
+    m_lastFrame = Profiler::now();
+    recordFrame(start, m_lastFrame);
+    return static_cast<double>(m_lastFrame - start) * 1.0e-9;
+}
+
+void FrameTimer::setSpikeThreshold(double seconds)
+{
+    m_spikeThreshold = (seconds > 0) ? static_cast<int64_t>(seconds * 1.0e9) : 0;
+}
+
+FrameStats FrameTimer::stats() const
+{
+    FrameStats stats;
+    uint64_t sequence;
+    do
+    {
+        do
+            sequence = m_statsSequence.load(std::memory_order_acquire);
+        while(sequence & 1u);
+
+        stats.frames = m_statFrames.load(std::memory_order_relaxed);
+        stats.totalFrames = m_statTotalFrames.load(std::memory_order_relaxed);
+        stats.spikes = m_statSpikes.load(std::memory_order_relaxed);
+        stats.mean = m_statMean.load(std::memory_order_relaxed);
+        stats.p50 = m_statP50.load(std::memory_order_relaxed);
+        stats.p95 = m_statP95.load(std::memory_order_relaxed);
+        stats.p99 = m_statP99.load(std::memory_order_relaxed);
+        stats.max = m_statMax.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while(sequence != m_statsSequence.load(std::memory_order_relaxed));
+    return stats;
+}
+
+std::vector<FrameSpike> FrameTimer::takeSpikes()
+{
+    std::vector<FrameSpike> spikes;
+    {
+        std::lock_guard<std::mutex> lck(m_spikeMtx);
+        spikes.swap(m_spikes);
+    }
+
+    // aggregating the zones is expensive, so it is done here and not when the spike is recorded
+    for(auto& spike : spikes)
+        spike.zones = Profiler::report(spike.start, spike.end);
+    return spikes;
+}
+
+std::size_t FrameTimer::bucketIndex(int64_t ns)
+{
+    ns = std::min(std::max(ns, int64_t(0)), maxRecordedTime);
+    if(ns < linearBuckets)
+        return static_cast<std::size_t>(ns);
+
+    const int exponent = 63 - __builtin_clzll(static_cast<unsigned long long>(ns));
+    const int64_t mantissa = ns >> (exponent - subBucketBits);
+    return static_cast<std::size_t>(linearBuckets + (exponent-6) * 32 + (mantissa-32));
+}
+
+int64_t FrameTimer::bucketValue(std::size_t index)
+{
+    if(index < linearBuckets)
+        return static_cast<int64_t>(index);
+
+    const std::size_t k = index - linearBuckets;
+    const int shift = static_cast<int>(k / 32) + 6 - subBucketBits;
+    const int64_t mantissa = static_cast<int64_t>(k % 32) + 32;
+    return (mantissa << shift) + ((int64_t(1) << shift) / 2);
+}
+
+void FrameTimer::recordFrame(int64_t start, int64_t end)
+{
+    const int64_t duration = std::min(std::max(end - start, int64_t(0)), maxRecordedTime);
+    const std::size_t windowSize = m_frames.size();
+    const uint64_t frame = m_totalFrames++;
+    const std::size_t slot = frame % windowSize;
+
+    // the oldest frame leaves the window
+    if(frame >= windowSize)
+    {
+        m_histogram[bucketIndex(m_frames[slot])]--;
+        m_windowSum -= m_frames[slot];
+    }
+    m_frames[slot] = duration;
+    m_histogram[bucketIndex(duration)]++;
+    m_windowSum += duration;
+
+    // the queue only keeps frames that are the largest of all frames after them, so the front is the maximum
+    if(m_maxQueueSize > 0 && m_maxQueue[m_maxQueueFront] + windowSize <= frame)
+    {
+        m_maxQueueFront = (m_maxQueueFront + 1) % windowSize;
+        m_maxQueueSize--;
+    }
+    while(m_maxQueueSize > 0 && m_frames[m_maxQueue[(m_maxQueueFront + m_maxQueueSize - 1) % windowSize] % windowSize] <= duration)
+        m_maxQueueSize--;
+    m_maxQueue[(m_maxQueueFront + m_maxQueueSize) % windowSize] = frame;
+    m_maxQueueSize++;
+
+    if(m_spikeThreshold > 0 && duration > m_spikeThreshold)
+    {
+        m_totalSpikes++;
+        std::lock_guard<std::mutex> lck(m_spikeMtx);
+        if(m_maxSpikes > 0 && m_spikes.size() >= m_maxSpikes)
+            m_spikes.erase(m_spikes.begin());
+        if(m_maxSpikes > 0)
+            m_spikes.push_back({frame, static_cast<double>(duration) * 1.0e-9, start, end, {}});
+    }
+
+    const uint64_t framesInWindow = std::min<uint64_t>(m_totalFrames, windowSize);
+    const int64_t max = m_frames[m_maxQueue[m_maxQueueFront] % windowSize];
+
+    FrameStats stats;
+    stats.frames = framesInWindow;
+    stats.totalFrames = m_totalFrames;
+    stats.spikes = m_totalSpikes;
+    stats.mean = static_cast<double>(m_windowSum) / static_cast<double>(framesInWindow) * 1.0e-9;
+    percentiles(stats, max);
+    stats.max = static_cast<double>(max) * 1.0e-9;
+    publishStats(stats);
+}
+
+void FrameTimer::percentiles(FrameStats& stats, int64_t max) const
+{
+    const uint64_t framesInWindow = std::min<uint64_t>(m_totalFrames, m_frames.size());
+    const double quantiles[] = {0.5, 0.95, 0.99};
+    double* results[] = {&stats.p50, &stats.p95, &stats.p99};
+    uint64_t ranks[3];
+    for(int k = 0; k < 3; k++)
+        ranks[k] = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(quantiles[k] * static_cast<double>(framesInWindow))), 1);
+
+    // the ranks increase, so all percentiles are found in one pass over the histogram
+    int next = 0;
+    uint64_t count = 0;
+    for(std::size_t i = 0; i < m_histogram.size() && next < 3; i++)
+    {
+        count += m_histogram[i];
+        while(next < 3 && count >= ranks[next])
+            *results[next++] = static_cast<double>(std::min(bucketValue(i), max)) * 1.0e-9;
+    }
+    for(; next < 3; next++)
+        *results[next] = static_cast<double>(max) * 1.0e-9;
+}
+
+void FrameTimer::publishStats(const FrameStats& stats)
+{
+    const uint64_t sequence = m_statsSequence.load(std::memory_order_relaxed);
+    m_statsSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_statFrames.store(stats.frames, std::memory_order_relaxed);
+    m_statTotalFrames.store(stats.totalFrames, std::memory_order_relaxed);
+    m_statSpikes.store(stats.spikes, std::memory_order_relaxed);
+    m_statMean.store(stats.mean, std::memory_order_relaxed);
+    m_statP50.store(stats.p50, std::memory_order_relaxed);
+    m_statP95.store(stats.p95, std::memory_order_relaxed);
+    m_statP99.store(stats.p99, std::memory_order_relaxed);
+    m_statMax.store(stats.max, std::memory_order_relaxed);
+
+    m_statsSequence.store(sequence + 2, std::memory_order_release);
+}
+
+}
@@ -0,0 +1,135 @@
+/*
+ * mpUtils
+ * FrameTimer.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the FrameTimer class, which measures frame times and keeps percentiles over a rolling window
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_FRAMETIMER_H
+#define MPUTILS_FRAMETIMER_H
+
+// includes
+//--------------------
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * struct FrameStats
+ * statistics of the frames in the rolling window of a FrameTimer, all times in seconds
+ */
+struct FrameStats
+{
+    uint64_t frames{0}; //!< number of frames in the window
+    uint64_t totalFrames{0}; //!< number of frames since the timer was created
+    uint64_t spikes{0}; //!< number of frames above the spike threshold since the timer was created
+    double mean{0};
+    double p50{0};
+    double p95{0};
+    double p99{0};
+    double max{0};
+};
+
+//-------------------------------------------------------------------
+/**
+ * struct FrameSpike
+ * a frame that took longer than the spike threshold
+ */
+struct FrameSpike
+{
+    uint64_t frame; //!< number of the frame
+    double duration; //!< in seconds
+    int64_t start; //!< start of the frame in Profiler::now() time
+    int64_t end; //!< end of the frame in Profiler::now() time
+    std::string zones; //!< Profiler::report() of the zones that overlap the frame
+};
+
+//-------------------------------------------------------------------
+/**
+ * class FrameTimer
+ *
+ * usage:
+ * Use like a DeltaTimer: calling getDeltaTime() once per frame returns the time elapsed since the previous call
+ * in seconds. Additionally the duration of the last windowSize frames is kept in a ring buffer. Mean, percentiles
+ * and maximum over that window are updated with every frame and can be read with stats() from any thread.
+ * The update has a fixed cost independent of the window size, a single pass over the histogram finds all percentiles.
+ * Percentiles are accurate to about 3%, the mean and maximum are exact.
+ *
+ * If spikeThreshold is larger than zero, every frame that takes longer is stored as a FrameSpike, keeping the
+ * maxSpikes most recent ones. takeSpikes() returns them together with a report of the profiling zones that were
+ * recorded by any thread during the frame. The report is created when takeSpikes() is called, so gpu zones that
+ * are collected later are included. Call it regularly, before the profiler overwrites the zones.
+ * Times are measured with Profiler::now(), so spikes can be found on the timeline of a chrome trace.
+ *
+ * thread safety:
+ * getDeltaTime() and setSpikeThreshold() must be called from one thread. stats() and takeSpikes() can be called
+ * from any thread, stats() is lock free.
+ *
+ */
+class FrameTimer
+{
+public:
+    explicit FrameTimer(std::size_t windowSize = 1024, double spikeThreshold = 0, std::size_t maxSpikes = 16);
+
+    double getDeltaTime(); //!< records a frame and returns its duration in seconds
+    void setSpikeThreshold(double seconds); //!< frames longer than this are captured as spikes, 0 to disable
+
+    FrameStats stats() const; //!< statistics of the frames in the window
+    std::vector<FrameSpike> takeSpikes(); //!< returns the spikes captured since the last call
+
+private:
+    static constexpr int subBucketBits = 5; //!< 32 buckets per power of two
+    static constexpr int64_t maxRecordedTime = (int64_t(1) << 40) - 1; //!< about 18 minutes in ns, longer frames are clamped
+
+    static std::size_t bucketIndex(int64_t ns); //!< the histogram bucket of a frame time
+    static int64_t bucketValue(std::size_t index); //!< the time in the middle of a bucket
+
+    void recordFrame(int64_t start, int64_t end);
+    void percentiles(FrameStats& stats, int64_t max) const; //!< p50, p95 and p99 from the histogram, only used on the recording thread
+    void publishStats(const FrameStats& stats); //!< seqlock write of the stats
+
+    // only used by the recording thread
+    int64_t m_lastFrame; //!< end of the last frame
+    std::vector<int64_t> m_frames; //!< ring of frame times in ns
+    std::vector<uint32_t> m_histogram; //!< number of frames in the window per bucket
+    std::vector<uint64_t> m_maxQueue; //!< ring of frame numbers with decreasing frame times, the front is the maximum
+    std::size_t m_maxQueueFront{0};
+    std::size_t m_maxQueueSize{0};
+    uint64_t m_totalFrames{0};
+    uint64_t m_totalSpikes{0};
+    int64_t m_windowSum{0};
+    int64_t m_spikeThreshold;
+
+    // published stats, read lock free by stats()
+    std::atomic<uint64_t> m_statsSequence{0}; //!< odd while the stats are written
+    std::atomic<uint64_t> m_statFrames{0};
+    std::atomic<uint64_t> m_statTotalFrames{0};
+    std::atomic<uint64_t> m_statSpikes{0};
+    std::atomic<double> m_statMean{0};
+    std::atomic<double> m_statP50{0};
+    std::atomic<double> m_statP95{0};
+    std::atomic<double> m_statP99{0};
+    std::atomic<double> m_statMax{0};
+
+    std::mutex m_spikeMtx; //!< protects the spikes
+    std::vector<FrameSpike> m_spikes;
+    const std::size_t m_maxSpikes;
+};
+
+}
+#endif //MPUTILS_FRAMETIMER_H
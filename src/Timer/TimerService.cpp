@@ -0,0 +1,132 @@
+/*
+ * mpUtils
+ * TimerService.cpp
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the TimerService class, which dispatches the deadlines of all asynchronous timers from a single thread
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+// includes
+//--------------------
+#include "TimerService.h"
+#include <algorithm>
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+// function definitions of the TimerService class
+//-------------------------------------------------------------------
+TimerService::TimerService(unsigned int numWorkers) : m_numWorkers(std::max(numWorkers,1u))
+{
+    m_dispatcher = std::thread(&TimerService::dispatcherMainfunc, this);
+}
+
+TimerService::~TimerService()
+{
+    {
+        std::lock_guard<std::mutex> lck(m_mtx);
+        m_shouldRun = false;
+    }
+    m_cv.notify_one();
+    m_dispatcher.join();
+
+    {
+        std::lock_guard<std::mutex> lck(m_workMtx);
+        m_workersShouldRun = false;
+    }
+    m_workCv.notify_all();
+    for(auto &worker : m_workers)
+        worker.join();
+}
+
+TimerService& TimerService::global()
+{
+    static TimerService service;
+    return service;
+}
+
+void TimerService::schedule(std::weak_ptr<TimerTask> task, clock_type::time_point deadline, uint64_t generation)
+{
+    bool isNext;
+    {
+        std::lock_guard<std::mutex> lck(m_mtx);
+        m_deadlines.push(Entry{deadline, m_nextSequence++, generation, std::move(task)});
+        isNext = (m_deadlines.top().sequence == m_nextSequence-1);
+    }
+
+    // the dispatcher only needs to wake up if it has to wait for a shorter time now
+    if(isNext)
+        m_cv.notify_one();
+}
+
+void TimerService::post(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lck(m_workMtx);
+        m_jobs.push(std::move(job));
+
+        if(m_workers.empty())
+            for(unsigned int i = 0; i < m_numWorkers; i++)
+                m_workers.emplace_back(&TimerService::workerMainfunc, this);
+    }
+    m_workCv.notify_one();
+}
+
+void TimerService::dispatcherMainfunc()
+{
+    std::unique_lock<std::mutex> lck(m_mtx);
+    while(m_shouldRun)
+    {
+        if(m_deadlines.empty())
+        {
+            m_cv.wait(lck);
+            continue;
+        }
+
+        const clock_type::time_point next = m_deadlines.top().deadline;
+        if(clock_type::now() < next)
+        {
+            m_cv.wait_until(lck, next);
+            continue;
+        }
+
+        Entry entry = m_deadlines.top();
+        m_deadlines.pop();
+
+        // tasks might schedule their next deadline from within onDeadline
+        lck.unlock();
+        if(auto task = entry.task.lock())
+            task->onDeadline(entry.generation);
+        lck.lock();
+    }
+}
+
+void TimerService::workerMainfunc()
+{
+    std::unique_lock<std::mutex> lck(m_workMtx);
+    while(true)
+    {
+        m_workCv.wait(lck, [this]{return !m_jobs.empty() || !m_workersShouldRun;});
+
+        // jobs that are already posted are run before the worker exits
+        if(m_jobs.empty())
+            return;
+
+        std::function<void()> job = std::move(m_jobs.front());
+        m_jobs.pop();
+
+        lck.unlock();
+        job();
+        lck.lock();
+    }
+}
+
+}
@@ -0,0 +1,114 @@
+/*
+ * mpUtils
+ * TimerService.h
+ *
+ * @author: Hendrik Schwanekamp
+ * @mail:   hendrik.schwanekamp@gmx.net
+ *
+ * Implements the TimerService class, which dispatches the deadlines of all asynchronous timers from a single thread
+ *
+ * Copyright (c) 2018 Hendrik Schwanekamp
+ *
+ */
+
+#ifndef MPUTILS_TIMERSERVICE_H
+#define MPUTILS_TIMERSERVICE_H
+
+// includes
+//--------------------
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+//--------------------
+
+// namespace
+//--------------------
+namespace mpu {
+//--------------------
+
+//-------------------------------------------------------------------
+/**
+ * class TimerTask
+ * interface for everything that can be scheduled with the TimerService
+ */
+class TimerTask
+{
+public:
+    virtual ~TimerTask() = default;
+    virtual void onDeadline(uint64_t generation) = 0; //!< called from the dispatch thread, generation is the value passed to schedule()
+};
+
+//-------------------------------------------------------------------
+/**
+ * class TimerService
+ *
+ * usage:
+ * Keeps the deadlines of any number of timers in a heap and waits for the next one in a single dispatch thread.
+ * Deadlines are scheduled with schedule(), the task is then called from the dispatch thread. Tasks are only
+ * referenced weakly, a task that was destroyed in the meantime is skipped. To cancel a deadline, tasks compare
+ * the generation they get back with their own, and ignore outdated ones.
+ * Work that takes longer can be handed to a small pool of worker threads with post(). The workers are only
+ * started when post() is first called.
+ *
+ * Normally you do not need to use this class directly, the AsyncTimer uses the global() service.
+ *
+ * thread safety:
+ * All functions can be called from any thread.
+ *
+ */
+class TimerService
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    explicit TimerService(unsigned int numWorkers = 2); //!< numWorkers threads are used for jobs passed to post()
+    ~TimerService(); //!< pending deadlines are discarded, jobs that were already posted are still run
+
+    TimerService(const TimerService& other) = delete;
+    TimerService& operator=(const TimerService& other) = delete;
+
+    static TimerService& global(); //!< the service shared by all AsyncTimers
+
+    void schedule(std::weak_ptr<TimerTask> task, clock_type::time_point deadline, uint64_t generation); //!< call task->onDeadline(generation) at deadline
+    void post(std::function<void()> job); //!< run job on one of the worker threads
+
+private:
+    struct Entry
+    {
+        clock_type::time_point deadline;
+        uint64_t sequence; //!< keeps the order of entries with the same deadline
+        uint64_t generation;
+        std::weak_ptr<TimerTask> task;
+
+        bool operator>(const Entry& other) const
+        {
+            return (deadline != other.deadline) ? deadline > other.deadline : sequence > other.sequence;
+        }
+    };
+
+    void dispatcherMainfunc(); //!< waits for deadlines and calls the tasks
+    void workerMainfunc(); //!< runs posted jobs
+
+    std::mutex m_mtx; //!< protects the queue of deadlines
+    std::condition_variable m_cv;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> m_deadlines;
+    uint64_t m_nextSequence{0};
+    bool m_shouldRun{true};
+    std::thread m_dispatcher;
+
+    std::mutex m_workMtx; //!< protects the jobs and the workers
+    std::condition_variable m_workCv;
+    std::queue<std::function<void()>> m_jobs;
+    std::vector<std::thread> m_workers;
+    const unsigned int m_numWorkers;
+    bool m_workersShouldRun{true};
+};
+
+}
+#endif //MPUTILS_TIMERSERVICE_H